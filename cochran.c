@@ -596,7 +596,8 @@ static void cochran_parse_samples(struct dive *dive, const unsigned char *log,
 }
 
 static void cochran_parse_dive(const unsigned char *decode, unsigned mod,
-                               const unsigned char *in, unsigned size)
+                               const unsigned char *in, unsigned size,
+                               struct dive_table *table)
 {
 	unsigned char *buf = malloc(size);
 	struct dive *dive;
@@ -762,13 +763,13 @@ static void cochran_parse_dive(const unsigned char *decode, unsigned mod,
 	}
 
 	dive->downloaded = true;
-	record_dive(dive);
+	record_dive_to_table(dive, table);
 	mark_divelist_changed(true);
 
 	free(buf);
 }
 
-int try_to_open_cochran(const char *filename, struct memblock *mem)
+int try_to_open_cochran(const char *filename, struct memblock *mem, struct dive_table *table)
 {
 	unsigned int i;
 	unsigned int mod;
@@ -798,7 +799,7 @@ int try_to_open_cochran(const char *filename, struct memblock *mem)
 			break;
 
 		cochran_parse_dive(decode, mod, mem->buffer + dive1,
-						dive2 - dive1);
+						dive2 - dive1, table);
 	}
 
 	return 1; // no further processing needed
@@ -674,7 +674,7 @@ void datatrak_import(const char *file, struct dive_table *table)
 		if (!ptdive)
 			report_error(translate("gettextFromC", "Error: no dive"));
 		i++;
-		record_dive(ptdive);
+		record_dive_to_table(ptdive, table);
 	}
 	taglist_cleanup(&g_tag_list);
 	fclose(archivo);
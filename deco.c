@@ -18,6 +18,7 @@
 #include <math.h>
 #include <string.h>
 #include "dive.h"
+#include "deco.h"
 #include <assert.h>
 
 //! Option structure for Buehlmann decompression.
@@ -79,15 +80,15 @@ const double buehlmann_He_factor_expositon_one_second[] = {
 #define WV_PRESSURE 0.0627 // water vapor pressure in bar
 #define DECO_STOPS_MULTIPLIER_MM 3000.0
 
-double tissue_n2_sat[16];
-double tissue_he_sat[16];
-int ci_pointing_to_guiding_tissue;
-double gf_low_pressure_this_dive;
+DECO_THREAD_LOCAL double tissue_n2_sat[16];
+DECO_THREAD_LOCAL double tissue_he_sat[16];
+DECO_THREAD_LOCAL int ci_pointing_to_guiding_tissue;
+DECO_THREAD_LOCAL double gf_low_pressure_this_dive;
 #define TISSUE_ARRAY_SZ sizeof(tissue_n2_sat)
 
-double tolerated_by_tissue[16];
-double tissue_inertgas_saturation[16];
-double buehlmann_inertgas_a[16], buehlmann_inertgas_b[16];
+DECO_THREAD_LOCAL double tolerated_by_tissue[16];
+DECO_THREAD_LOCAL double tissue_inertgas_saturation[16];
+DECO_THREAD_LOCAL double buehlmann_inertgas_a[16], buehlmann_inertgas_b[16];
 
 static double tissue_tolerance_calc(const struct dive *dive)
 {
@@ -147,7 +148,8 @@ static double tissue_tolerance_calc(const struct dive *dive)
  * We cache the last factor, since we commonly call this with the
  * same values... We have a special "fixed cache" for the one second
  * case, although I wonder if that's even worth it considering the
- * more general-purpose cache.
+ * more general-purpose cache. Like the tissue state the caches are
+ * per thread, as the NDL/TTS ascents run on the thread pool.
  */
 struct factor_cache {
 	int last_period;
@@ -156,7 +158,7 @@ struct factor_cache {
 
 double n2_factor(int period_in_seconds, int ci)
 {
-	static struct factor_cache cache[16];
+	static DECO_THREAD_LOCAL struct factor_cache cache[16];
 
 	if (period_in_seconds == 1)
 		return buehlmann_N2_factor_expositon_one_second[ci];
@@ -171,7 +173,7 @@ double n2_factor(int period_in_seconds, int ci)
 
 double he_factor(int period_in_seconds, int ci)
 {
-	static struct factor_cache cache[16];
+	static DECO_THREAD_LOCAL struct factor_cache cache[16];
 
 	if (period_in_seconds == 1)
 		return buehlmann_He_factor_expositon_one_second[ci];
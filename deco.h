@@ -5,11 +5,19 @@
 extern "C" {
 #endif
 
-extern double tolerated_by_tissue[];
-extern double buehlmann_N2_t_halflife[];
-extern double tissue_inertgas_saturation[16];
-extern double buehlmann_inertgas_a[16], buehlmann_inertgas_b[16];
-extern double gf_low_pressure_this_dive;
+/* The tissue state is kept per thread, so that several simulated
+ * ascents can be run side by side (see calculate_deco_information) */
+#ifdef _MSC_VER
+#define DECO_THREAD_LOCAL __declspec(thread)
+#else
+#define DECO_THREAD_LOCAL __thread
+#endif
+
+extern DECO_THREAD_LOCAL double tolerated_by_tissue[16];
+extern const double buehlmann_N2_t_halflife[];
+extern DECO_THREAD_LOCAL double tissue_inertgas_saturation[16];
+extern DECO_THREAD_LOCAL double buehlmann_inertgas_a[16], buehlmann_inertgas_b[16];
+extern DECO_THREAD_LOCAL double gf_low_pressure_this_dive;
 
 
 #ifdef __cplusplus
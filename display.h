@@ -26,6 +26,8 @@ struct plot_info {
 	double maxpp;
 	bool has_ndl;
 	struct plot_data *entry;
+	struct plot_tissue_data *tissues; /* one for each entry, if not NULL */
+	struct plot_minmax_data *minmax; /* one for each entry, if not NULL */
 };
 
 typedef enum {
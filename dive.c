@@ -2673,71 +2673,6 @@ bool taglist_equal(struct tag_entry *tl1, struct tag_entry *tl2)
 	return taglist_contains_all(tl1, tl2) && taglist_contains_all(tl2, tl1);
 }
 
-// count the dives where the tag list contains the given tag
-int count_dives_with_tag(const char *tag)
-{
-	int i, counter = 0;
-	struct dive *d;
-
-	for_each_dive (i, d) {
-		if (same_string(tag, "")) {
-			// count dives with no tags
-			if (d->tag_list == NULL)
-				counter++;
-		} else if (taglist_contains(d->tag_list, tag)) {
-			counter++;
-		}
-	}
-	return counter;
-}
-
-extern bool string_sequence_contains(const char *string_sequence, const char *text);
-
-// count the dives where the person is included in the comma separated string sequences of buddies or divemasters
-int count_dives_with_person(const char *person)
-{
-	int i, counter = 0;
-	struct dive *d;
-
-	for_each_dive (i, d) {
-		if (same_string(person, "")) {
-			// solo dive
-			if (same_string(d->buddy, "") && same_string(d->divemaster, ""))
-				counter++;
-		} else if (string_sequence_contains(d->buddy, person) || string_sequence_contains(d->divemaster, person)) {
-			counter++;
-		}
-	}
-	return counter;
-}
-
-// count the dives with exactly the location
-int count_dives_with_location(const char *location)
-{
-	int i, counter = 0;
-	struct dive *d;
-
-	for_each_dive (i, d) {
-		if (same_string(get_dive_location(d), location))
-			counter++;
-	}
-	return counter;
-}
-
-// count the dives with exactly the suit
-int count_dives_with_suit(const char *suit)
-{
-	int i, counter = 0;
-	struct dive *d;
-
-	for_each_dive (i, d) {
-		if (same_string(d->suit, suit))
-			counter++;
-	}
-	return counter;
-}
-
-
 struct dive *merge_dives(struct dive *a, struct dive *b, int offset, bool prefer_downloaded)
 {
 	struct dive *res = alloc_dive();
@@ -2787,19 +2722,19 @@ struct dive *merge_dives(struct dive *a, struct dive *b, int offset, bool prefer
 	return res;
 }
 
-struct dive *find_dive_including(timestamp_t when)
+/* index of the first dive in the (sorted) dive table that starts after 'when' */
+static int dive_table_upper_bound(timestamp_t when)
 {
-	int i;
-	struct dive *dive;
+	int lo = 0, hi = dive_table.nr;
 
-	/* binary search, anyone? Too lazy for now;
-	 * also we always use the duration from the first divecomputer
-	 *     could this ever be a problem? */
-	for_each_dive (i, dive) {
-		if (dive->when <= when && when <= dive->when + dive->duration.seconds)
-			return dive;
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (get_dive(mid)->when <= when)
+			lo = mid + 1;
+		else
+			hi = mid;
 	}
-	return NULL;
+	return lo;
 }
 
 bool dive_within_time_range(struct dive *dive, timestamp_t when, timestamp_t offset)
@@ -2808,13 +2743,17 @@ bool dive_within_time_range(struct dive *dive, timestamp_t when, timestamp_t off
 }
 
 /* find the n-th dive that is part of a group of dives within the offset around 'when'.
- *  How is that for a vague definition of what this function should do... */
+ *  How is that for a vague definition of what this function should do...
+ * Only dives that start within the offset can qualify, so we only need to
+ * look at that part of the (sorted) dive table. */
 struct dive *find_dive_n_near(timestamp_t when, int n, timestamp_t offset)
 {
 	int i, j = 0;
 	struct dive *dive;
 
-	for_each_dive (i, dive) {
+	for (i = dive_table_upper_bound(when - offset - 1); (dive = get_dive(i)) != NULL; i++) {
+		if (dive->when > when + offset)
+			break;
 		if (dive_within_time_range(dive, when, offset))
 			if (++j == n)
 				return dive;
@@ -2822,6 +2761,122 @@ struct dive *find_dive_n_near(timestamp_t when, int n, timestamp_t offset)
 	return NULL;
 }
 
+static int dive_time_entry_cmp(const void *_a, const void *_b)
+{
+	const struct dive_time_entry *a = _a, *b = _b;
+
+	if (a->start != b->start)
+		return a->start < b->start ? -1 : 1;
+	return a->idx - b->idx;
+}
+
+/*
+ * Build a time index over the dive table (or only the selected dives):
+ * the intervals [when - margin, end + margin] sorted by their start,
+ * together with the running maximum of their ends. A lookup can then
+ * binary search for the last interval that starts before the time and
+ * only has to walk back as long as an earlier interval might still
+ * reach it.
+ */
+void build_dive_time_index(struct dive_time_index *index, bool selected_only, int margin)
+{
+	int i;
+	bool sorted = true;
+	struct dive *dive;
+	struct dive_time_entry *entry;
+	timestamp_t end_max = 0;
+
+	index->nr = 0;
+	index->entries = malloc(dive_table.nr * sizeof(struct dive_time_entry));
+	if (!index->entries)
+		return;
+	for_each_dive (i, dive) {
+		if (selected_only && !dive->selected)
+			continue;
+		entry = index->entries + index->nr++;
+		entry->start = dive->when - margin;
+		entry->end = dive->when + dive->duration.seconds + margin;
+		entry->dive = dive;
+		entry->idx = i;
+		if (index->nr > 1 && entry[-1].start > entry->start)
+			sorted = false;
+	}
+	if (!sorted)
+		qsort(index->entries, index->nr, sizeof(struct dive_time_entry), dive_time_entry_cmp);
+	for (i = 0; i < index->nr; i++) {
+		entry = index->entries + i;
+		if (!i || entry->end > end_max)
+			end_max = entry->end;
+		entry->end_max = end_max;
+	}
+}
+
+void free_dive_time_index(struct dive_time_index *index)
+{
+	free(index->entries);
+	index->entries = NULL;
+	index->nr = 0;
+}
+
+/*
+ * Call 'fn' for every indexed dive whose interval contains the n-th of the
+ * given times, in order of their start times.
+ */
+void match_dive_time_index(const struct dive_time_index *index, const timestamp_t *when, int nr,
+			   void (*fn)(struct dive *dive, int n, void *data), void *data)
+{
+	int n, lo, hi, first, i;
+
+	for (n = 0; n < nr; n++) {
+		lo = 0;
+		hi = index->nr;
+		while (lo < hi) {
+			int mid = (lo + hi) / 2;
+			if (index->entries[mid].start <= when[n])
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		/* entries [0, lo) start before the time; skip those that all end before it */
+		first = lo;
+		while (first > 0 && index->entries[first - 1].end_max >= when[n])
+			first--;
+		for (i = first; i < lo; i++)
+			if (index->entries[i].end >= when[n])
+				fn(index->entries[i].dive, n, data);
+	}
+}
+
+static void first_dive_cb(struct dive *dive, int n, void *data)
+{
+	struct dive **found = data;
+
+	if (!*found)
+		*found = dive;
+}
+
+/*
+ * Dives may overlap (a long dive can contain several short ones), so
+ * whether an earlier dive still includes 'when' depends on the latest
+ * end of all the dives before it - which is what the dive time index
+ * keeps. Look 'when' up there and return the first dive in the table
+ * that includes it, like the plain scan did. Building the index takes
+ * a pass over the dive table, so for many lookups build it once and use
+ * match_dive_time_index() directly.
+ * We always use the duration from the first divecomputer - could this
+ * ever be a problem?
+ */
+struct dive *find_dive_including(timestamp_t when)
+{
+	struct dive_time_index index;
+	struct dive *found = NULL;
+
+	build_dive_time_index(&index, false, 0);
+	match_dive_time_index(&index, &when, 1, first_dive_cb, &found);
+	free_dive_time_index(&index);
+	return found;
+}
+
 void shift_times(const timestamp_t amount)
 {
 	int i;
@@ -2979,6 +3034,17 @@ bool picture_check_valid(char *filename, int shift_time)
 	return false;
 }
 
+static void add_picture_at(struct dive *dive, char *filename, int shift_time, timestamp_t timestamp)
+{
+	struct picture *picture = alloc_picture();
+	picture->filename = strdup(filename);
+	picture->offset.seconds = timestamp - dive->when + shift_time;
+	picture_load_exif_data(picture);
+
+	dive_add_picture(dive, picture);
+	dive_set_geodata_from_picture(dive, picture);
+}
+
 void dive_create_picture(struct dive *dive, char *filename, int shift_time)
 {
 	timestamp_t timestamp = picture_get_timestamp(filename);
@@ -2986,14 +3052,88 @@ void dive_create_picture(struct dive *dive, char *filename, int shift_time)
 		return;
 	if (!dive_check_picture_time(dive, shift_time, timestamp))
 		return;
+	add_picture_at(dive, filename, shift_time, timestamp);
+}
 
-	struct picture *picture = alloc_picture();
-	picture->filename = strdup(filename);
-	picture->offset.seconds = timestamp - dive->when + shift_time;
-	picture_load_exif_data(picture);
+/*
+ * Index the selected dives with the same half hour slack that
+ * dive_check_picture_time() allows (its bounds are exclusive, the index
+ * is inclusive) and look up the shifted picture times in it.
+ * Pictures without a timestamp never match.
+ */
+static void match_pictures_to_selected_dives(char **filenames, int nr, int shift_time, timestamp_t *timestamps,
+					     void (*fn)(struct dive *dive, int n, void *data), void *data)
+{
+	int i;
+	timestamp_t *when = malloc(nr * sizeof(timestamp_t));
+	struct dive_time_index index;
 
-	dive_add_picture(dive, picture);
-	dive_set_geodata_from_picture(dive, picture);
+	if (!when)
+		return;
+	for (i = 0; i < nr; i++) {
+		timestamps[i] = picture_get_timestamp(filenames[i]);
+		/* zero never matches: the earliest possible interval start is later */
+		when[i] = timestamps[i] ? timestamps[i] + shift_time : INT64_MIN;
+	}
+	build_dive_time_index(&index, true, D30MIN - 1);
+	match_dive_time_index(&index, when, nr, fn, data);
+	free_dive_time_index(&index);
+	free(when);
+}
+
+struct picture_match {
+	char **filenames;
+	timestamp_t *timestamps;
+	bool *valid;
+	int shift_time;
+	int count;
+};
+
+static void picture_valid_cb(struct dive *dive, int n, void *data)
+{
+	struct picture_match *match = data;
+
+	match->valid[n] = true;
+}
+
+/*
+ * Batch version of picture_check_valid(): read the timestamps of all the
+ * pictures and mark the ones that fall into one of the selected dives.
+ */
+void pictures_check_valid(char **filenames, int nr, int shift_time, timestamp_t *timestamps, bool *valid)
+{
+	struct picture_match match = { filenames, timestamps, valid, shift_time, 0 };
+
+	memset(valid, 0, nr * sizeof(bool));
+	match_pictures_to_selected_dives(filenames, nr, shift_time, timestamps, picture_valid_cb, &match);
+}
+
+static void create_picture_cb(struct dive *dive, int n, void *data)
+{
+	struct picture_match *match = data;
+
+	if (!new_picture_for_dive(dive, match->filenames[n]))
+		return;
+	add_picture_at(dive, match->filenames[n], match->shift_time, match->timestamps[n]);
+	match->count++;
+}
+
+/*
+ * Add every picture to all the selected dives it was taken during.
+ * Each picture's timestamp is only read once and looked up in a time
+ * index instead of being checked against every dive.
+ * Returns the number of pictures added.
+ */
+int create_pictures_for_selected_dives(char **filenames, int nr, int shift_time)
+{
+	timestamp_t *timestamps = malloc(nr * sizeof(timestamp_t));
+	struct picture_match match = { filenames, timestamps, NULL, shift_time, 0 };
+
+	if (!timestamps)
+		return 0;
+	match_pictures_to_selected_dives(filenames, nr, shift_time, timestamps, create_picture_cb, &match);
+	free(timestamps);
+	return match.count;
 }
 
 void dive_add_picture(struct dive *dive, struct picture *newpic)
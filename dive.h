@@ -244,10 +244,6 @@ void taglist_free(struct tag_entry *tag_list);
 
 bool taglist_contains(struct tag_entry *tag_list, const char *tag);
 bool taglist_equal(struct tag_entry *tl1, struct tag_entry *tl2);
-int count_dives_with_tag(const char *tag);
-int count_dives_with_person(const char *person);
-int count_dives_with_location(const char *location);
-int count_dives_with_suit(const char *suit);
 
 struct extra_data {
 	const char *key;
@@ -388,6 +384,8 @@ extern void dive_add_picture(struct dive *d, struct picture *newpic);
 extern void dive_remove_picture(char *filename);
 extern unsigned int dive_get_picture_count(struct dive *d);
 extern bool picture_check_valid(char *filename, int shift_time);
+extern void pictures_check_valid(char **filenames, int nr, int shift_time, timestamp_t *timestamps, bool *valid);
+extern int create_pictures_for_selected_dives(char **filenames, int nr, int shift_time);
 extern void picture_load_exif_data(struct picture *p);
 extern timestamp_t picture_get_timestamp(char *filename);
 extern void dive_set_geodata_from_picture(struct dive *d, struct picture *pic);
@@ -637,6 +635,23 @@ extern struct dive *find_dive_including(timestamp_t when);
 extern bool dive_within_time_range(struct dive *dive, timestamp_t when, timestamp_t offset);
 struct dive *find_dive_n_near(timestamp_t when, int n, timestamp_t offset);
 
+/* dives sorted by start time with the running maximum of their end times */
+struct dive_time_entry {
+	timestamp_t start, end, end_max;
+	struct dive *dive;
+	int idx;
+};
+
+struct dive_time_index {
+	int nr;
+	struct dive_time_entry *entries;
+};
+
+extern void build_dive_time_index(struct dive_time_index *index, bool selected_only, int margin);
+extern void free_dive_time_index(struct dive_time_index *index);
+extern void match_dive_time_index(const struct dive_time_index *index, const timestamp_t *when, int nr,
+				  void (*fn)(struct dive *dive, int n, void *data), void *data);
+
 /* Check if two dive computer entries are the exact same dive (-1=no/0=maybe/1=yes) */
 extern int match_one_dc(struct divecomputer *a, struct divecomputer *b);
 
@@ -649,7 +664,7 @@ extern int parse_dm4_buffer(sqlite3 *handle, const char *url, const char *buf, i
 extern int parse_dm5_buffer(sqlite3 *handle, const char *url, const char *buf, int size, struct dive_table *table);
 extern int parse_shearwater_buffer(sqlite3 *handle, const char *url, const char *buf, int size, struct dive_table *table);
 extern int parse_cobalt_buffer(sqlite3 *handle, const char *url, const char *buf, int size, struct dive_table *table);
-extern int parse_dlf_buffer(unsigned char *buffer, size_t size);
+extern int parse_dlf_buffer(unsigned char *buffer, size_t size, struct dive_table *table);
 
 extern int parse_file(const char *filename);
 extern int parse_csv_file(const char *filename, int time, int depth, int temp, int po2f, int cnsf, int ndlf, int ttsf, int stopdepthf, int pressuref, int sepidx, const char *csvtemplate, int units);
@@ -782,6 +797,7 @@ extern unsigned int deco_allowed_depth(double tissues_tolerance, double surface_
 extern void set_gf(short gflow, short gfhigh, bool gf_low_at_maxdepth);
 extern void cache_deco_state(double, char **datap);
 extern double restore_deco_state(char *data);
+extern void run_concurrently(void (*func)(void *), void *items, int nr, size_t size);
 
 /* this should be converted to use our types */
 struct divedatapoint {
@@ -0,0 +1,68 @@
+#include <QFile>
+#include <QObject>
+#include <QtConcurrent>
+
+#include "diveimport.h"
+#include "divelist.h"
+
+static memblock readImportFile(const QString &fileName)
+{
+	memblock mem;
+
+	readfile(QFile::encodeName(fileName).data(), &mem);
+	return mem;
+}
+
+/*
+ * Reading the files doesn't depend on anything else, so all of them get
+ * read on the thread pool right away, in the order the user gave them.
+ */
+DiveImport::DiveImport(const QStringList &fileNames) : fileNames(fileNames),
+	reads(QtConcurrent::mapped(fileNames, readImportFile)),
+	nrSites(dive_site_table.nr),
+	parsed(0),
+	committed(false)
+{
+	memset(&table, 0, sizeof(table));
+}
+
+DiveImport::~DiveImport()
+{
+	for (; parsed < fileNames.size(); parsed++) {
+		memblock mem = reads.resultAt(parsed);
+		free_memblock(&mem);
+	}
+	if (!committed)
+		discard_imported_dives(&table, nrSites);
+	free(table.dives);
+}
+
+int DiveImport::count() const
+{
+	return fileNames.size();
+}
+
+bool DiveImport::atEnd() const
+{
+	return parsed == fileNames.size();
+}
+
+/* parse the next file as soon as it has been read */
+void DiveImport::parseNext()
+{
+	memblock mem = reads.resultAt(parsed);
+	QByteArray fileNamePtr = QFile::encodeName(fileNames.at(parsed));
+
+	if (mem.buffer)
+		import_file_buffer(fileNamePtr.data(), &mem, &table);
+	else
+		report_error("%s", qPrintable(QObject::tr("Failed to read '%1'").arg(fileNames.at(parsed))));
+	free_memblock(&mem);
+	parsed++;
+}
+
+void DiveImport::commit()
+{
+	process_imported_dives(&table, false);
+	committed = true;
+}
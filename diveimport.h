@@ -0,0 +1,39 @@
+#ifndef DIVEIMPORT_H
+#define DIVEIMPORT_H
+
+#include <QStringList>
+#include <QFuture>
+
+#include "dive.h"
+#include "file.h"
+
+/*
+ * Import a list of dive log files into a private dive table, so that
+ * the current dives are left alone until commit() merges the result
+ * with process_imported_dives().
+ *
+ * The files are read (or mapped) on the thread pool, but the parsers
+ * keep their state in globals and put the trips and sites they create
+ * straight into dive_trip_list and dive_site_table, so parseNext() has
+ * to be called on the GUI thread, one file at a time. An import that
+ * isn't committed gets undone again when the DiveImport is destroyed.
+ */
+class DiveImport {
+public:
+	DiveImport(const QStringList &fileNames);
+	~DiveImport();
+	int count() const;
+	bool atEnd() const;
+	void parseNext();
+	void commit();
+
+private:
+	QStringList fileNames;
+	QFuture<memblock> reads;
+	struct dive_table table;
+	int nrSites;
+	int parsed;
+	bool committed;
+};
+
+#endif // DIVEIMPORT_H
@@ -743,6 +743,18 @@ void autogroup_dives(void)
 #endif
 }
 
+static void free_deleted_dive(struct dive *dive)
+{
+	/* free all allocations */
+	free(dive->dc.sample);
+	free((void *)dive->notes);
+	free((void *)dive->divemaster);
+	free((void *)dive->buddy);
+	free((void *)dive->suit);
+	taglist_free(dive->tag_list);
+	free(dive);
+}
+
 /* this implements the mechanics of removing the dive from the table,
  * but doesn't deal with updating dive trips, etc */
 void delete_single_dive(int idx)
@@ -757,14 +769,7 @@ void delete_single_dive(int idx)
 	for (i = idx; i < dive_table.nr - 1; i++)
 		dive_table.dives[i] = dive_table.dives[i + 1];
 	dive_table.dives[--dive_table.nr] = NULL;
-	/* free all allocations */
-	free(dive->dc.sample);
-	free((void *)dive->notes);
-	free((void *)dive->divemaster);
-	free((void *)dive->buddy);
-	free((void *)dive->suit);
-	taglist_free(dive->tag_list);
-	free(dive);
+	free_deleted_dive(dive);
 }
 
 void add_single_dive(int idx, struct dive *dive)
@@ -1002,6 +1007,85 @@ static void try_to_renumber(struct dive *last, int preexisting)
 	}
 }
 
+/*
+ * Merge overlapping dives of the sorted dive_table in one sweep.
+ *
+ * Rather than replacing each merged pair in place (which moves the
+ * whole tail of the table every time, and is quadratic when importing
+ * lots of dives we already have) the result is built up in a new array
+ * that replaces the table at the end. Each merged dive gets compared
+ * against the next one again, so runs of overlapping dives collapse
+ * the same way they used to.
+ */
+static void merge_overlapping_dives(bool prefer_imported, struct dive **last)
+{
+	int i, j, id;
+	struct dive **dives;
+	struct dive *current = get_dive(selected_dive);
+
+	if (dive_table.nr < 2)
+		return;
+	dives = malloc(dive_table.allocated * sizeof(struct dive *));
+	if (!dives)
+		exit(1);
+
+	j = 0;
+	dives[0] = dive_table.dives[0];
+	for (i = 1; i < dive_table.nr; i++) {
+		struct dive *prev = dives[j];
+		struct dive *dive = dive_table.dives[i];
+		struct dive *merged = NULL;
+
+		/* only try to merge overlapping dives - or if one of the dives has
+		 * zero duration (that might be a gps marker from the webservice) */
+		if (!prev->duration.seconds || !dive->duration.seconds ||
+		    prev->when + prev->duration.seconds >= dive->when)
+			merged = try_to_merge(prev, dive, prefer_imported);
+		if (!merged) {
+			dives[++j] = dive;
+			continue;
+		}
+
+		// remember the earlier dive's id
+		id = prev->id;
+
+		/* careful - we might free the dive that last points to. Oops... */
+		if (*last == prev || *last == dive)
+			*last = merged;
+		if (current == prev || current == dive)
+			current = merged;
+
+		/* the selection accounting of add_single_dive() / delete_single_dive() */
+		if (merged->selected)
+			amount_selected++;
+		if (prev->selected && amount_selected)
+			amount_selected--;
+		if (dive->selected && amount_selected)
+			amount_selected--;
+		remove_dive_from_trip(prev, false);
+		remove_dive_from_trip(dive, false);
+		free_deleted_dive(prev);
+		free_deleted_dive(dive);
+
+		// keep the id or the first dive for the merged dive
+		merged->id = id;
+		dives[j] = merged;
+	}
+	for (i = j + 1; i < dive_table.nr; i++)
+		dives[i] = NULL;
+
+	free(dive_table.dives);
+	dive_table.dives = dives;
+	dive_table.nr = j + 1;
+
+	/* the selected dive might have moved or been merged */
+	if (current) {
+		selected_dive = get_divenr(current);
+		if (!current->selected)
+			selected_dive = amount_selected ? get_divenr(first_selected_dive()) : -1;
+	}
+}
+
 void process_dives(bool is_imported, bool prefer_imported)
 {
 	int i;
@@ -1025,39 +1109,7 @@ void process_dives(bool is_imported, bool prefer_imported)
 	last = get_dive(preexisting - 1);
 
 	sort_table(&dive_table);
-
-	for (i = 1; i < dive_table.nr; i++) {
-		struct dive **pp = &dive_table.dives[i - 1];
-		struct dive *prev = pp[0];
-		struct dive *dive = pp[1];
-		struct dive *merged;
-		int id;
-
-		/* only try to merge overlapping dives - or if one of the dives has
-		 * zero duration (that might be a gps marker from the webservice) */
-		if (prev->duration.seconds && dive->duration.seconds &&
-		    prev->when + prev->duration.seconds < dive->when)
-			continue;
-
-		merged = try_to_merge(prev, dive, prefer_imported);
-		if (!merged)
-			continue;
-
-		// remember the earlier dive's id
-		id = prev->id;
-
-		/* careful - we might free the dive that last points to. Oops... */
-		if (last == prev || last == dive)
-			last = merged;
-
-		/* Redo the new 'i'th dive */
-		i--;
-		add_single_dive(i, merged);
-		delete_single_dive(i + 1);
-		delete_single_dive(i + 1);
-		// keep the id or the first dive for the merged dive
-		merged->id = id;
-	}
+	merge_overlapping_dives(prefer_imported, &last);
 	/* make sure no dives are still marked as downloaded */
 	for (i = 1; i < dive_table.nr; i++)
 		dive_table.dives[i]->downloaded = false;
@@ -1073,6 +1125,53 @@ void process_dives(bool is_imported, bool prefer_imported)
 	}
 }
 
+/*
+ * Move the dives that an import parsed into a private table over to
+ * the dive_table and do a single merge / renumber pass for all of them.
+ * The dives have already been fixed up when they were recorded in the
+ * private table, so we don't go through record_dive() again.
+ */
+void process_imported_dives(struct dive_table *import_table, bool prefer_imported)
+{
+	int i, nr = dive_table.nr + import_table->nr;
+
+	if (!import_table->nr)
+		return;
+
+	if (nr > dive_table.allocated) {
+		struct dive **dives = realloc(dive_table.dives, nr * sizeof(struct dive *));
+		if (!dives)
+			exit(1);
+		dive_table.dives = dives;
+		dive_table.allocated = nr;
+	}
+	for (i = 0; i < import_table->nr; i++) {
+		dive_table.dives[dive_table.nr++] = import_table->dives[i];
+		import_table->dives[i] = NULL;
+	}
+	import_table->nr = 0;
+
+	process_dives(true, prefer_imported);
+}
+
+/*
+ * Throw away an import that was canceled: the parsers have already put
+ * the trips of the imported dives into dive_trip_list and their new
+ * sites at the end of dive_site_table, so unlink the dives from their
+ * trips (which deletes the trips that only held imported dives) and
+ * delete the sites past the first nr_sites before freeing the dives.
+ */
+void discard_imported_dives(struct dive_table *import_table, int nr_sites)
+{
+	int i;
+
+	for (i = 0; i < import_table->nr; i++)
+		remove_dive_from_trip(import_table->dives[i], false);
+	while (dive_site_table.nr > nr_sites)
+		delete_dive_site(get_dive_site(dive_site_table.nr - 1)->uuid);
+	clear_table(import_table);
+}
+
 void set_dive_nr_for_current_dive()
 {
 	if (dive_table.nr == 1)
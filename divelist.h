@@ -6,6 +6,7 @@ extern "C" {
 #endif
 
 struct dive;
+struct dive_table;
 
 extern void update_cylinder_related_info(struct dive *);
 extern void mark_divelist_changed(int);
@@ -15,6 +16,8 @@ extern double init_decompression(struct dive *dive);
 
 /* divelist core logic functions */
 extern void process_dives(bool imported, bool prefer_imported);
+extern void process_imported_dives(struct dive_table *import_table, bool prefer_imported);
+extern void discard_imported_dives(struct dive_table *import_table, int nr_sites);
 extern char *get_dive_gas_string(struct dive *dive);
 
 extern dive_trip_t *find_trip_by_idx(int idx);
@@ -4,6 +4,8 @@
 #include <QDir>
 #include <QSettings>
 #include <QTextStream>
+#include <QSet>
+#include <QtConcurrent>
 #include "divelogexportlogic.h"
 #include "helpers.h"
 #include "units.h"
@@ -18,6 +20,9 @@ void file_copy_and_overwrite(const QString &fileName, const QString &newName)
 	QFile::copy(fileName, newName);
 }
 
+/* how many consecutive dives share one file of dive details in a sharded export */
+#define HTML_EXPORT_SHARD 32
+
 void exportHTMLsettings(const QString &filename, struct htmlExportSetting &hes)
 {
 	QString fontSize = hes.fontSize;
@@ -27,6 +32,7 @@ void exportHTMLsettings(const QString &filename, struct htmlExportSetting &hes)
 	QTextStream out(&file);
 	out << "settings = {\"fontSize\":\"" << fontSize << "\",\"fontFamily\":\"" << fontFamily << "\",\"listOnly\":\""
 	    << hes.listOnly << "\",\"subsurfaceNumbers\":\"" << hes.subsurfaceNumbers << "\",";
+	out << "\"diveShardSize\":\"" << (hes.shardDives && !hes.listOnly ? HTML_EXPORT_SHARD : 0) << "\",";
 	//save units preferences
 	if (prefs.unit_system == METRIC) {
 		out << "\"unit_system\":\"Meteric\"";
@@ -115,7 +121,182 @@ static void exportHTMLstatistics(const QString filename, struct htmlExportSettin
 
 }
 
-void exportHtmlInitLogic(const QString &filename, struct htmlExportSetting &hes)
+/* how many dives (or photos) are handed to the thread pool at a time */
+#define HTML_EXPORT_BATCH 128
+
+struct HtmlDive {
+	struct dive *dive;
+	int number;
+	int trip;
+	bool firstInTrip;
+	bool lastInTrip;
+	const char *photosDir;
+	bool listOnly;
+	bool sharded;
+};
+
+/*
+ * The list entry of a dive, and for a sharded export the details that go
+ * into the shard file of the dive instead. This runs on the thread pool:
+ * write_one_dive() only reads the dive and the preferences, but the unit
+ * and gas strings go through translate(), which is why trGettext() keeps
+ * its cache under a lock.
+ */
+struct HtmlDiveFragment {
+	QByteArray entry;
+	QByteArray details;
+};
+
+static HtmlDiveFragment htmlDiveFragment(const HtmlDive &entry)
+{
+	struct membuffer buf = { 0 };
+	int number = entry.number;
+	HtmlDiveFragment fragment;
+
+	write_one_dive(&buf, entry.dive, entry.photosDir, &number, entry.listOnly || entry.sharded);
+	fragment.entry = QByteArray(buf.buffer, buf.len);
+	free_buffer(&buf);
+	if (entry.sharded) {
+		put_string(&buf, "{");
+		write_dive_details(&buf, entry.dive, entry.photosDir);
+		put_format(&buf, "\"number\":%d}\n", entry.number);
+		fragment.details = QByteArray(buf.buffer, buf.len);
+		free_buffer(&buf);
+	}
+	return fragment;
+}
+
+/*
+ * Dive details of a sharded export go into _files/dives/shard_N.js, which
+ * the page loads when one of its dives is first shown in the detailed view.
+ */
+static bool writeHtmlShard(QFile &shard, const QString &shardsDirectory, const HtmlDive &entry, const QByteArray &details, int nrDives, QStringList &written)
+{
+	int index = entry.number / HTML_EXPORT_SHARD;
+
+	if (entry.number % HTML_EXPORT_SHARD == 0) {
+		shard.setFileName(shardsDirectory + QString("shard_%1.js").arg(index));
+		written.append(shard.fileName());
+		if (!shard.open(QIODevice::WriteOnly)) {
+			report_error("%s", qPrintable(QObject::tr("Can't open file %1").arg(shard.fileName())));
+			return false;
+		}
+		shard.write(QString("dive_details_loaded(%1, [").arg(index).toUtf8());
+	} else {
+		shard.write(", ");
+	}
+	shard.write(details);
+	if ((entry.number + 1) % HTML_EXPORT_SHARD == 0 || entry.number == nrDives - 1) {
+		shard.write("]);\n");
+		shard.close();
+	}
+	return true;
+}
+
+static void copyHtmlPhoto(const QPair<QString, QString> &photo)
+{
+	copy_image_and_overwrite(photo.first.toUtf8().data(), photo.second.toUtf8().data());
+}
+
+static bool updateProgress(HtmlExportProgress *progress, int done, int total)
+{
+	return !progress || progress->update(done, total);
+}
+
+/*
+ * The JSON of the dives is generated on the thread pool a batch at a time
+ * and written out in order as soon as the batch is done, so only one batch
+ * is ever held in memory. The photos are then copied by the thread pool as
+ * well; they all end up in photosDirectory under their base name, so two
+ * pictures with the same name are only copied once.
+ * With a sharded export the file only gets the fields the dive list needs,
+ * and the details are split up over the files in shardsDirectory.
+ * When the export fails or gets canceled, the files written so far are
+ * removed again rather than leaving a broken export behind.
+ */
+static bool exportHtmlDives(const QString &filename, const QString &photosDirectory, const QString &shardsDirectory, struct htmlExportSetting &hes, HtmlExportProgress *progress)
+{
+	struct html_export_trip *trips;
+	int nrTrips = get_html_export_trips(hes.selectedOnly, &trips);
+	QByteArray photosDir = photosDirectory.toUtf8();
+	QVector<HtmlDive> dives;
+	QList<QPair<QString, QString> > photos;
+	QSet<QString> seenPhotos;
+	QStringList written;
+	bool copyPhotos = !hes.listOnly && !photosDirectory.isEmpty();
+	bool sharded = hes.shardDives && !hes.listOnly;
+
+	for (int i = 0; i < nrTrips; i++) {
+		for (int j = 0; j < trips[i].nr; j++) {
+			HtmlDive entry = { trips[i].dives[j], dives.count(), i, j == 0, j == trips[i].nr - 1, photosDir.data(), hes.listOnly, sharded };
+			dives.append(entry);
+			if (!copyPhotos)
+				continue;
+			FOR_EACH_PICTURE (trips[i].dives[j]) {
+				QString fileName = QString::fromUtf8(picture->filename);
+				QString target = photosDirectory + QFileInfo(fileName).fileName();
+				if (seenPhotos.contains(target))
+					continue;
+				seenPhotos.insert(target);
+				photos.append(qMakePair(fileName, photosDirectory));
+			}
+		}
+	}
+
+	int total = dives.count() + photos.count();
+	bool ok = true;
+	QFile file(filename);
+	QFile shard;
+	if (!file.open(QIODevice::WriteOnly)) {
+		report_error("%s", qPrintable(QObject::tr("Can't open file %1").arg(filename)));
+		free_html_export_trips(trips, nrTrips);
+		return false;
+	}
+	written.append(filename);
+	file.write("trips=[");
+	for (int start = 0; ok && start < dives.count(); start += HTML_EXPORT_BATCH) {
+		QVector<HtmlDive> batch = dives.mid(start, HTML_EXPORT_BATCH);
+		QList<HtmlDiveFragment> fragments = QtConcurrent::blockingMapped<QList<HtmlDiveFragment> >(batch, htmlDiveFragment);
+		for (int i = 0; ok && i < batch.count(); i++) {
+			const HtmlDive &entry = batch.at(i);
+			struct membuffer buf = { 0 };
+			if (entry.firstInTrip)
+				write_trip_start(&buf, trips + entry.trip, entry.trip == 0);
+			else
+				put_string(&buf, ", ");
+			file.write(buf.buffer, buf.len);
+			free_buffer(&buf);
+			file.write(fragments.at(i).entry);
+			if (entry.lastInTrip) {
+				write_trip_end(&buf);
+				file.write(buf.buffer, buf.len);
+				free_buffer(&buf);
+			}
+			if (sharded)
+				ok = writeHtmlShard(shard, shardsDirectory, entry, fragments.at(i).details, dives.count(), written);
+		}
+		ok = ok && updateProgress(progress, start + batch.count(), total);
+	}
+	file.write("]");
+	file.close();
+	shard.close();
+	free_html_export_trips(trips, nrTrips);
+
+	for (int start = 0; ok && start < photos.count(); start += HTML_EXPORT_BATCH) {
+		QList<QPair<QString, QString> > batch = photos.mid(start, HTML_EXPORT_BATCH);
+		QtConcurrent::blockingMap(batch, copyHtmlPhoto);
+		for (int i = 0; i < batch.count(); i++)
+			written.append(photosDirectory + QFileInfo(batch.at(i).first).fileName());
+		ok = updateProgress(progress, dives.count() + start + batch.count(), total);
+	}
+	if (!ok) {
+		Q_FOREACH (const QString &name, written)
+			QFile::remove(name);
+	}
+	return ok;
+}
+
+bool exportHtmlInitLogic(const QString &filename, struct htmlExportSetting &hes, HtmlExportProgress *progress)
 {
 	QString photosDirectory;
 	QFile file(filename);
@@ -128,6 +309,7 @@ void exportHtmlInitLogic(const QString &filename, struct htmlExportSetting &hes)
 	QString json_settings = exportFiles + QDir::separator() + "settings.js";
 	QString translation = exportFiles + QDir::separator() + "translation.js";
 	QString stat_file = exportFiles + QDir::separator() + "stat.js";
+	QString shardsDirectory;
 	exportFiles += "/";
 
 	if (hes.exportPhotos) {
@@ -135,16 +317,22 @@ void exportHtmlInitLogic(const QString &filename, struct htmlExportSetting &hes)
 		mainDir.mkdir(photosDirectory);
 	}
 
+	if (hes.shardDives && !hes.listOnly) {
+		shardsDirectory = exportFiles + "dives" + QDir::separator();
+		mainDir.mkdir(shardsDirectory);
+	}
+
 
 	exportHTMLsettings(json_settings, hes);
 	exportHTMLstatistics(stat_file, hes);
 	export_translation(translation.toUtf8().data());
 
-	export_HTML(qPrintable(json_dive_data), qPrintable(photosDirectory), hes.selectedOnly, hes.listOnly);
+	if (!exportHtmlDives(json_dive_data, photosDirectory, shardsDirectory, hes, progress))
+		return false;
 
 	QString searchPath = getSubsurfaceDataPath("theme");
 	if (searchPath.isEmpty())
-		return;
+		return true;
 
 	searchPath += QDir::separator();
 
@@ -158,4 +346,5 @@ void exportHtmlInitLogic(const QString &filename, struct htmlExportSetting &hes)
 	file_copy_and_overwrite(searchPath + "jquery.min.js", exportFiles + "jquery.min.js");
 	file_copy_and_overwrite(searchPath + "jquery.jqplot.css", exportFiles + "jquery.jqplot.css");
 	file_copy_and_overwrite(searchPath + hes.themeFile, exportFiles + "theme.css");
+	return true;
 }
@@ -5,6 +5,7 @@ struct htmlExportSetting {
 	bool exportPhotos;
 	bool selectedOnly;
 	bool listOnly;
+	bool shardDives;
 	QString fontFamily;
 	QString fontSize;
 	int themeSelection;
@@ -13,8 +14,18 @@ struct htmlExportSetting {
 	QString themeFile;
 };
 
+/*
+ * Progress of an HTML export: update() gets called as the dives and
+ * photos are written, and the export stops early once it returns false.
+ */
+class HtmlExportProgress {
+public:
+	virtual ~HtmlExportProgress() {}
+	virtual bool update(int done, int total) = 0;
+};
+
 void file_copy_and_overwrite(const QString &fileName, const QString &newName);
-void exportHtmlInitLogic(const QString &filename, struct htmlExportSetting &hes);
+bool exportHtmlInitLogic(const QString &filename, struct htmlExportSetting &hes, HtmlExportProgress *progress = 0);
 
 #endif // DIVELOGEXPORTLOGIC_H
 
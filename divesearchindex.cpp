@@ -0,0 +1,143 @@
+#include <QtConcurrent>
+#include <QStringList>
+
+#include "divesearchindex.h"
+#include "divesite.h"
+
+DiveSearchIndex::DiveSearchIndex()
+{
+}
+
+DiveSearchIndex *DiveSearchIndex::instance()
+{
+	static DiveSearchIndex *self = new DiveSearchIndex();
+	return self;
+}
+
+/* everything a search can match, lower case, one field per line */
+QString DiveSearchIndex::diveText(struct dive *d)
+{
+	QStringList fields;
+	struct dive_site *ds = get_dive_site_by_uuid(d->dive_site_uuid);
+	struct tag_entry *tag;
+
+	fields << QString(d->notes) << QString(d->buddy) << QString(d->divemaster) << QString(d->suit);
+	if (ds)
+		fields << QString(ds->name) << QString(ds->description);
+	for (tag = d->tag_list; tag; tag = tag->next)
+		fields << QString(tag->tag->name);
+	return fields.join("\n").toLower();
+}
+
+static QStringList searchWords(const QString &text)
+{
+	return text.toLower().split(QRegExp("\\s+"), QString::SkipEmptyParts);
+}
+
+static bool textMatches(const QString &diveText, const QStringList &words)
+{
+	Q_FOREACH (const QString &word, words) {
+		if (!diveText.contains(word))
+			return false;
+	}
+	return true;
+}
+
+bool DiveSearchIndex::diveMatches(struct dive *d, const QString &text)
+{
+	return textMatches(diveText(d), searchWords(text));
+}
+
+void DiveSearchIndex::addTrigrams(int id, const QString &text)
+{
+	for (int i = 0; i + 3 <= text.length(); i++)
+		trigrams[text.mid(i, 3)].insert(id);
+}
+
+void DiveSearchIndex::removeTrigrams(int id, const QString &text)
+{
+	for (int i = 0; i + 3 <= text.length(); i++) {
+		QHash<QString, QSet<int> >::iterator it = trigrams.find(text.mid(i, 3));
+		if (it == trigrams.end())
+			continue;
+		it->remove(id);
+		if (it->isEmpty())
+			trigrams.erase(it);
+	}
+}
+
+/* runs in the background: nothing else touches the index until it's done */
+void DiveSearchIndex::indexTexts(QHash<int, QString> changed, QSet<int> removed)
+{
+	Q_FOREACH (int id, removed) {
+		removeTrigrams(id, texts.value(id));
+		texts.remove(id);
+	}
+	QHash<int, QString>::const_iterator it;
+	for (it = changed.constBegin(); it != changed.constEnd(); ++it) {
+		QHash<int, QString>::iterator old = texts.find(it.key());
+		if (old != texts.end())
+			removeTrigrams(it.key(), old.value());
+		texts.insert(it.key(), it.value());
+		addTrigrams(it.key(), it.value());
+	}
+}
+
+/*
+ * Collect the text of the dives right here, as the dives may change
+ * under a background thread, but leave the tokenizing to one.
+ */
+void DiveSearchIndex::update()
+{
+	int i;
+	struct dive *d;
+	QHash<int, QString> changed;
+	QSet<int> removed;
+
+	pending.waitForFinished();
+	removed = QSet<int>::fromList(texts.keys());
+	for_each_dive (i, d) {
+		QString text = diveText(d);
+		removed.remove(d->id);
+		QHash<int, QString>::const_iterator old = texts.constFind(d->id);
+		if (old == texts.constEnd() || old.value() != text)
+			changed.insert(d->id, text);
+	}
+	if (changed.isEmpty() && removed.isEmpty())
+		return;
+	pending = QtConcurrent::run(this, &DiveSearchIndex::indexTexts, changed, removed);
+}
+
+/*
+ * The ids of the dives that contain every word of the text. The
+ * trigrams of the words narrow it down to a few candidates, which
+ * are then checked against their text.
+ */
+QSet<int> DiveSearchIndex::search(const QString &text)
+{
+	QStringList words = searchWords(text);
+	QSet<int> candidates, result;
+	bool narrowed = false;
+
+	pending.waitForFinished();
+	Q_FOREACH (const QString &word, words) {
+		for (int i = 0; i + 3 <= word.length(); i++) {
+			QSet<int> dives = trigrams.value(word.mid(i, 3));
+			if (narrowed)
+				candidates &= dives;
+			else
+				candidates = dives;
+			narrowed = true;
+			if (candidates.isEmpty())
+				return result;
+		}
+	}
+	if (!narrowed)
+		candidates = QSet<int>::fromList(texts.keys());
+
+	Q_FOREACH (int id, candidates) {
+		if (textMatches(texts.value(id), words))
+			result.insert(id);
+	}
+	return result;
+}
@@ -0,0 +1,39 @@
+#ifndef DIVESEARCHINDEX_H
+#define DIVESEARCHINDEX_H
+
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QFuture>
+
+#include "dive.h"
+
+/*
+ * A trigram index over the free text of the dives (notes, dive site
+ * name and description, buddy, divemaster, suit and tags), so that
+ * searching the log doesn't need to scan every string of every dive.
+ *
+ * The dives are keyed by their unique id. update() only re-indexes the
+ * dives whose text changed since the last call, and does the work in
+ * the background; search() waits for that to finish.
+ */
+class DiveSearchIndex {
+public:
+	static DiveSearchIndex *instance();
+	void update();
+	QSet<int> search(const QString &text);
+	static bool diveMatches(struct dive *d, const QString &text);
+	static QString diveText(struct dive *d);
+
+private:
+	DiveSearchIndex();
+	void indexTexts(QHash<int, QString> changed, QSet<int> removed);
+	void addTrigrams(int id, const QString &text);
+	void removeTrigrams(int id, const QString &text);
+
+	QFuture<void> pending;
+	QHash<int, QString> texts;
+	QHash<QString, QSet<int> > trigrams;
+};
+
+#endif // DIVESEARCHINDEX_H
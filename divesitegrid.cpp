@@ -0,0 +1,92 @@
+#include "divesitegrid.h"
+
+#define LATITUDE_RANGE 180000000
+#define LONGITUDE_RANGE 360000000
+
+DiveSiteGrid::DiveSiteGrid(int cellSize) : cellSize(cellSize),
+	columns((LONGITUDE_RANGE + cellSize - 1) / cellSize),
+	sites(0)
+{
+}
+
+void DiveSiteGrid::clear()
+{
+	cells.clear();
+	sites = 0;
+}
+
+int DiveSiteGrid::count() const
+{
+	return sites;
+}
+
+/* rows start at the south pole, columns at the date line and wrap around */
+int DiveSiteGrid::row(qint64 latitude, int cellSize)
+{
+	latitude = qBound((qint64)-LATITUDE_RANGE / 2, latitude, (qint64)LATITUDE_RANGE / 2);
+	return (latitude + LATITUDE_RANGE / 2) / cellSize;
+}
+
+int DiveSiteGrid::column(qint64 longitude, int cellSize)
+{
+	longitude = (longitude + LONGITUDE_RANGE / 2) % LONGITUDE_RANGE;
+	if (longitude < 0)
+		longitude += LONGITUDE_RANGE;
+	return longitude / cellSize;
+}
+
+quint64 DiveSiteGrid::cellKey(int latitude, int longitude, int cellSize)
+{
+	return ((quint64)row(latitude, cellSize) << 32) | column(longitude, cellSize);
+}
+
+void DiveSiteGrid::insert(uint32_t uuid, int latitude, int longitude)
+{
+	Site site = { uuid, latitude, longitude };
+	cells[cellKey(latitude, longitude, cellSize)].append(site);
+	sites++;
+}
+
+/*
+ * All the sites whose latitude and longitude are both no more than 'radius'
+ * micro degrees away from the given point (with the longitude wrapping
+ * around at the date line).
+ */
+QVector<DiveSiteGrid::Site> DiveSiteGrid::sitesNear(int latitude, int longitude, int radius) const
+{
+	QVector<Site> result;
+	int firstRow = row((qint64)latitude - radius, cellSize);
+	int lastRow = row((qint64)latitude + radius, cellSize);
+	int firstColumn = column((qint64)longitude - radius, cellSize);
+	/* a box that is wider than all but one cell may wrap back into its first column */
+	int nrColumns = 2 * (qint64)radius + cellSize >= LONGITUDE_RANGE ? columns :
+			(column((qint64)longitude + radius, cellSize) - firstColumn + columns) % columns + 1;
+
+	QVector<const QVector<Site> *> candidates;
+	if ((qint64)(lastRow - firstRow + 1) * nrColumns > cells.count()) {
+		// the box covers more cells than there are filled ones
+		QHash<quint64, QVector<Site> >::const_iterator it;
+		for (it = cells.constBegin(); it != cells.constEnd(); ++it)
+			candidates.append(&it.value());
+	} else {
+		for (int r = firstRow; r <= lastRow; r++) {
+			for (int c = 0; c < nrColumns; c++) {
+				QHash<quint64, QVector<Site> >::const_iterator it = cells.find(((quint64)r << 32) | ((firstColumn + c) % columns));
+				if (it != cells.constEnd())
+					candidates.append(&it.value());
+			}
+		}
+	}
+
+	Q_FOREACH (const QVector<Site> *cell, candidates) {
+		Q_FOREACH (const Site &site, *cell) {
+			qint64 latDiff = qAbs((qint64)site.latitude - latitude);
+			qint64 lonDiff = qAbs((qint64)site.longitude - longitude);
+			if (lonDiff > LONGITUDE_RANGE / 2)
+				lonDiff = LONGITUDE_RANGE - lonDiff;
+			if (latDiff <= radius && lonDiff <= radius)
+				result.append(site);
+		}
+	}
+	return result;
+}
@@ -0,0 +1,42 @@
+#ifndef DIVESITEGRID_H
+#define DIVESITEGRID_H
+
+#include <stdint.h>
+#include <QHash>
+#include <QVector>
+
+/*
+ * A uniform grid over dive site locations (in micro degrees), so that
+ * the sites around a point can be found by only looking at the cells
+ * that point is in or next to, instead of at every dive site.
+ *
+ * The grid keeps the uuid and location of each site rather than a
+ * pointer to it, so it stays safe to query after the dive site table
+ * changed - it just doesn't know about the change until it's rebuilt.
+ */
+class DiveSiteGrid {
+public:
+	struct Site {
+		uint32_t uuid;
+		int latitude;
+		int longitude;
+	};
+
+	explicit DiveSiteGrid(int cellSize = 100000);
+	void clear();
+	void insert(uint32_t uuid, int latitude, int longitude);
+	QVector<Site> sitesNear(int latitude, int longitude, int radius) const;
+	int count() const;
+	static quint64 cellKey(int latitude, int longitude, int cellSize);
+
+private:
+	static int row(qint64 latitude, int cellSize);
+	static int column(qint64 longitude, int cellSize);
+
+	int cellSize;
+	int columns;
+	int sites;
+	QHash<quint64, QVector<Site> > cells;
+};
+
+#endif // DIVESITEGRID_H
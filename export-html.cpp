@@ -31,6 +31,9 @@ int main(int argc, char **argv)
 						 "Write HTML files into <directory>",
 						 "directory");
 	parser.addOption(outputDirectoryOption);
+	QCommandLineOption shardOption(QStringList() << "d" << "shard-dives",
+				       "Write the dive details into separate files that get loaded on demand");
+	parser.addOption(shardOption);
 
 	parser.process(*application);
 
@@ -58,7 +61,11 @@ int main(int argc, char **argv)
 	hes.exportPhotos = true;
 	hes.selectedOnly = false;
 	hes.listOnly = false;
+	hes.shardDives = parser.isSet(shardOption);
 	hes.yearlyStatistics = true;
-	exportHtmlInitLogic(output, hes);
+	if (!exportHtmlInitLogic(output, hes)) {
+		fprintf(stderr, "%s\n", get_error_string());
+		exit(1);
+	}
 	exit(0);
 }
@@ -24,6 +24,43 @@
 #define O_BINARY 0
 #endif
 
+#ifndef WIN32
+#include <sys/mman.h>
+#define HAVE_MMAP 1
+
+/*
+ * Files at least this big get mapped rather than copied into a heap
+ * buffer. For small files the mmap setup isn't worth it.
+ */
+#define MMAP_THRESHOLD (1024 * 1024)
+
+/*
+ * All the parsers expect the buffer to be NUL-terminated, just like
+ * the heap buffer below. A mapping only gives us that for free if the
+ * file doesn't end on a page boundary (the tail of the last page is
+ * zero-filled), so in the rare other case we just read() the file.
+ *
+ * The mapping is private and writable: some parsers temporarily poke
+ * NUL bytes into the buffer, and those must not end up in the file.
+ */
+static int map_file(int fd, size_t size, struct memblock *mem)
+{
+	long pagesize = sysconf(_SC_PAGESIZE);
+	void *map;
+
+	if (size < MMAP_THRESHOLD || pagesize <= 0 || size % pagesize == 0)
+		return -1;
+	map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED)
+		return -1;
+	madvise(map, size, MADV_SEQUENTIAL);
+	mem->buffer = map;
+	mem->size = size;
+	mem->mapped = size;
+	return 0;
+}
+#endif
+
 int readfile(const char *filename, struct memblock *mem)
 {
 	int ret, fd;
@@ -32,6 +69,7 @@ int readfile(const char *filename, struct memblock *mem)
 
 	mem->buffer = NULL;
 	mem->size = 0;
+	mem->mapped = 0;
 
 	fd = subsurface_open(filename, O_RDONLY | O_BINARY, 0);
 	if (fd < 0)
@@ -45,6 +83,12 @@ int readfile(const char *filename, struct memblock *mem)
 	ret = 0;
 	if (!st.st_size)
 		goto out;
+#ifdef HAVE_MMAP
+	if (!map_file(fd, st.st_size, mem)) {
+		ret = mem->size;
+		goto out;
+	}
+#endif
 	buf = malloc(st.st_size + 1);
 	ret = -1;
 	errno = ENOMEM;
@@ -69,8 +113,21 @@ out:
 	return ret;
 }
 
+void free_memblock(struct memblock *mem)
+{
+#ifdef HAVE_MMAP
+	if (mem->mapped)
+		munmap(mem->buffer, mem->mapped);
+	else
+#endif
+		free(mem->buffer);
+	mem->buffer = NULL;
+	mem->size = 0;
+	mem->mapped = 0;
+}
+
 
-static void zip_read(struct zip_file *file, const char *filename)
+static void zip_read(struct zip_file *file, const char *filename, struct dive_table *table)
 {
 	int size = 1024, n, read = 0;
 	char *mem = malloc(size);
@@ -81,11 +138,11 @@ static void zip_read(struct zip_file *file, const char *filename)
 		mem = realloc(mem, size);
 	}
 	mem[read] = 0;
-	(void) parse_xml_buffer(filename, mem, read, &dive_table, NULL);
+	(void) parse_xml_buffer(filename, mem, read, table, NULL);
 	free(mem);
 }
 
-static int try_to_open_zip(const char *filename, struct memblock *mem)
+static int try_to_open_zip(const char *filename, struct memblock *mem, struct dive_table *table)
 {
 	int success = 0;
 	/* Grr. libzip needs to re-open the file, it can't take a buffer */
@@ -100,7 +157,7 @@ static int try_to_open_zip(const char *filename, struct memblock *mem)
 			/* skip parsing the divelogs.de pictures */
 			if (strstr(zip_get_name(zip, index, 0), "pictures/"))
 				continue;
-			zip_read(file, filename);
+			zip_read(file, filename, table);
 			zip_fclose(file);
 			success++;
 		}
@@ -109,53 +166,42 @@ static int try_to_open_zip(const char *filename, struct memblock *mem)
 	return success;
 }
 
-static int try_to_xslt_open_csv(const char *filename, struct memblock *mem, const char *tag)
+/*
+ * Surround the CSV data starting at 'offset' with XML tags to enable
+ * XSLT parsing. This builds a fresh heap buffer with a single copy of
+ * the data, so the source may just as well be a read-only mapping.
+ */
+static int wrap_csv_buffer(struct memblock *mem, size_t offset, const char *tag)
 {
-	char *buf;
-
-	if (mem->size == 0 && readfile(filename, mem) < 0)
-		return report_error(translate("gettextFromC", "Failed to read '%s'"), filename);
-
-	/* Surround the CSV file content with XML tags to enable XSLT
-	 * parsing
-	 *
-	 * Tag markers take: strlen("<></>") = 5
-	 */
-	buf = realloc(mem->buffer, mem->size + 7 + strlen(tag) * 2);
-	if (buf != NULL) {
-		char *starttag = NULL;
-		char *endtag = NULL;
-
-		starttag = malloc(3 + strlen(tag));
-		endtag = malloc(5 + strlen(tag));
-
-		if (starttag == NULL || endtag == NULL) {
-			/* this is fairly silly - so the malloc fails, but we strdup the error?
-			 * let's complete the silliness by freeing the two pointers in case one malloc succeeded
-			 *  and the other one failed - this will make static analysis tools happy */
-			free(starttag);
-			free(endtag);
-			free(buf);
-			return report_error("Memory allocation failed in %s", __func__);
-		}
+	size_t taglen = strlen(tag);
+	size_t len = mem->size - offset;
+	char *buf, *p;
+
+	/* Tag markers take: strlen("<>") + strlen("\n</>") = 6, plus the NUL */
+	buf = malloc(len + 7 + taglen * 2);
+	if (!buf) {
+		free_memblock(mem);
+		return report_error("Memory allocation failed in %s", __func__);
+	}
 
-		sprintf(starttag, "<%s>", tag);
-		sprintf(endtag, "\n</%s>", tag);
+	p = buf;
+	p += sprintf(p, "<%s>", tag);
+	memcpy(p, (char *)mem->buffer + offset, len);
+	p += len;
+	sprintf(p, "\n</%s>", tag);
 
-		memmove(buf + 2 + strlen(tag), buf, mem->size);
-		memcpy(buf, starttag, 2 + strlen(tag));
-		memcpy(buf + mem->size + 2 + strlen(tag), endtag, 5 + strlen(tag));
-		mem->size += (6 + 2 * strlen(tag));
-		mem->buffer = buf;
+	free_memblock(mem);
+	mem->buffer = buf;
+	mem->size = len + 6 + taglen * 2;
+	return 0;
+}
 
-		free(starttag);
-		free(endtag);
-	} else {
-		free(mem->buffer);
-		return report_error("realloc failed in %s", __func__);
-	}
+static int try_to_xslt_open_csv(const char *filename, struct memblock *mem, const char *tag)
+{
+	if (mem->size == 0 && readfile(filename, mem) < 0)
+		return report_error(translate("gettextFromC", "Failed to read '%s'"), filename);
 
-	return 0;
+	return wrap_csv_buffer(mem, 0, tag);
 }
 
 int db_test_func(void *param, int columns, char **data, char **column)
@@ -164,7 +210,7 @@ int db_test_func(void *param, int columns, char **data, char **column)
 }
 
 
-static int try_to_open_db(const char *filename, struct memblock *mem)
+static int try_to_open_db(const char *filename, struct memblock *mem, struct dive_table *table)
 {
 	sqlite3 *handle;
 	char dm4_test[] = "select count(*) from sqlite_master where type='table' and name='Dive' and sql like '%ProfileBlob%'";
@@ -183,7 +229,7 @@ static int try_to_open_db(const char *filename, struct memblock *mem)
 	/* Testing if DB schema resembles Suunto DM5 database format */
 	retval = sqlite3_exec(handle, dm5_test, &db_test_func, 0, NULL);
 	if (!retval) {
-		retval = parse_dm5_buffer(handle, filename, mem->buffer, mem->size, &dive_table);
+		retval = parse_dm5_buffer(handle, filename, mem->buffer, mem->size, table);
 		sqlite3_close(handle);
 		return retval;
 	}
@@ -191,7 +237,7 @@ static int try_to_open_db(const char *filename, struct memblock *mem)
 	/* Testing if DB schema resembles Suunto DM4 database format */
 	retval = sqlite3_exec(handle, dm4_test, &db_test_func, 0, NULL);
 	if (!retval) {
-		retval = parse_dm4_buffer(handle, filename, mem->buffer, mem->size, &dive_table);
+		retval = parse_dm4_buffer(handle, filename, mem->buffer, mem->size, table);
 		sqlite3_close(handle);
 		return retval;
 	}
@@ -199,7 +245,7 @@ static int try_to_open_db(const char *filename, struct memblock *mem)
 	/* Testing if DB schema resembles Shearwater database format */
 	retval = sqlite3_exec(handle, shearwater_test, &db_test_func, 0, NULL);
 	if (!retval) {
-		retval = parse_shearwater_buffer(handle, filename, mem->buffer, mem->size, &dive_table);
+		retval = parse_shearwater_buffer(handle, filename, mem->buffer, mem->size, table);
 		sqlite3_close(handle);
 		return retval;
 	}
@@ -207,7 +253,7 @@ static int try_to_open_db(const char *filename, struct memblock *mem)
 	/* Testing if DB schema resembles Atomic Cobalt database format */
 	retval = sqlite3_exec(handle, cobalt_test, &db_test_func, 0, NULL);
 	if (!retval) {
-		retval = parse_cobalt_buffer(handle, filename, mem->buffer, mem->size, &dive_table);
+		retval = parse_cobalt_buffer(handle, filename, mem->buffer, mem->size, table);
 		sqlite3_close(handle);
 		return retval;
 	}
@@ -322,7 +368,7 @@ static void add_sample_data(struct sample *sample, enum csv_format type, double
  *
  * Followed by the data values (all comma-separated, all one long line).
  */
-static int try_to_open_csv(const char *filename, struct memblock *mem, enum csv_format type)
+static int try_to_open_csv(const char *filename, struct memblock *mem, enum csv_format type, struct dive_table *table)
 {
 	char *p = mem->buffer;
 	char *header[8];
@@ -372,11 +418,11 @@ static int try_to_open_csv(const char *filename, struct memblock *mem, enum csv_
 			break;
 		p = end + 1;
 	}
-	record_dive(dive);
+	record_dive_to_table(dive, table);
 	return 1;
 }
 
-static int open_by_filename(const char *filename, const char *fmt, struct memblock *mem)
+static int open_by_filename(const char *filename, const char *fmt, struct memblock *mem, struct dive_table *table)
 {
 	// hack to be able to provide a comment for the translated string
 	static char *csv_warning = QT_TRANSLATE_NOOP3("gettextFromC",
@@ -385,38 +431,77 @@ static int open_by_filename(const char *filename, const char *fmt, struct memblo
 
 	/* Suunto Dive Manager files: SDE, ZIP; divelogs.de files: DLD */
 	if (!strcasecmp(fmt, "SDE") || !strcasecmp(fmt, "ZIP") || !strcasecmp(fmt, "DLD"))
-		return try_to_open_zip(filename, mem);
+		return try_to_open_zip(filename, mem, table);
 
 	/* CSV files */
 	if (!strcasecmp(fmt, "CSV"))
 		return report_error(translate("gettextFromC", csv_warning), filename);
 	/* Truly nasty intentionally obfuscated Cochran Anal software */
 	if (!strcasecmp(fmt, "CAN"))
-		return try_to_open_cochran(filename, mem);
+		return try_to_open_cochran(filename, mem, table);
 	/* Cochran export comma-separated-value files */
 	if (!strcasecmp(fmt, "DPT"))
-		return try_to_open_csv(filename, mem, CSV_DEPTH);
+		return try_to_open_csv(filename, mem, CSV_DEPTH, table);
 	if (!strcasecmp(fmt, "LVD"))
-		return try_to_open_liquivision(filename, mem);
+		return try_to_open_liquivision(filename, mem, table);
 	if (!strcasecmp(fmt, "TMP"))
-		return try_to_open_csv(filename, mem, CSV_TEMP);
+		return try_to_open_csv(filename, mem, CSV_TEMP, table);
 	if (!strcasecmp(fmt, "HP1"))
-		return try_to_open_csv(filename, mem, CSV_PRESSURE);
+		return try_to_open_csv(filename, mem, CSV_PRESSURE, table);
 
 	return 0;
 }
 
-static int parse_file_buffer(const char *filename, struct memblock *mem)
+static int parse_file_buffer(const char *filename, struct memblock *mem, struct dive_table *table)
 {
 	int ret;
 	char *fmt = strrchr(filename, '.');
-	if (fmt && (ret = open_by_filename(filename, fmt + 1, mem)) != 0)
+	if (fmt && (ret = open_by_filename(filename, fmt + 1, mem, table)) != 0)
 		return ret;
 
 	if (!mem->size || !mem->buffer)
 		return report_error("Out of memory parsing file %s\n", filename);
 
-	return parse_xml_buffer(filename, mem->buffer, mem->size, &dive_table, NULL);
+	return parse_xml_buffer(filename, mem->buffer, mem->size, table, NULL);
+}
+
+/*
+ * Parse an already read dive log file into 'table'. This doesn't
+ * handle git repositories and leaves freeing 'mem' to the caller.
+ *
+ * The parsers keep their state in globals, so this must not be called
+ * from more than one thread at a time - but it doesn't touch the
+ * dive_table unless asked to, which lets an import parse into a
+ * private table while the rest of the program keeps using the
+ * current dives.
+ */
+int import_file_buffer(const char *filename, struct memblock *mem, struct dive_table *table)
+{
+	char *fmt;
+
+	fmt = strrchr(filename, '.');
+	if (fmt && (!strcasecmp(fmt + 1, "DB") || !strcasecmp(fmt + 1, "BAK"))) {
+		if (!try_to_open_db(filename, mem, table))
+			return 0;
+	}
+
+	/* Divesoft Freedom */
+	if (fmt && (!strcasecmp(fmt + 1, "DLF")))
+		return parse_dlf_buffer(mem->buffer, mem->size, table) ? -1 : 0;
+
+	/* DataTrak/Wlog */
+	if (fmt && !strcasecmp(fmt + 1, "LOG")) {
+		datatrak_import(filename, table);
+		return 0;
+	}
+
+	/* OSTCtools */
+	if (fmt && (!strcasecmp(fmt + 1, "DIVE"))) {
+		ostctools_import(filename, table);
+		return 0;
+	}
+
+	return parse_file_buffer(filename, mem, table);
 }
 
 int parse_file(const char *filename)
@@ -424,7 +509,6 @@ int parse_file(const char *filename)
 	struct git_repository *git;
 	const char *branch;
 	struct memblock mem;
-	char *fmt;
 	int ret;
 
 	git = is_git_repository(filename, &branch, NULL);
@@ -447,37 +531,8 @@ int parse_file(const char *filename)
 		return report_error(translate("gettextFromC", "Failed to read '%s'"), filename);
 	}
 
-	fmt = strrchr(filename, '.');
-	if (fmt && (!strcasecmp(fmt + 1, "DB") || !strcasecmp(fmt + 1, "BAK"))) {
-		if (!try_to_open_db(filename, &mem)) {
-			free(mem.buffer);
-			return 0;
-		}
-	}
-
-	/* Divesoft Freedom */
-	if (fmt && (!strcasecmp(fmt + 1, "DLF"))) {
-		if (!parse_dlf_buffer(mem.buffer, mem.size)) {
-			free(mem.buffer);
-			return 0;
-		}
-		return -1;
-	}
-
-	/* DataTrak/Wlog */
-	if (fmt && !strcasecmp(fmt + 1, "LOG")) {
-		datatrak_import(filename, &dive_table);
-		return 0;
-	}
-
-	/* OSTCtools */
-	if (fmt && (!strcasecmp(fmt + 1, "DIVE"))) {
-		ostctools_import(filename, &dive_table);
-		return 0;
-	}
-
-	ret = parse_file_buffer(filename, &mem);
-	free(mem.buffer);
+	ret = import_file_buffer(filename, &mem, &dive_table);
+	free_memblock(&mem);
 	return ret;
 }
 
@@ -549,6 +604,7 @@ int parse_txt_file(const char *filename, const char *csv)
 
 		if (sscanf(parse_mkvi_value(memtxt.buffer, "Dive started at"), "%d-%d-%d %d:%d:%d",
 					&y, &m, &d, &hh, &mm, &ss) != 6) {
+			free_memblock(&memtxt);
 			return -1;
 		}
 
@@ -621,6 +677,7 @@ int parse_txt_file(const char *filename, const char *csv)
 		 *	39	water temp
 		 */
 
+		free_memblock(&memtxt);
 		if (readfile(csv, &memcsv) < 0) {
 			return report_error(translate("gettextFromC", "Poseidon import failed: unable to read '%s'"), csv);
 		}
@@ -805,9 +862,11 @@ int parse_txt_file(const char *filename, const char *csv)
 			if (!lineptr || !*lineptr)
 				break;
 		}
+		free_memblock(&memcsv);
 		record_dive(dive);
 		return 1;
 	} else {
+		free_memblock(&memtxt);
 		return report_error(translate("gettextFromC", "No matching DC found for file '%s'"), csv);
 	}
 
@@ -919,7 +978,7 @@ int parse_csv_file(const char *filename, int timef, int depthf, int tempf, int p
 		if (same_string(get_dive(i)->dc.model, ""))
 			get_dive(i)->dc.model = copy_string("Imported from CSV");
 
-	free(mem.buffer);
+	free_memblock(&mem);
 	return ret;
 }
 
@@ -981,8 +1040,10 @@ int parse_seabear_csv_file(const char *filename, int timef, int depthf, int temp
 	 * If file does not contain empty lines, it is not a valid
 	 * Seabear CSV file.
 	 */
-	if (NL == NULL)
+	if (NL == NULL) {
+		free_memblock(&mem);
 		return -1;
+	}
 
 	/*
 	 * On my current sample of Seabear DC log file, the date is
@@ -1012,15 +1073,12 @@ int parse_seabear_csv_file(const char *filename, int timef, int depthf, int temp
 	params[SBPARAMS - 2] = deltabuf;
 	params[SBPARAMS - 1] = NULL;
 
-	/* Move the CSV data to the start of mem buffer */
-	memmove(mem.buffer, ptr_old, mem.size - (ptr_old - (char*)mem.buffer));
-	mem.size = (int)mem.size - (ptr_old - (char*)mem.buffer);
-
-	if (try_to_xslt_open_csv(filename, &mem, csvtemplate))
+	/* Wrap only the CSV data, skipping the Seabear header */
+	if (wrap_csv_buffer(&mem, ptr_old - (char *)mem.buffer, csvtemplate))
 		return -1;
 
 	ret = parse_xml_buffer(filename, mem.buffer, mem.size, &dive_table, (const char **)params);
-	free(mem.buffer);
+	free_memblock(&mem);
 	return ret;
 }
 
@@ -1170,6 +1228,6 @@ int parse_manual_file(const char *filename, int sepidx, int units, int dateforma
 
 	ret = parse_xml_buffer(filename, mem.buffer, mem.size, &dive_table, (const char **)params);
 
-	free(mem.buffer);
+	free_memblock(&mem);
 	return ret;
 }
@@ -4,10 +4,11 @@
 struct memblock {
 	void *buffer;
 	size_t size;
+	size_t mapped;	/* length of the mapping, 0 for heap buffers */
 };
 
-extern int try_to_open_cochran(const char *filename, struct memblock *mem);
-extern int try_to_open_liquivision(const char *filename, struct memblock *mem);
+extern int try_to_open_cochran(const char *filename, struct memblock *mem, struct dive_table *table);
+extern int try_to_open_liquivision(const char *filename, struct memblock *mem, struct dive_table *table);
 extern void datatrak_import(const char *file, struct dive_table *table);
 extern void ostctools_import(const char *file, struct dive_table *table);
 
@@ -15,6 +16,8 @@ extern void ostctools_import(const char *file, struct dive_table *table);
 extern "C" {
 #endif
 extern int readfile(const char *filename, struct memblock *mem);
+extern void free_memblock(struct memblock *mem);
+extern int import_file_buffer(const char *filename, struct memblock *mem, struct dive_table *table);
 extern timestamp_t parse_date(const char *date);
 #ifdef __cplusplus
 }
@@ -1,9 +1,17 @@
 #include <QCoreApplication>
 #include <QString>
+#include <QMutexLocker>
 #include <gettextfromc.h>
 
+/*
+ * The C code translates from the thread pool as well (the statistics and
+ * the HTML export), so the cache is only ever touched under the lock.
+ * The entries themselves don't move when the hash grows, so the returned
+ * strings stay valid after the lock is dropped.
+ */
 const char *gettextFromC::trGettext(const char *text)
 {
+	QMutexLocker locker(&translationCacheLock);
 	QByteArray &result = translationCache[QByteArray(text)];
 	if (result.isEmpty())
 		result = translationCache[QByteArray(text)] = trUtf8(text).toUtf8();
@@ -12,6 +20,7 @@ const char *gettextFromC::trGettext(const char *text)
 
 void gettextFromC::reset(void)
 {
+	QMutexLocker locker(&translationCacheLock);
 	translationCache.clear();
 }
 
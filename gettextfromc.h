@@ -2,6 +2,7 @@
 #define GETTEXTFROMC_H
 
 #include <QHash>
+#include <QMutex>
 #include <QCoreApplication>
 
 extern "C" const char *trGettext(const char *text);
@@ -13,6 +14,7 @@ public:
 	const char *trGettext(const char *text);
 	void reset(void);
 	QHash<QByteArray, QByteArray> translationCache;
+	QMutex translationCacheLock;
 };
 
 #endif // GETTEXTFROMC_H
@@ -8,7 +8,10 @@
 #define HELPERS_H
 
 #include <QString>
+#include <QMap>
+#include <QFuture>
 #include "dive.h"
+#include "statistics.h"
 #include "qthelper.h"
 
 QString get_depth_string(depth_t depth, bool showunit = false, bool showdecimal = true);
@@ -36,7 +39,16 @@ QString get_trip_date_string(timestamp_t when, int nr);
 QString uiLanguage(QLocale *callerLoc);
 QLocale getLocale();
 QString getDateFormat();
-void selectedDivesGasUsed(QVector<QPair<QString, int> > &gasUsed);
+void sortedGasUsed(const QMap<QString, int> &gasUsed, QVector<QPair<QString, int> > &gasUsedOrdered);
+
+// the statistics of the selected dives, mergeable so they can be worked out in parallel
+struct SelectionStatistics {
+	SelectionStatistics();
+	stats_t stats;
+	QMap<QString, int> gasUsed;
+	volume_t o2, he;
+};
+QFuture<SelectionStatistics> selectedDivesStatistics();
 QString getUserAgent();
 
 #if defined __APPLE__
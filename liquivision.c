@@ -90,7 +90,7 @@ static int handle_event_ver3(int code, const unsigned char *ps, unsigned int ps_
 	return skip;
 }
 
-static void parse_dives (int log_version, const unsigned char *buf, unsigned int buf_size)
+static void parse_dives (int log_version, const unsigned char *buf, unsigned int buf_size, struct dive_table *table)
 {
 	unsigned int ptr = 0;
 	unsigned char model;
@@ -370,7 +370,7 @@ static void parse_dives (int log_version, const unsigned char *buf, unsigned int
 
 		// End dive
 		dive->downloaded = true;
-		record_dive(dive);
+		record_dive_to_table(dive, table);
 		mark_divelist_changed(true);
 
 		// Advance ptr for next dive
@@ -380,7 +380,7 @@ static void parse_dives (int log_version, const unsigned char *buf, unsigned int
 	//DEBUG save_dives("/tmp/test.xml");
 }
 
-int try_to_open_liquivision(const char *filename, struct memblock *mem)
+int try_to_open_liquivision(const char *filename, struct memblock *mem, struct dive_table *table)
 {
 	const unsigned char *buf = mem->buffer;
 	unsigned int buf_size = mem->size;
@@ -403,7 +403,7 @@ int try_to_open_liquivision(const char *filename, struct memblock *mem)
 	}
 	ptr += 4;
 
-	parse_dives(log_version, buf + ptr, buf_size - ptr);
+	parse_dives(log_version, buf + ptr, buf_size - ptr, table);
 
 	return 1;
 }
@@ -1995,14 +1995,97 @@ void parse_mkvi_buffer(struct membuffer *txt, struct membuffer *csv, const char
 	dive_end();
 }
 
-extern int dm4_events(void *handle, int columns, char **data, char **column)
+/*
+ * The desktop logbook databases are read with prepared statements, with
+ * the dive list ordered by dive id. All the per dive data (cylinders,
+ * events, tags, samples...) of a kind comes from a single query that is
+ * ordered by dive id as well, and that is stepped along with the dive
+ * list - so every table is read once, instead of formatting and running
+ * a handful of new queries for every dive.
+ */
+#define MAX_SQLITE_CURSORS 4
+
+struct sqlite_cursor {
+	sqlite3_stmt *stmt;
+	int status;
+	bool started;
+	sqlite3_int64 id;
+};
+
+static inline bool sql_null(sqlite3_stmt *stmt, int col)
+{
+	return sqlite3_column_type(stmt, col) == SQLITE_NULL;
+}
+
+static inline char *sql_text(sqlite3_stmt *stmt, int col)
+{
+	return (char *)sqlite3_column_text(stmt, col);
+}
+
+static int sqlite_cursor_open(sqlite3 *handle, struct sqlite_cursor *cursor, const char *query)
+{
+	if (sqlite3_prepare_v2(handle, query, -1, &cursor->stmt, NULL) != SQLITE_OK)
+		return 1;
+	cursor->status = sqlite3_step(cursor->stmt);
+	return 0;
+}
+
+/*
+ * Call 'fn' for all the rows of dive 'id' (the first column of the query).
+ * The dives come in increasing id order, so this normally just steps
+ * forward; should a dive show up a second time we start over.
+ */
+static int sqlite_cursor_rows(struct sqlite_cursor *cursor, sqlite3_int64 id, void (*fn)(sqlite3_stmt *stmt))
+{
+	if (cursor->started && id <= cursor->id) {
+		sqlite3_reset(cursor->stmt);
+		cursor->status = sqlite3_step(cursor->stmt);
+	}
+	cursor->started = true;
+	cursor->id = id;
+	while (cursor->status == SQLITE_ROW && sqlite3_column_int64(cursor->stmt, 0) < id)
+		cursor->status = sqlite3_step(cursor->stmt);
+	while (cursor->status == SQLITE_ROW && sqlite3_column_int64(cursor->stmt, 0) == id) {
+		fn(cursor->stmt);
+		cursor->status = sqlite3_step(cursor->stmt);
+	}
+	return cursor->status != SQLITE_ROW && cursor->status != SQLITE_DONE;
+}
+
+static int parse_sqlite_dives(sqlite3 *handle, const char *url, const char *get_dives, const char **get_rows, int nr,
+			      int (*dive_fn)(sqlite3_stmt *stmt, struct sqlite_cursor *cursor))
+{
+	int i, retval = 0, status = SQLITE_DONE;
+	sqlite3_stmt *stmt = NULL;
+	struct sqlite_cursor cursor[MAX_SQLITE_CURSORS];
+
+	memset(cursor, 0, sizeof(cursor));
+	if (sqlite3_prepare_v2(handle, get_dives, -1, &stmt, NULL) != SQLITE_OK)
+		retval = 1;
+	for (i = 0; !retval && i < nr; i++)
+		retval = sqlite_cursor_open(handle, cursor + i, get_rows[i]);
+	while (!retval && (status = sqlite3_step(stmt)) == SQLITE_ROW)
+		retval = dive_fn(stmt, cursor);
+	if (status != SQLITE_DONE)
+		retval = 1;
+
+	for (i = 0; i < nr; i++)
+		sqlite3_finalize(cursor[i].stmt);
+	sqlite3_finalize(stmt);
+
+	if (retval)
+		fprintf(stderr, translate("gettextFromC", "Database query failed '%s'.\n"), url);
+	return retval;
+}
+
+static void dm4_event(sqlite3_stmt *stmt)
 {
 	event_start();
-	if (data[1])
-		cur_event.time.seconds = atoi(data[1]);
+	if (!sql_null(stmt, 2))
+		cur_event.time.seconds = sqlite3_column_int(stmt, 2);
 
-	if (data[2]) {
-		switch (atoi(data[2])) {
+	if (!sql_null(stmt, 3)) {
+		switch (sqlite3_column_int(stmt, 3)) {
 		case 1:
 			/* 1 Mandatory Safety Stop */
 			strcpy(cur_event.name, "safety stop (mandatory)");
@@ -2089,9 +2172,9 @@ extern int dm4_events(void *handle, int columns, char **data, char **column)
 			break;
 		case 258:
 			/* 258 Bookmark */
-			if (data[3]) {
+			if (!sql_null(stmt, 4)) {
 				strcpy(cur_event.name, "heading");
-				cur_event.value = atoi(data[3]);
+				cur_event.value = sqlite3_column_int(stmt, 4);
 			} else {
 				strcpy(cur_event.name, "bookmark");
 			}
@@ -2115,251 +2198,231 @@ extern int dm4_events(void *handle, int columns, char **data, char **column)
 			break;
 		default:
 			strcpy(cur_event.name, "unknown");
-			cur_event.value = atoi(data[2]);
+			cur_event.value = sqlite3_column_int(stmt, 3);
 			break;
 		}
 	}
 	event_end();
-
-	return 0;
 }
 
-extern int dm5_cylinders(void *handle, int columns, char **data, char **column)
+static void dm5_cylinder(sqlite3_stmt *stmt)
 {
+	int start = sqlite3_column_int(stmt, 8), end = sqlite3_column_int(stmt, 9);
+
 	cylinder_start();
-	if (data[7] && atoi(data[7]) > 0 && atoi(data[7]) < 350000)
-		cur_dive->cylinder[cur_cylinder_index].start.mbar = atoi(data[7]);
-	if (data[8] && atoi(data[8]) > 0 && atoi(data[8]) < 350000)
-		cur_dive->cylinder[cur_cylinder_index].end.mbar = (atoi(data[8]));
-	if (data[6]) {
+	if (start > 0 && start < 350000)
+		cur_dive->cylinder[cur_cylinder_index].start.mbar = start;
+	if (end > 0 && end < 350000)
+		cur_dive->cylinder[cur_cylinder_index].end.mbar = end;
+	if (!sql_null(stmt, 7)) {
 		/* DM5 shows tank size of 12 liters when the actual
 		 * value is 0 (and using metric units). So we just use
 		 * the same 12 liters when size is not available */
-		if (atof(data[6]) == 0.0 && cur_dive->cylinder[cur_cylinder_index].start.mbar)
+		if (sqlite3_column_double(stmt, 7) == 0.0 && cur_dive->cylinder[cur_cylinder_index].start.mbar)
 			cur_dive->cylinder[cur_cylinder_index].type.size.mliter = 12000;
 		else
-			cur_dive->cylinder[cur_cylinder_index].type.size.mliter = (atof(data[6])) * 1000;
+			cur_dive->cylinder[cur_cylinder_index].type.size.mliter = sqlite3_column_double(stmt, 7) * 1000;
 	}
-	if (data[2])
-		cur_dive->cylinder[cur_cylinder_index].gasmix.o2.permille = atoi(data[2]) * 10;
-	if (data[3])
-		cur_dive->cylinder[cur_cylinder_index].gasmix.he.permille = atoi(data[3]) * 10;
+	if (!sql_null(stmt, 3))
+		cur_dive->cylinder[cur_cylinder_index].gasmix.o2.permille = sqlite3_column_int(stmt, 3) * 10;
+	if (!sql_null(stmt, 4))
+		cur_dive->cylinder[cur_cylinder_index].gasmix.he.permille = sqlite3_column_int(stmt, 4) * 10;
 	cylinder_end();
-	return 0;
 }
 
-extern int dm5_gaschange(void *handle, int columns, char **data, char **column)
+static void dm5_gaschange(sqlite3_stmt *stmt)
 {
 	event_start();
-	if (data[0])
-		cur_event.time.seconds = atoi(data[0]);
-	if (data[1]) {
+	if (!sql_null(stmt, 1))
+		cur_event.time.seconds = sqlite3_column_int(stmt, 1);
+	if (!sql_null(stmt, 2)) {
 		strcpy(cur_event.name, "gaschange");
-		cur_event.value = atof(data[1]);
+		cur_event.value = sqlite3_column_double(stmt, 2);
 	}
 	event_end();
+}
 
-	return 0;
+static void dm4_tag(sqlite3_stmt *stmt)
+{
+	if (!sql_null(stmt, 1))
+		taglist_add_tag(&cur_dive->tag_list, sql_text(stmt, 1));
 }
 
-extern int dm4_tags(void *handle, int columns, char **data, char **column)
+/* utf8_string() trims its buffer in place, so give it a copy of the column */
+static void sql_string(sqlite3_stmt *stmt, int col, void *res)
 {
-	if (data[0])
-		taglist_add_tag(&cur_dive->tag_list, data[0]);
+	char *buffer = copy_string(sql_text(stmt, col));
 
-	return 0;
+	if (buffer) {
+		utf8_string(buffer, res);
+		free(buffer);
+	}
+}
+
+/*
+ * DM4 stores the profile as separate depth, temperature and pressure
+ * blobs (columns 17 to 19 of the dive query), one value per interval.
+ */
+static void dm4_samples(sqlite3_stmt *stmt, int interval)
+{
+	int i;
+	const float *profileBlob = sqlite3_column_blob(stmt, 17);
+	int profileSize = sqlite3_column_bytes(stmt, 17) / sizeof(float);
+	const unsigned char *tempBlob = sqlite3_column_blob(stmt, 18);
+	int tempSize = sqlite3_column_bytes(stmt, 18);
+	const int *pressureBlob = sqlite3_column_blob(stmt, 19);
+	int pressureSize = sqlite3_column_bytes(stmt, 19) / sizeof(int);
+
+	for (i = 0; interval && i * interval < cur_dive->duration.seconds; i++) {
+		sample_start();
+		cur_sample->time.seconds = i * interval;
+		if (i < profileSize)
+			cur_sample->depth.mm = profileBlob[i] * 1000;
+		else
+			cur_sample->depth.mm = cur_dive->dc.maxdepth.mm;
+
+		if (i < tempSize)
+			cur_sample->temperature.mkelvin = C_to_mkelvin(tempBlob[i]);
+		if (i < pressureSize)
+			cur_sample->cylinderpressure.mbar = pressureBlob[i];
+		sample_end();
+	}
 }
 
-extern int dm4_dive(void *param, int columns, char **data, char **column)
+static int dm4_dive(sqlite3_stmt *stmt, struct sqlite_cursor *cursor)
 {
-	int i, interval, retval = 0;
-	sqlite3 *handle = (sqlite3 *)param;
-	float *profileBlob;
-	unsigned char *tempBlob;
-	int *pressureBlob;
-	char *err = NULL;
-	char get_events_template[] = "select * from Mark where DiveId = %d";
-	char get_tags_template[] = "select Text from DiveTag where DiveId = %d";
-	char get_events[64];
+	sqlite3_int64 id = sqlite3_column_int64(stmt, 0);
 
 	dive_start();
-	cur_dive->number = atoi(data[0]);
+	cur_dive->number = id;
 
-	cur_dive->when = (time_t)(atol(data[1]));
-	if (data[2])
-		utf8_string(data[2], &cur_dive->notes);
+	cur_dive->when = (time_t)sqlite3_column_int64(stmt, 1);
+	if (!sql_null(stmt, 2))
+		sql_string(stmt, 2, &cur_dive->notes);
 
 	/*
 	 * DM4 stores Duration and DiveTime. It looks like DiveTime is
 	 * 10 to 60 seconds shorter than Duration. However, I have no
 	 * idea what is the difference and which one should be used.
-	 * Duration = data[3]
-	 * DiveTime = data[15]
+	 * Duration = column 3
+	 * DiveTime = column 15
 	 */
-	if (data[3])
-		cur_dive->duration.seconds = atoi(data[3]);
-	if (data[15])
-		cur_dive->dc.duration.seconds = atoi(data[15]);
+	if (!sql_null(stmt, 3))
+		cur_dive->duration.seconds = sqlite3_column_int(stmt, 3);
+	if (!sql_null(stmt, 15))
+		cur_dive->dc.duration.seconds = sqlite3_column_int(stmt, 15);
 
 	/*
 	 * TODO: the deviceid hash should be calculated here.
 	 */
 	settings_start();
 	dc_settings_start();
-	if (data[4])
-		utf8_string(data[4], &cur_settings.dc.serial_nr);
-	if (data[5])
-		utf8_string(data[5], &cur_settings.dc.model);
+	if (!sql_null(stmt, 4))
+		sql_string(stmt, 4, &cur_settings.dc.serial_nr);
+	if (!sql_null(stmt, 5))
+		sql_string(stmt, 5, &cur_settings.dc.model);
 
 	cur_settings.dc.deviceid = 0xffffffff;
 	dc_settings_end();
 	settings_end();
 
-	if (data[6])
-		cur_dive->dc.maxdepth.mm = atof(data[6]) * 1000;
-	if (data[8])
-		cur_dive->dc.airtemp.mkelvin = C_to_mkelvin(atoi(data[8]));
-	if (data[9])
-		cur_dive->dc.watertemp.mkelvin = C_to_mkelvin(atoi(data[9]));
+	if (!sql_null(stmt, 6))
+		cur_dive->dc.maxdepth.mm = sqlite3_column_double(stmt, 6) * 1000;
+	if (!sql_null(stmt, 8))
+		cur_dive->dc.airtemp.mkelvin = C_to_mkelvin(sqlite3_column_int(stmt, 8));
+	if (!sql_null(stmt, 9))
+		cur_dive->dc.watertemp.mkelvin = C_to_mkelvin(sqlite3_column_int(stmt, 9));
 
 	/*
 	 * TODO: handle multiple cylinders
 	 */
 	cylinder_start();
-	if (data[22] && atoi(data[22]) > 0)
-		cur_dive->cylinder[cur_cylinder_index].start.mbar = atoi(data[22]);
-	else if (data[10] && atoi(data[10]) > 0)
-		cur_dive->cylinder[cur_cylinder_index].start.mbar = atoi(data[10]);
-	if (data[23] && atoi(data[23]) > 0)
-		cur_dive->cylinder[cur_cylinder_index].end.mbar = (atoi(data[23]));
-	if (data[11] && atoi(data[11]) > 0)
-		cur_dive->cylinder[cur_cylinder_index].end.mbar = (atoi(data[11]));
-	if (data[12])
-		cur_dive->cylinder[cur_cylinder_index].type.size.mliter = (atof(data[12])) * 1000;
-	if (data[13])
-		cur_dive->cylinder[cur_cylinder_index].type.workingpressure.mbar = (atoi(data[13]));
-	if (data[20])
-		cur_dive->cylinder[cur_cylinder_index].gasmix.o2.permille = atoi(data[20]) * 10;
-	if (data[21])
-		cur_dive->cylinder[cur_cylinder_index].gasmix.he.permille = atoi(data[21]) * 10;
+	if (sqlite3_column_int(stmt, 22) > 0)
+		cur_dive->cylinder[cur_cylinder_index].start.mbar = sqlite3_column_int(stmt, 22);
+	else if (sqlite3_column_int(stmt, 10) > 0)
+		cur_dive->cylinder[cur_cylinder_index].start.mbar = sqlite3_column_int(stmt, 10);
+	if (sqlite3_column_int(stmt, 23) > 0)
+		cur_dive->cylinder[cur_cylinder_index].end.mbar = sqlite3_column_int(stmt, 23);
+	if (sqlite3_column_int(stmt, 11) > 0)
+		cur_dive->cylinder[cur_cylinder_index].end.mbar = sqlite3_column_int(stmt, 11);
+	if (!sql_null(stmt, 12))
+		cur_dive->cylinder[cur_cylinder_index].type.size.mliter = sqlite3_column_double(stmt, 12) * 1000;
+	if (!sql_null(stmt, 13))
+		cur_dive->cylinder[cur_cylinder_index].type.workingpressure.mbar = sqlite3_column_int(stmt, 13);
+	if (!sql_null(stmt, 20))
+		cur_dive->cylinder[cur_cylinder_index].gasmix.o2.permille = sqlite3_column_int(stmt, 20) * 10;
+	if (!sql_null(stmt, 21))
+		cur_dive->cylinder[cur_cylinder_index].gasmix.he.permille = sqlite3_column_int(stmt, 21) * 10;
 	cylinder_end();
 
-	if (data[14])
-		cur_dive->dc.surface_pressure.mbar = (atoi(data[14]) * 1000);
-
-	interval = data[16] ? atoi(data[16]) : 0;
-	profileBlob = (float *)data[17];
-	tempBlob = (unsigned char *)data[18];
-	pressureBlob = (int *)data[19];
-	for (i = 0; interval && i * interval < cur_dive->duration.seconds; i++) {
-		sample_start();
-		cur_sample->time.seconds = i * interval;
-		if (profileBlob)
-			cur_sample->depth.mm = profileBlob[i] * 1000;
-		else
-			cur_sample->depth.mm = cur_dive->dc.maxdepth.mm;
-
-		if (data[18] && data[18][0])
-			cur_sample->temperature.mkelvin = C_to_mkelvin(tempBlob[i]);
-		if (data[19] && data[19][0])
-			cur_sample->cylinderpressure.mbar = pressureBlob[i];
-		sample_end();
-	}
+	if (!sql_null(stmt, 14))
+		cur_dive->dc.surface_pressure.mbar = sqlite3_column_int(stmt, 14) * 1000;
 
-	snprintf(get_events, sizeof(get_events) - 1, get_events_template, cur_dive->number);
-	retval = sqlite3_exec(handle, get_events, &dm4_events, 0, &err);
-	if (retval != SQLITE_OK) {
-		fprintf(stderr, "%s", translate("gettextFromC", "Database query dm4_events failed.\n"));
-		return 1;
-	}
+	dm4_samples(stmt, sqlite3_column_int(stmt, 16));
 
-	snprintf(get_events, sizeof(get_events) - 1, get_tags_template, cur_dive->number);
-	retval = sqlite3_exec(handle, get_events, &dm4_tags, 0, &err);
-	if (retval != SQLITE_OK) {
-		fprintf(stderr, "%s", translate("gettextFromC", "Database query dm4_tags failed.\n"));
+	if (sqlite_cursor_rows(&cursor[0], id, dm4_event) ||
+	    sqlite_cursor_rows(&cursor[1], id, dm4_tag))
 		return 1;
-	}
 
 	dive_end();
 
-	/*
-	for (i=0; i<columns;++i) {
-		fprintf(stderr, "%s\t", column[i]);
-	}
-	fprintf(stderr, "\n");
-	for (i=0; i<columns;++i) {
-		fprintf(stderr, "%s\t", data[i]);
-	}
-	fprintf(stderr, "\n");
-	//exit(0);
-	*/
 	return SQLITE_OK;
 }
 
-extern int dm5_dive(void *param, int columns, char **data, char **column)
+static int dm5_dive(sqlite3_stmt *stmt, struct sqlite_cursor *cursor)
 {
-	int i, interval, retval = 0, block_size;
-	sqlite3 *handle = (sqlite3 *)param;
-	unsigned const char *sampleBlob;
-	char *err = NULL;
-	char get_events_template[] = "select * from Mark where DiveId = %d";
-	char get_tags_template[] = "select Text from DiveTag where DiveId = %d";
-	char get_cylinders_template[] = "select * from DiveMixture where DiveId = %d";
-	char get_gaschange_template[] = "select GasChangeTime,Oxygen,Helium from DiveGasChange join DiveMixture on DiveGasChange.DiveMixtureId=DiveMixture.DiveMixtureId where DiveId = %d";
-	char get_events[512];
+	int i, interval, block_size = 16, blob_size;
+	sqlite3_int64 id = sqlite3_column_int64(stmt, 0);
+	const unsigned char *sampleBlob;
 
 	dive_start();
-	cur_dive->number = atoi(data[0]);
+	cur_dive->number = id;
 
-	cur_dive->when = (time_t)(atol(data[1]));
-	if (data[2])
-		utf8_string(data[2], &cur_dive->notes);
+	cur_dive->when = (time_t)sqlite3_column_int64(stmt, 1);
+	if (!sql_null(stmt, 2))
+		sql_string(stmt, 2, &cur_dive->notes);
 
-	if (data[3])
-		cur_dive->duration.seconds = atoi(data[3]);
-	if (data[15])
-		cur_dive->dc.duration.seconds = atoi(data[15]);
+	if (!sql_null(stmt, 3))
+		cur_dive->duration.seconds = sqlite3_column_int(stmt, 3);
+	if (!sql_null(stmt, 15))
+		cur_dive->dc.duration.seconds = sqlite3_column_int(stmt, 15);
 
 	/*
 	 * TODO: the deviceid hash should be calculated here.
 	 */
 	settings_start();
 	dc_settings_start();
-	if (data[4]) {
-		utf8_string(data[4], &cur_settings.dc.serial_nr);
-		cur_settings.dc.deviceid = atoi(data[4]);
+	if (!sql_null(stmt, 4)) {
+		sql_string(stmt, 4, &cur_settings.dc.serial_nr);
+		cur_settings.dc.deviceid = sqlite3_column_int(stmt, 4);
 	}
-	if (data[5])
-		utf8_string(data[5], &cur_settings.dc.model);
+	if (!sql_null(stmt, 5))
+		sql_string(stmt, 5, &cur_settings.dc.model);
 
 	dc_settings_end();
 	settings_end();
 
-	if (data[6])
-		cur_dive->dc.maxdepth.mm = atof(data[6]) * 1000;
-	if (data[8])
-		cur_dive->dc.airtemp.mkelvin = C_to_mkelvin(atoi(data[8]));
-	if (data[9])
-		cur_dive->dc.watertemp.mkelvin = C_to_mkelvin(atoi(data[9]));
+	if (!sql_null(stmt, 6))
+		cur_dive->dc.maxdepth.mm = sqlite3_column_double(stmt, 6) * 1000;
+	if (!sql_null(stmt, 8))
+		cur_dive->dc.airtemp.mkelvin = C_to_mkelvin(sqlite3_column_int(stmt, 8));
+	if (!sql_null(stmt, 9))
+		cur_dive->dc.watertemp.mkelvin = C_to_mkelvin(sqlite3_column_int(stmt, 9));
 
-	if (data[4]) {
-		cur_dive->dc.deviceid = atoi(data[4]);
-	}
-	if (data[5])
-		utf8_string(data[5], &cur_dive->dc.model);
+	if (!sql_null(stmt, 4))
+		cur_dive->dc.deviceid = sqlite3_column_int(stmt, 4);
+	if (!sql_null(stmt, 5))
+		sql_string(stmt, 5, &cur_dive->dc.model);
 
-	snprintf(get_events, sizeof(get_events) - 1, get_cylinders_template, cur_dive->number);
-	retval = sqlite3_exec(handle, get_events, &dm5_cylinders, 0, &err);
-	if (retval != SQLITE_OK) {
-		fprintf(stderr, "%s", translate("gettextFromC", "Database query dm5_cylinders failed.\n"));
+	if (sqlite_cursor_rows(&cursor[0], id, dm5_cylinder))
 		return 1;
-	}
 
-	if (data[14])
-		cur_dive->dc.surface_pressure.mbar = (atoi(data[14]) / 100);
+	if (!sql_null(stmt, 14))
+		cur_dive->dc.surface_pressure.mbar = sqlite3_column_int(stmt, 14) / 100;
 
-	interval = data[16] ? atoi(data[16]) : 0;
-	sampleBlob = (unsigned const char *)data[24];
+	interval = sqlite3_column_int(stmt, 16);
+	sampleBlob = sqlite3_column_blob(stmt, 24);
+	blob_size = sqlite3_column_bytes(stmt, 24);
 
 	if (sampleBlob) {
 		switch (sampleBlob[0]) {
@@ -2376,9 +2439,14 @@ extern int dm5_dive(void *param, int columns, char **data, char **column)
 	}
 
 	for (i = 0; interval && sampleBlob && i * interval < cur_dive->duration.seconds; i++) {
-		float *depth = (float *)&sampleBlob[i * block_size + 3];
-		int32_t temp = (sampleBlob[i * block_size + 10] << 8) + sampleBlob[i * block_size + 11];
-		int32_t pressure = (sampleBlob[i * block_size + 9] << block_size) + (sampleBlob[i * block_size + 8] << 8) + sampleBlob[i * block_size + 7];
+		const unsigned char *block = sampleBlob + i * block_size;
+		float *depth = (float *)&block[3];
+		int32_t temp, pressure;
+
+		if (i * block_size + 12 > blob_size)
+			break;
+		temp = (block[10] << 8) + block[11];
+		pressure = (block[9] << block_size) + (block[8] << 8) + block[7];
 
 		sample_start();
 		cur_sample->time.seconds = i * interval;
@@ -2398,51 +2466,13 @@ extern int dm5_dive(void *param, int columns, char **data, char **column)
 	 * Log was converted from DM4, thus we need to parse the profile
 	 * from DM4 format
 	 */
+	if (i == 0)
+		dm4_samples(stmt, interval);
 
-	if (i == 0) {
-		float *profileBlob;
-		unsigned char *tempBlob;
-		int *pressureBlob;
-
-		profileBlob = (float *)data[17];
-		tempBlob = (unsigned char *)data[18];
-		pressureBlob = (int *)data[19];
-		for (i = 0; interval && i * interval < cur_dive->duration.seconds; i++) {
-			sample_start();
-			cur_sample->time.seconds = i * interval;
-			if (profileBlob)
-				cur_sample->depth.mm = profileBlob[i] * 1000;
-			else
-				cur_sample->depth.mm = cur_dive->dc.maxdepth.mm;
-
-			if (data[18] && data[18][0])
-				cur_sample->temperature.mkelvin = C_to_mkelvin(tempBlob[i]);
-			if (data[19] && data[19][0])
-				cur_sample->cylinderpressure.mbar = pressureBlob[i];
-			sample_end();
-		}
-	}
-
-	snprintf(get_events, sizeof(get_events) - 1, get_gaschange_template, cur_dive->number);
-	retval = sqlite3_exec(handle, get_events, &dm5_gaschange, 0, &err);
-	if (retval != SQLITE_OK) {
-		fprintf(stderr, "%s", translate("gettextFromC", "Database query dm5_gaschange failed.\n"));
-		return 1;
-	}
-
-	snprintf(get_events, sizeof(get_events) - 1, get_events_template, cur_dive->number);
-	retval = sqlite3_exec(handle, get_events, &dm4_events, 0, &err);
-	if (retval != SQLITE_OK) {
-		fprintf(stderr, "%s", translate("gettextFromC", "Database query dm4_events failed.\n"));
-		return 1;
-	}
-
-	snprintf(get_events, sizeof(get_events) - 1, get_tags_template, cur_dive->number);
-	retval = sqlite3_exec(handle, get_events, &dm4_tags, 0, &err);
-	if (retval != SQLITE_OK) {
-		fprintf(stderr, "%s", translate("gettextFromC", "Database query dm4_tags failed.\n"));
+	if (sqlite_cursor_rows(&cursor[1], id, dm5_gaschange) ||
+	    sqlite_cursor_rows(&cursor[2], id, dm4_event) ||
+	    sqlite_cursor_rows(&cursor[3], id, dm4_tag))
 		return 1;
-	}
 
 	dive_end();
 
@@ -2453,271 +2483,220 @@ extern int dm5_dive(void *param, int columns, char **data, char **column)
 int parse_dm4_buffer(sqlite3 *handle, const char *url, const char *buffer, int size,
 		     struct dive_table *table)
 {
-	int retval;
-	char *err = NULL;
 	target_table = table;
 
 	/* StartTime is converted from Suunto's nano seconds to standard
 	 * time. We also need epoch, not seconds since year 1. */
-	char get_dives[] = "select D.DiveId,StartTime/10000000-62135596800,Note,Duration,SourceSerialNumber,Source,MaxDepth,SampleInterval,StartTemperature,BottomTemperature,D.StartPressure,D.EndPressure,Size,CylinderWorkPressure,SurfacePressure,DiveTime,SampleInterval,ProfileBlob,TemperatureBlob,PressureBlob,Oxygen,Helium,MIX.StartPressure,MIX.EndPressure FROM Dive AS D JOIN DiveMixture AS MIX ON D.DiveId=MIX.DiveId";
-
-	retval = sqlite3_exec(handle, get_dives, &dm4_dive, handle, &err);
-
-	if (retval != SQLITE_OK) {
-		fprintf(stderr, translate("gettextFromC", "Database query failed '%s'.\n"), url);
-		return 1;
-	}
+	const char get_dives[] = "select D.DiveId,StartTime/10000000-62135596800,Note,Duration,SourceSerialNumber,Source,MaxDepth,SampleInterval,StartTemperature,BottomTemperature,D.StartPressure,D.EndPressure,Size,CylinderWorkPressure,SurfacePressure,DiveTime,SampleInterval,ProfileBlob,TemperatureBlob,PressureBlob,Oxygen,Helium,MIX.StartPressure,MIX.EndPressure FROM Dive AS D JOIN DiveMixture AS MIX ON D.DiveId=MIX.DiveId order by D.DiveId";
+	const char *get_rows[] = {
+		"select DiveId,* from Mark order by DiveId,rowid",
+		"select DiveId,Text from DiveTag order by DiveId,rowid"
+	};
 
-	return 0;
+	return parse_sqlite_dives(handle, url, get_dives, get_rows, 2, dm4_dive);
 }
 
 int parse_dm5_buffer(sqlite3 *handle, const char *url, const char *buffer, int size,
 		     struct dive_table *table)
 {
-	int retval;
-	char *err = NULL;
 	target_table = table;
 
 	/* StartTime is converted from Suunto's nano seconds to standard
 	 * time. We also need epoch, not seconds since year 1. */
-	char get_dives[] = "select DiveId,StartTime/10000000-62135596800,Note,Duration,coalesce(SourceSerialNumber,SerialNumber),Source,MaxDepth,SampleInterval,StartTemperature,BottomTemperature,StartPressure,EndPressure,'','',SurfacePressure,DiveTime,SampleInterval,ProfileBlob,TemperatureBlob,PressureBlob,'','','','',SampleBlob FROM Dive where Deleted is null";
-
-	retval = sqlite3_exec(handle, get_dives, &dm5_dive, handle, &err);
-
-	if (retval != SQLITE_OK) {
-		fprintf(stderr, translate("gettextFromC", "Database query failed '%s'.\n"), url);
-		return 1;
-	}
+	const char get_dives[] = "select DiveId,StartTime/10000000-62135596800,Note,Duration,coalesce(SourceSerialNumber,SerialNumber),Source,MaxDepth,SampleInterval,StartTemperature,BottomTemperature,StartPressure,EndPressure,'','',SurfacePressure,DiveTime,SampleInterval,ProfileBlob,TemperatureBlob,PressureBlob,'','','','',SampleBlob FROM Dive where Deleted is null order by DiveId";
+	const char *get_rows[] = {
+		"select DiveId,* from DiveMixture order by DiveId,rowid",
+		"select DiveMixture.DiveId,GasChangeTime,Oxygen,Helium from DiveGasChange join DiveMixture on DiveGasChange.DiveMixtureId=DiveMixture.DiveMixtureId order by DiveMixture.DiveId,GasChangeTime",
+		"select DiveId,* from Mark order by DiveId,rowid",
+		"select DiveId,Text from DiveTag order by DiveId,rowid"
+	};
 
-	return 0;
+	return parse_sqlite_dives(handle, url, get_dives, get_rows, 4, dm5_dive);
 }
 
-extern int shearwater_cylinders(void *handle, int columns, char **data, char **column)
+static void shearwater_cylinder(sqlite3_stmt *stmt)
 {
 	cylinder_start();
-	if (data[0])
-		cur_dive->cylinder[cur_cylinder_index].gasmix.o2.permille = atof(data[0]) * 1000;
-	if (data[1])
-		cur_dive->cylinder[cur_cylinder_index].gasmix.he.permille = atof(data[1]) * 1000;
+	if (!sql_null(stmt, 1))
+		cur_dive->cylinder[cur_cylinder_index].gasmix.o2.permille = sqlite3_column_double(stmt, 1) * 1000;
+	if (!sql_null(stmt, 2))
+		cur_dive->cylinder[cur_cylinder_index].gasmix.he.permille = sqlite3_column_double(stmt, 2) * 1000;
 	cylinder_end();
-
-	return 0;
 }
 
-extern int shearwater_changes(void *handle, int columns, char **data, char **column)
+static void shearwater_change(sqlite3_stmt *stmt)
 {
 	event_start();
-	if (data[0])
-		cur_event.time.seconds = atoi(data[0]);
-	if (data[1]) {
+	if (!sql_null(stmt, 1))
+		cur_event.time.seconds = sqlite3_column_int(stmt, 1);
+	if (!sql_null(stmt, 2)) {
 		strcpy(cur_event.name, "gaschange");
-		cur_event.value = atof(data[1]) * 100;
+		cur_event.value = sqlite3_column_double(stmt, 2) * 100;
 	}
 	event_end();
-
-	return 0;
 }
 
 
-extern int cobalt_profile_sample(void *handle, int columns, char **data, char **column)
+static void cobalt_profile_sample(sqlite3_stmt *stmt)
 {
 	sample_start();
-	if (data[0])
-		cur_sample->time.seconds = atoi(data[0]);
-	if (data[1])
-		cur_sample->depth.mm = atoi(data[1]);
-	if (data[2])
-		cur_sample->temperature.mkelvin = metric ? C_to_mkelvin(atof(data[2])) : F_to_mkelvin(atof(data[2]));
+	if (!sql_null(stmt, 1))
+		cur_sample->time.seconds = sqlite3_column_int(stmt, 1);
+	if (!sql_null(stmt, 2))
+		cur_sample->depth.mm = sqlite3_column_int(stmt, 2);
+	if (!sql_null(stmt, 3))
+		cur_sample->temperature.mkelvin = metric ? C_to_mkelvin(sqlite3_column_double(stmt, 3)) : F_to_mkelvin(sqlite3_column_double(stmt, 3));
 	sample_end();
-
-	return 0;
 }
 
 
-extern int shearwater_profile_sample(void *handle, int columns, char **data, char **column)
+static void shearwater_profile_sample(sqlite3_stmt *stmt)
 {
 	sample_start();
-	if (data[0])
-		cur_sample->time.seconds = atoi(data[0]);
-	if (data[1])
-		cur_sample->depth.mm = metric ? atof(data[1]) * 1000 : feet_to_mm(atof(data[1]));
-	if (data[2])
-		cur_sample->temperature.mkelvin = metric ? C_to_mkelvin(atof(data[2])) : F_to_mkelvin(atof(data[2]));
-	if (data[3]) {
-		cur_sample->setpoint.mbar = atof(data[3]) * 1000;
+	if (!sql_null(stmt, 1))
+		cur_sample->time.seconds = sqlite3_column_int(stmt, 1);
+	if (!sql_null(stmt, 2))
+		cur_sample->depth.mm = metric ? sqlite3_column_double(stmt, 2) * 1000 : feet_to_mm(sqlite3_column_double(stmt, 2));
+	if (!sql_null(stmt, 3))
+		cur_sample->temperature.mkelvin = metric ? C_to_mkelvin(sqlite3_column_double(stmt, 3)) : F_to_mkelvin(sqlite3_column_double(stmt, 3));
+	if (!sql_null(stmt, 4)) {
+		cur_sample->setpoint.mbar = sqlite3_column_double(stmt, 4) * 1000;
 		cur_dive->dc.divemode = CCR;
 	}
-	if (data[4])
-		cur_sample->ndl.seconds = atoi(data[4]) * 60;
-	if (data[5])
-		cur_sample->cns = atoi(data[5]);
-	if (data[6])
-		cur_sample->stopdepth.mm = metric ? atoi(data[6]) * 1000 : feet_to_mm(atoi(data[6]));
-
-	/* We don't actually have data[3], but it should appear in the
-	 * SQL query at some point.
-	if (data[3])
-		cur_sample->cylinderpressure.mbar = metric ? atoi(data[3]) * 1000 : psi_to_mbar(atoi(data[3]));
+	if (!sql_null(stmt, 5))
+		cur_sample->ndl.seconds = sqlite3_column_int(stmt, 5) * 60;
+	if (!sql_null(stmt, 6))
+		cur_sample->cns = sqlite3_column_int(stmt, 6);
+	if (!sql_null(stmt, 7))
+		cur_sample->stopdepth.mm = metric ? sqlite3_column_int(stmt, 7) * 1000 : feet_to_mm(sqlite3_column_int(stmt, 7));
+
+	/* We don't actually have the tank pressure, but it should appear
+	 * in the SQL query at some point.
+	if (!sql_null(stmt, 8))
+		cur_sample->cylinderpressure.mbar = metric ? sqlite3_column_int(stmt, 8) * 1000 : psi_to_mbar(sqlite3_column_int(stmt, 8));
 	 */
 	sample_end();
-
-	return 0;
 }
 
-extern int shearwater_dive(void *param, int columns, char **data, char **column)
+static int shearwater_dive(sqlite3_stmt *stmt, struct sqlite_cursor *cursor)
 {
-	int retval = 0;
-	sqlite3 *handle = (sqlite3 *)param;
-	char *err = NULL;
-	char get_profile_template[] = "select currentTime,currentDepth,waterTemp,averagePPO2,currentNdl,CNSPercent,decoCeiling from dive_log_records where diveLogId = %d";
-	char get_cylinder_template[] = "select fractionO2,fractionHe from dive_log_records where diveLogId = %d group by fractionO2,fractionHe";
-	char get_changes_template[] = "select a.currentTime,a.fractionO2,a.fractionHe from dive_log_records as a,dive_log_records as b where a.diveLogId = %d and b.diveLogId = %d and (a.id - 1) = b.id and (a.fractionO2 != b.fractionO2 or a.fractionHe != b.fractionHe) union select min(currentTime),fractionO2,fractionHe from dive_log_records";
-	char get_buffer[1024];
+	sqlite3_int64 id = sqlite3_column_int64(stmt, 0);
 
 	dive_start();
-	cur_dive->number = atoi(data[0]);
+	cur_dive->number = id;
 
-	cur_dive->when = (time_t)(atol(data[1]));
+	cur_dive->when = (time_t)sqlite3_column_int64(stmt, 1);
 
-	if (data[2])
-		add_dive_site(data[2], cur_dive);
-	if (data[3])
-		utf8_string(data[3], &cur_dive->buddy);
-	if (data[4])
-		utf8_string(data[4], &cur_dive->notes);
+	if (!sql_null(stmt, 2)) {
+		char *site = copy_string(sql_text(stmt, 2));
+		add_dive_site(site, cur_dive);
+		free(site);
+	}
+	if (!sql_null(stmt, 3))
+		sql_string(stmt, 3, &cur_dive->buddy);
+	if (!sql_null(stmt, 4))
+		sql_string(stmt, 4, &cur_dive->notes);
 
-	metric = atoi(data[5]) == 1 ? 0 : 1;
+	metric = sqlite3_column_int(stmt, 5) == 1 ? 0 : 1;
 
 	/* TODO: verify that metric calculation is correct */
-	if (data[6])
-		cur_dive->dc.maxdepth.mm = metric ? atof(data[6]) * 1000 : feet_to_mm(atof(data[6]));
+	if (!sql_null(stmt, 6))
+		cur_dive->dc.maxdepth.mm = metric ? sqlite3_column_double(stmt, 6) * 1000 : feet_to_mm(sqlite3_column_double(stmt, 6));
 
-	if (data[7])
-		cur_dive->dc.duration.seconds = atoi(data[7]) * 60;
+	if (!sql_null(stmt, 7))
+		cur_dive->dc.duration.seconds = sqlite3_column_int(stmt, 7) * 60;
 
-	if (data[8])
-		cur_dive->dc.surface_pressure.mbar = atoi(data[8]);
+	if (!sql_null(stmt, 8))
+		cur_dive->dc.surface_pressure.mbar = sqlite3_column_int(stmt, 8);
 	/*
 	 * TODO: the deviceid hash should be calculated here.
 	 */
 	settings_start();
 	dc_settings_start();
-	if (data[9])
-		utf8_string(data[9], &cur_settings.dc.serial_nr);
-	if (data[10])
-		utf8_string(data[10], &cur_settings.dc.model);
+	if (!sql_null(stmt, 9))
+		sql_string(stmt, 9, &cur_settings.dc.serial_nr);
+	if (!sql_null(stmt, 10))
+		sql_string(stmt, 10, &cur_settings.dc.model);
 
 	cur_settings.dc.deviceid = 0xffffffff;
 	dc_settings_end();
 	settings_end();
 
-	snprintf(get_buffer, sizeof(get_buffer) - 1, get_cylinder_template, cur_dive->number);
-	retval = sqlite3_exec(handle, get_buffer, &shearwater_cylinders, 0, &err);
-	if (retval != SQLITE_OK) {
-		fprintf(stderr, "%s", translate("gettextFromC", "Database query shearwater_cylinders failed.\n"));
-		return 1;
-	}
-
-	snprintf(get_buffer, sizeof(get_buffer) - 1, get_changes_template, cur_dive->number, cur_dive->number);
-	retval = sqlite3_exec(handle, get_buffer, &shearwater_changes, 0, &err);
-	if (retval != SQLITE_OK) {
-		fprintf(stderr, "%s", translate("gettextFromC", "Database query shearwater_changes failed.\n"));
+	if (sqlite_cursor_rows(&cursor[0], id, shearwater_cylinder) ||
+	    sqlite_cursor_rows(&cursor[1], id, shearwater_change) ||
+	    sqlite_cursor_rows(&cursor[2], id, shearwater_profile_sample))
 		return 1;
-	}
-
-	snprintf(get_buffer, sizeof(get_buffer) - 1, get_profile_template, cur_dive->number);
-	retval = sqlite3_exec(handle, get_buffer, &shearwater_profile_sample, 0, &err);
-	if (retval != SQLITE_OK) {
-		fprintf(stderr, "%s", translate("gettextFromC", "Database query shearwater_profile_sample failed.\n"));
-		return 1;
-	}
 
 	dive_end();
 
 	return SQLITE_OK;
 }
 
-extern int cobalt_cylinders(void *handle, int columns, char **data, char **column)
+static void cobalt_cylinder(sqlite3_stmt *stmt)
 {
 	cylinder_start();
-	if (data[0])
-		cur_dive->cylinder[cur_cylinder_index].gasmix.o2.permille = atoi(data[0]) * 10;
-	if (data[1])
-		cur_dive->cylinder[cur_cylinder_index].gasmix.he.permille = atoi(data[1]) * 10;
-	if (data[2])
-		cur_dive->cylinder[cur_cylinder_index].start.mbar = psi_to_mbar(atoi(data[2]));
-	if (data[3])
-		cur_dive->cylinder[cur_cylinder_index].end.mbar = psi_to_mbar(atoi(data[3]));
-	if (data[4])
-		cur_dive->cylinder[cur_cylinder_index].type.size.mliter = atoi(data[4]) * 100;
-	if (data[5])
-		cur_dive->cylinder[cur_cylinder_index].gas_used.mliter = atoi(data[5]) * 1000;
+	if (!sql_null(stmt, 1))
+		cur_dive->cylinder[cur_cylinder_index].gasmix.o2.permille = sqlite3_column_int(stmt, 1) * 10;
+	if (!sql_null(stmt, 2))
+		cur_dive->cylinder[cur_cylinder_index].gasmix.he.permille = sqlite3_column_int(stmt, 2) * 10;
+	if (!sql_null(stmt, 3))
+		cur_dive->cylinder[cur_cylinder_index].start.mbar = psi_to_mbar(sqlite3_column_int(stmt, 3));
+	if (!sql_null(stmt, 4))
+		cur_dive->cylinder[cur_cylinder_index].end.mbar = psi_to_mbar(sqlite3_column_int(stmt, 4));
+	if (!sql_null(stmt, 5))
+		cur_dive->cylinder[cur_cylinder_index].type.size.mliter = sqlite3_column_int(stmt, 5) * 100;
+	if (!sql_null(stmt, 6))
+		cur_dive->cylinder[cur_cylinder_index].gas_used.mliter = sqlite3_column_int(stmt, 6) * 1000;
 	cylinder_end();
-
-	return 0;
 }
 
-extern int cobalt_buddies(void *handle, int columns, char **data, char **column)
+static void cobalt_buddy(sqlite3_stmt *stmt)
 {
-	if (data[0])
-		utf8_string(data[0], &cur_dive->buddy);
-
-	return 0;
+	if (!sql_null(stmt, 1))
+		sql_string(stmt, 1, &cur_dive->buddy);
 }
 
 /*
- * We still need to figure out how to map free text visibility to
- * Subsurface star rating.
+ * We still need to figure out how to map free text visibility
+ * (List type 3) to Subsurface star rating.
  */
 
-extern int cobalt_visibility(void *handle, int columns, char **data, char **column)
-{
-	return 0;
-}
-
-extern int cobalt_location(void *handle, int columns, char **data, char **column)
+/* The location (List type 0) and the site (type 1) make up the dive site name */
+static void cobalt_location(sqlite3_stmt *stmt)
 {
 	static char *location = NULL;
-	if (data[0]) {
+	char *data = sql_text(stmt, 1);
+
+	if (data) {
 		if (location) {
-			char *tmp = malloc(strlen(location) + strlen(data[0]) + 4);
+			char *tmp = malloc(strlen(location) + strlen(data) + 4);
 			if (!tmp)
-				return -1;
-			sprintf(tmp, "%s / %s", location, data[0]);
+				return;
+			sprintf(tmp, "%s / %s", location, data);
 			free(location);
 			location = NULL;
 			cur_dive->dive_site_uuid = create_dive_site(tmp);
 			free(tmp);
 		} else {
-			location = strdup(data[0]);
+			location = strdup(data);
 		}
 	}
-	return 0;
 }
 
 
-extern int cobalt_dive(void *param, int columns, char **data, char **column)
+static int cobalt_dive(sqlite3_stmt *stmt, struct sqlite_cursor *cursor)
 {
-	int retval = 0;
-	sqlite3 *handle = (sqlite3 *)param;
-	char *err = NULL;
-	char get_profile_template[] = "select runtime*60,(DepthPressure*10000/SurfacePressure)-10000,p.Temperature from Dive AS d JOIN TrackPoints AS p ON d.Id=p.DiveId where d.Id=%d";
-	char get_cylinder_template[] = "select FO2,FHe,StartingPressure,EndingPressure,TankSize,TankPressure,TotalConsumption from GasMixes where DiveID=%d and StartingPressure>0 group by FO2,FHe";
-	char get_buddy_template[] = "select l.Data from Items AS i, List AS l ON i.Value1=l.Id where i.DiveId=%d and l.Type=4";
-	char get_visibility_template[] = "select l.Data from Items AS i, List AS l ON i.Value1=l.Id where i.DiveId=%d and l.Type=3";
-	char get_location_template[] = "select l.Data from Items AS i, List AS l ON i.Value1=l.Id where i.DiveId=%d and l.Type=0";
-	char get_site_template[] = "select l.Data from Items AS i, List AS l ON i.Value1=l.Id where i.DiveId=%d and l.Type=1";
-	char get_buffer[1024];
+	sqlite3_int64 id = sqlite3_column_int64(stmt, 0);
 
 	dive_start();
-	cur_dive->number = atoi(data[0]);
+	cur_dive->number = id;
 
-	cur_dive->when = (time_t)(atol(data[1]));
+	cur_dive->when = (time_t)sqlite3_column_int64(stmt, 1);
 
-	if (data[4])
-		utf8_string(data[4], &cur_dive->notes);
+	if (!sql_null(stmt, 4))
+		sql_string(stmt, 4, &cur_dive->notes);
 
-	/* data[5] should have information on Units used, but I cannot
+	/* Column 5 should have information on Units used, but I cannot
 	 * parse it at all based on the sample log I have received. The
 	 * temperatures in the samples are all Imperial, so let's go by
 	 * that.
@@ -2726,74 +2705,38 @@ extern int cobalt_dive(void *param, int columns, char **data, char **column)
 	metric = 0;
 
 	/* Cobalt stores the pressures, not the depth */
-	if (data[6])
-		cur_dive->dc.maxdepth.mm = atoi(data[6]);
+	if (!sql_null(stmt, 6))
+		cur_dive->dc.maxdepth.mm = sqlite3_column_int(stmt, 6);
 
-	if (data[7])
-		cur_dive->dc.duration.seconds = atoi(data[7]);
+	if (!sql_null(stmt, 7))
+		cur_dive->dc.duration.seconds = sqlite3_column_int(stmt, 7);
 
-	if (data[8])
-		cur_dive->dc.surface_pressure.mbar = atoi(data[8]);
+	if (!sql_null(stmt, 8))
+		cur_dive->dc.surface_pressure.mbar = sqlite3_column_int(stmt, 8);
 	/*
 	 * TODO: the deviceid hash should be calculated here.
 	 */
 	settings_start();
 	dc_settings_start();
-	if (data[9]) {
-		utf8_string(data[9], &cur_settings.dc.serial_nr);
-		cur_settings.dc.deviceid = atoi(data[9]);
+	if (!sql_null(stmt, 9)) {
+		sql_string(stmt, 9, &cur_settings.dc.serial_nr);
+		cur_settings.dc.deviceid = sqlite3_column_int(stmt, 9);
 		cur_settings.dc.model = strdup("Cobalt import");
 	}
 
 	dc_settings_end();
 	settings_end();
 
-	if (data[9]) {
-		cur_dive->dc.deviceid = atoi(data[9]);
+	if (!sql_null(stmt, 9)) {
+		cur_dive->dc.deviceid = sqlite3_column_int(stmt, 9);
 		cur_dive->dc.model = strdup("Cobalt import");
 	}
 
-	snprintf(get_buffer, sizeof(get_buffer) - 1, get_cylinder_template, cur_dive->number);
-	retval = sqlite3_exec(handle, get_buffer, &cobalt_cylinders, 0, &err);
-	if (retval != SQLITE_OK) {
-		fprintf(stderr, "%s", translate("gettextFromC", "Database query cobalt_cylinders failed.\n"));
+	if (sqlite_cursor_rows(&cursor[0], id, cobalt_cylinder) ||
+	    sqlite_cursor_rows(&cursor[1], id, cobalt_buddy) ||
+	    sqlite_cursor_rows(&cursor[2], id, cobalt_location) ||
+	    sqlite_cursor_rows(&cursor[3], id, cobalt_profile_sample))
 		return 1;
-	}
-
-	snprintf(get_buffer, sizeof(get_buffer) - 1, get_buddy_template, cur_dive->number);
-	retval = sqlite3_exec(handle, get_buffer, &cobalt_buddies, 0, &err);
-	if (retval != SQLITE_OK) {
-		fprintf(stderr, "%s", translate("gettextFromC", "Database query cobalt_buddies failed.\n"));
-		return 1;
-	}
-
-	snprintf(get_buffer, sizeof(get_buffer) - 1, get_visibility_template, cur_dive->number);
-	retval = sqlite3_exec(handle, get_buffer, &cobalt_visibility, 0, &err);
-	if (retval != SQLITE_OK) {
-		fprintf(stderr, "%s", translate("gettextFromC", "Database query cobalt_visibility failed.\n"));
-		return 1;
-	}
-
-	snprintf(get_buffer, sizeof(get_buffer) - 1, get_location_template, cur_dive->number);
-	retval = sqlite3_exec(handle, get_buffer, &cobalt_location, 0, &err);
-	if (retval != SQLITE_OK) {
-		fprintf(stderr, "%s", translate("gettextFromC", "Database query cobalt_location failed.\n"));
-		return 1;
-	}
-
-	snprintf(get_buffer, sizeof(get_buffer) - 1, get_site_template, cur_dive->number);
-	retval = sqlite3_exec(handle, get_buffer, &cobalt_location, 0, &err);
-	if (retval != SQLITE_OK) {
-		fprintf(stderr, "%s", translate("gettextFromC", "Database query cobalt_location (site) failed.\n"));
-		return 1;
-	}
-
-	snprintf(get_buffer, sizeof(get_buffer) - 1, get_profile_template, cur_dive->number);
-	retval = sqlite3_exec(handle, get_buffer, &cobalt_profile_sample, 0, &err);
-	if (retval != SQLITE_OK) {
-		fprintf(stderr, "%s", translate("gettextFromC", "Database query cobalt_profile_sample failed.\n"));
-		return 1;
-	}
 
 	dive_end();
 
@@ -2804,42 +2747,37 @@ extern int cobalt_dive(void *param, int columns, char **data, char **column)
 int parse_shearwater_buffer(sqlite3 *handle, const char *url, const char *buffer, int size,
 			    struct dive_table *table)
 {
-	int retval;
-	char *err = NULL;
 	target_table = table;
 
-	char get_dives[] = "select i.diveId,timestamp,location||' / '||site,buddy,notes,imperialUnits,maxDepth,maxTime,startSurfacePressure,computerSerial,computerModel FROM dive_info AS i JOIN dive_logs AS l ON i.diveId=l.diveId";
-
-	retval = sqlite3_exec(handle, get_dives, &shearwater_dive, handle, &err);
+	const char get_dives[] = "select i.diveId,timestamp,location||' / '||site,buddy,notes,imperialUnits,maxDepth,maxTime,startSurfacePressure,computerSerial,computerModel FROM dive_info AS i JOIN dive_logs AS l ON i.diveId=l.diveId order by i.diveId";
+	/* a gas change is a record whose mix differs from the previous one of the same dive,
+	 * and every dive starts with the mix of its first record */
+	const char *get_rows[] = {
+		"select diveLogId,fractionO2,fractionHe from dive_log_records group by diveLogId,fractionO2,fractionHe order by diveLogId,fractionO2,fractionHe",
+		"select a.diveLogId,a.currentTime,a.fractionO2,a.fractionHe from dive_log_records as a join dive_log_records as b on (a.id - 1) = b.id and a.diveLogId = b.diveLogId where a.fractionO2 != b.fractionO2 or a.fractionHe != b.fractionHe union select diveLogId,min(currentTime),fractionO2,fractionHe from dive_log_records group by diveLogId order by 1,2",
+		"select diveLogId,currentTime,currentDepth,waterTemp,averagePPO2,currentNdl,CNSPercent,decoCeiling from dive_log_records order by diveLogId,id"
+	};
 
-	if (retval != SQLITE_OK) {
-		fprintf(stderr, translate("gettextFromC", "Database query failed '%s'.\n"), url);
-		return 1;
-	}
-
-	return 0;
+	return parse_sqlite_dives(handle, url, get_dives, get_rows, 3, shearwater_dive);
 }
 
 int parse_cobalt_buffer(sqlite3 *handle, const char *url, const char *buffer, int size,
 			    struct dive_table *table)
 {
-	int retval;
-	char *err = NULL;
 	target_table = table;
 
-	char get_dives[] = "select Id,strftime('%s',DiveStartTime),LocationId,'buddy','notes',Units,(MaxDepthPressure*10000/SurfacePressure)-10000,DiveMinutes,SurfacePressure,SerialNumber,'model' from Dive where IsViewDeleted = 0";
-
-	retval = sqlite3_exec(handle, get_dives, &cobalt_dive, handle, &err);
+	const char get_dives[] = "select Id,strftime('%s',DiveStartTime),LocationId,'buddy','notes',Units,(MaxDepthPressure*10000/SurfacePressure)-10000,DiveMinutes,SurfacePressure,SerialNumber,'model' from Dive where IsViewDeleted = 0 order by Id";
+	const char *get_rows[] = {
+		"select DiveID,FO2,FHe,StartingPressure,EndingPressure,TankSize,TankPressure,TotalConsumption from GasMixes where StartingPressure>0 group by DiveID,FO2,FHe order by DiveID,FO2,FHe",
+		"select i.DiveId,l.Data from Items AS i, List AS l ON i.Value1=l.Id where l.Type=4 order by i.DiveId",
+		"select i.DiveId,l.Data from Items AS i, List AS l ON i.Value1=l.Id where l.Type in (0,1) order by i.DiveId,l.Type",
+		"select d.Id,runtime*60,(DepthPressure*10000/SurfacePressure)-10000,p.Temperature from Dive AS d JOIN TrackPoints AS p ON d.Id=p.DiveId order by d.Id,runtime"
+	};
 
-	if (retval != SQLITE_OK) {
-		fprintf(stderr, translate("gettextFromC", "Database query failed '%s'.\n"), url);
-		return 1;
-	}
-
-	return 0;
+	return parse_sqlite_dives(handle, url, get_dives, get_rows, 4, cobalt_dive);
 }
 
-int parse_dlf_buffer(unsigned char *buffer, size_t size)
+int parse_dlf_buffer(unsigned char *buffer, size_t size, struct dive_table *table)
 {
 	unsigned char *ptr = buffer;
 	unsigned char event;
@@ -2848,7 +2786,7 @@ int parse_dlf_buffer(unsigned char *buffer, size_t size)
 	int i;
 	char serial[6];
 
-	target_table = &dive_table;
+	target_table = table;
 
 	// Check for the correct file magic
 	if (ptr[0] != 'D' || ptr[1] != 'i' || ptr[2] != 'v' || ptr[3] != 'E')
@@ -1,5 +1,6 @@
 #include "printer.h"
 #include "templatelayout.h"
+#include "profilerenderer.h"
 
 #include <QtWebKitWidgets>
 #include <QPainter>
@@ -20,7 +21,29 @@ Printer::Printer(QPrinter *printer)
 	done = 0;
 }
 
-void Printer::render()
+/*
+ * The dives are laid out and printed a chunk at a time, so the web view
+ * never has to hold the whole log. Every chunk starts on a new page, so
+ * this must be a multiple of the number of dives that fit on a page.
+ */
+#define PRINT_CHUNK_DIVES 16
+
+/*
+ * The ".diveProfile" elements of the template get the profile images,
+ * in the same order as the dives of the chunk. Their geometry is taken
+ * before the frame is scrolled, so it is relative to the whole chunk.
+ */
+void Printer::putProfileImages(QPainter &painter, const QList<QRect> &rects, const QList<QImage> &images, int page)
+{
+	QRect pageRect(0, page * A4_300DPI_HIGHT, A4_300DPI_WIDTH, A4_300DPI_HIGHT);
+
+	for (int i = 0; i < rects.count() && i < images.count(); i++) {
+		if (rects.at(i).intersects(pageRect))
+			painter.drawImage(rects.at(i).translated(0, -pageRect.top()), images.at(i));
+	}
+}
+
+void Printer::render(const QStringList &diveBlocks, const QList<struct dive *> &dives, TemplateLayout &layout)
 {
 	QPainter painter;
 	QSize size(A4_300DPI_WIDTH, A4_300DPI_HIGHT);
@@ -30,14 +53,30 @@ void Printer::render()
 
 	webView->page()->setViewportSize(size);
 
-	int Pages = ceil((float)webView->page()->mainFrame()->contentsSize().rheight() / A4_300DPI_HIGHT);
-	for (int i = 0; i < Pages; i++) {
-		webView->page()->mainFrame()->render(&painter, QWebFrame::ContentsLayer);
-		webView->page()->mainFrame()->scroll(0, A4_300DPI_HIGHT);
-		//rendering progress is 4/5 of total work
-		emit(progessUpdated((i * 80.0 / Pages) + done));
-		if (i < Pages - 1)
-			printer->newPage();
+	int total = diveBlocks.count();
+	for (int start = 0; start < total; start += PRINT_CHUNK_DIVES) {
+		int count = qMin(PRINT_CHUNK_DIVES, total - start);
+		webView->setHtml(layout.generate(diveBlocks.mid(start, count)));
+		int Pages = ceil((float)webView->page()->mainFrame()->contentsSize().rheight() / A4_300DPI_HIGHT);
+		QWebElementCollection collection = webView->page()->mainFrame()->findAllElements(".diveProfile");
+		QList<QRect> profileRects;
+		QList<QImage> profiles;
+		for (int j = 0; j < collection.count(); j++)
+			profileRects.append(collection.at(j).geometry());
+		if (!profileRects.isEmpty()) {
+			ProfileImageOptions options = { profileRects.first().size(), false };
+			profiles = profileImages(dives.mid(start, count), options);
+		}
+		for (int i = 0; i < Pages; i++) {
+			webView->page()->mainFrame()->render(&painter, QWebFrame::ContentsLayer);
+			putProfileImages(painter, profileRects, profiles, i);
+			webView->page()->mainFrame()->scroll(0, A4_300DPI_HIGHT);
+			//rendering progress is 4/5 of total work
+			emit(progessUpdated(((start + count * (i + 1.0) / Pages) * 80.0 / total) + done));
+			qApp->processEvents(QEventLoop::ExcludeUserInputEvents);
+			if (i < Pages - 1 || start + count < total)
+				printer->newPage();
+		}
 	}
 	painter.end();
 }
@@ -53,7 +92,14 @@ void Printer::print()
 {
 	TemplateLayout t;
 	connect(&t, SIGNAL(progressUpdated(int)), this, SLOT(templateProgessUpdated(int)));
+	QStringList diveBlocks = t.renderDives();
+	QList<struct dive *> dives;
+	struct dive *dive;
+	int i;
+	for_each_dive (i, dive) {
+		if (dive->selected)
+			dives.append(dive);
+	}
 	webView = new QWebView();
-	webView->setHtml(t.generate());
-	render();
+	render(diveBlocks, dives, t);
 }
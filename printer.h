@@ -4,13 +4,18 @@
 #include <QPrinter>
 #include <QWebView>
 
+class TemplateLayout;
+class QPainter;
+struct dive;
+
 class Printer : public QObject {
 	Q_OBJECT
 
 private:
 	QPrinter *printer;
 	QWebView *webView;
-	void render();
+	void render(const QStringList &diveBlocks, const QList<struct dive *> &dives, TemplateLayout &layout);
+	void putProfileImages(QPainter &painter, const QList<QRect> &rects, const QList<QImage> &images, int page);
 	int done;
 
 private slots:
@@ -178,46 +178,58 @@ static int get_local_sac(struct plot_data *entry1, struct plot_data *entry2, str
 	return airuse / atm * 60 / duration;
 }
 
-static void analyze_plot_info_minmax_minute(struct plot_data *entry, struct plot_data *first, struct plot_data *last, int index)
+/*
+ * Minimum, maximum and average depth within +/- 90 * (index + 1) seconds
+ * of every entry. Both ends of the window only ever move forward, so this
+ * is done in a single pass: the candidates for the minimum and maximum
+ * are kept in queues of entry indices with monotonic depths, and the
+ * average comes from a running sum. On equal depths the earliest entry
+ * is used, like the scanning implementation this replaces did.
+ */
+static void analyze_plot_info_minmax(struct plot_info *pi, int index, int *minq, int *maxq)
 {
-	struct plot_data *p = entry;
-	int time = entry->sec;
+	struct plot_data *entry = pi->entry;
+	int nr = pi->nr;
 	int seconds = 90 * (index + 1);
-	struct plot_data *min, *max;
-	int avg, nr;
+	int minhead = 0, mintail = 0, maxhead = 0, maxtail = 0;
+	int start = 0, end = 0;
+	long long sum = 0;
+	int i;
 
-	/* Go back 'seconds' in time */
-	while (p > first) {
-		if (p[-1].sec < time - seconds)
-			break;
-		p--;
-	}
+	for (i = 0; i < nr; i++) {
+		int time = entry[i].sec;
+		int avg, count;
 
-	/* Then go forward until we hit an entry past the time */
-	min = max = p;
-	avg = p->depth;
-	nr = 1;
-	while (++p < last) {
-		int depth = p->depth;
-		if (p->sec > time + seconds)
-			break;
-		avg += depth;
-		nr++;
-		if (depth < min->depth)
-			min = p;
-		if (depth > max->depth)
-			max = p;
-	}
-	entry->min[index] = min;
-	entry->max[index] = max;
-	entry->avg[index] = (avg + nr / 2) / nr;
-}
+		/* drop the entries that are too far in the past */
+		while (entry[start].sec < time - seconds) {
+			sum -= entry[start].depth;
+			start++;
+		}
+		while (minhead < mintail && minq[minhead] < start)
+			minhead++;
+		while (maxhead < maxtail && maxq[maxhead] < start)
+			maxhead++;
+
+		/* and add the ones that are now close enough */
+		while (end < nr && entry[end].sec <= time + seconds) {
+			int depth = entry[end].depth;
+
+			while (mintail > minhead && entry[minq[mintail - 1]].depth > depth)
+				mintail--;
+			minq[mintail++] = end;
+			while (maxtail > maxhead && entry[maxq[maxtail - 1]].depth < depth)
+				maxtail--;
+			maxq[maxtail++] = end;
+			sum += depth;
+			end++;
+		}
 
-static void analyze_plot_info_minmax(struct plot_data *entry, struct plot_data *first, struct plot_data *last)
-{
-	analyze_plot_info_minmax_minute(entry, first, last, 0);
-	analyze_plot_info_minmax_minute(entry, first, last, 1);
-	analyze_plot_info_minmax_minute(entry, first, last, 2);
+		count = end - start;
+		avg = sum;
+		pi->minmax[i].min[index] = entry + minq[minhead];
+		pi->minmax[i].max[index] = entry + maxq[maxhead];
+		pi->minmax[i].avg[index] = (avg + count / 2) / count;
+	}
 }
 
 static velocity_t velocity(int speed)
@@ -282,9 +294,12 @@ struct plot_info *analyze_plot_info(struct plot_info *pi)
 	}
 
 	/* One-, two- and three-minute minmax data */
-	for (i = 0; i < nr; i++) {
-		struct plot_data *entry = pi->entry + i;
-		analyze_plot_info_minmax(entry, pi->entry, pi->entry + nr);
+	if (nr && pi->minmax) {
+		int *queues = malloc(2 * nr * sizeof(int));
+
+		for (i = 0; i < 3; i++)
+			analyze_plot_info_minmax(pi, i, queues, queues + nr);
+		free(queues);
 	}
 
 	return pi;
@@ -446,7 +461,7 @@ struct plot_info calculate_max_limits_new(struct dive *dive, struct divecomputer
 {
 	struct divecomputer *dc = &(dive->dc);
 	bool seen = false;
-	static struct plot_info pi;
+	struct plot_info pi;
 	int maxdepth = dive->maxdepth.mm;
 	int maxtime = 0;
 	int maxpressure = 0, minpressure = INT_MAX;
@@ -554,10 +569,15 @@ struct plot_data *populate_plot_entries(struct dive *dive, struct divecomputer *
 	 * additional 4).
 	 */
 	nr = dc->samples + 5 + maxtime / 10 + count_events(dc);
-	plot_data = calloc(nr, sizeof(struct plot_data));
+	/* the tissue and minmax data live in the same allocation, after the entries */
+	plot_data = calloc(nr, sizeof(struct plot_data) + sizeof(struct plot_tissue_data) + sizeof(struct plot_minmax_data));
 	pi->entry = plot_data;
+	pi->tissues = NULL;
+	pi->minmax = NULL;
 	if (!plot_data)
 		return NULL;
+	pi->tissues = (struct plot_tissue_data *)(plot_data + nr);
+	pi->minmax = (struct plot_minmax_data *)(pi->tissues + nr);
 	pi->nr = nr;
 	idx = 2; /* the two extra events at the start */
 
@@ -830,6 +850,24 @@ static void calculate_ndl_tts(double tissue_tolerance, struct plot_data *entry,
 	}
 }
 
+/* One simulated ascent, starting from the tissue state at the given entry */
+struct ndl_tts_job {
+	struct plot_data *entry;
+	struct dive *dive;
+	double surface_pressure;
+	char *deco_state;
+};
+
+static void calculate_ndl_tts_job(void *data)
+{
+	struct ndl_tts_job *job = data;
+	double tissue_tolerance = restore_deco_state(job->deco_state);
+
+	calculate_ndl_tts(tissue_tolerance, job->entry, job->dive, job->surface_pressure);
+	free(job->deco_state);
+	job->deco_state = NULL;
+}
+
 /* Let's try to do some deco calculations.
  */
 void calculate_deco_information(struct dive *dive, struct divecomputer *dc, struct plot_info *pi, bool print_mode)
@@ -838,6 +876,14 @@ void calculate_deco_information(struct dive *dive, struct divecomputer *dc, stru
 	double surface_pressure = (dc->surface_pressure.mbar ? dc->surface_pressure.mbar : get_surface_pressure_in_mbar(dive, true)) / 1000.0;
 	double tissue_tolerance = 0;
 	int last_ndl_tts_calc_time = 0;
+	struct ndl_tts_job *jobs = NULL;
+	int nr_jobs = 0;
+	char *cache_data = NULL;
+
+	/* should we do more calculations?
+	 * We don't for print-mode because this info doesn't show up there */
+	if (prefs.calcndltts && !print_mode)
+		jobs = malloc(pi->nr * sizeof(*jobs));
 	for (i = 1; i < pi->nr; i++) {
 		struct plot_data *entry = pi->entry + i;
 		int j, t0 = (entry - 1)->sec, t1 = entry->sec;
@@ -862,36 +908,58 @@ void calculate_deco_information(struct dive *dive, struct divecomputer *dc, stru
 			entry->ceiling = (entry - 1)->ceiling;
 		else
 			entry->ceiling = deco_allowed_depth(tissue_tolerance, surface_pressure, dive, !prefs.calcceiling3m);
-		for (j = 0; j < 16; j++) {
-			double m_value = buehlmann_inertgas_a[j] + entry->ambpressure / buehlmann_inertgas_b[j];
-			entry->ceilings[j] = deco_allowed_depth(tolerated_by_tissue[j], surface_pressure, dive, 1);
-			entry->percentages[j] = tissue_inertgas_saturation[j] < entry->ambpressure ?
-							tissue_inertgas_saturation[j] / entry->ambpressure * AMB_PERCENTAGE :
-							AMB_PERCENTAGE + (tissue_inertgas_saturation[j] - entry->ambpressure) / (m_value - entry->ambpressure) * (100.0 - AMB_PERCENTAGE);
+		if (pi->tissues) {
+			struct plot_tissue_data *tissues = pi->tissues + i;
+			for (j = 0; j < 16; j++) {
+				double m_value = buehlmann_inertgas_a[j] + entry->ambpressure / buehlmann_inertgas_b[j];
+				tissues->ceilings[j] = deco_allowed_depth(tolerated_by_tissue[j], surface_pressure, dive, 1);
+				tissues->percentages[j] = tissue_inertgas_saturation[j] < entry->ambpressure ?
+								  tissue_inertgas_saturation[j] / entry->ambpressure * AMB_PERCENTAGE :
+								  AMB_PERCENTAGE + (tissue_inertgas_saturation[j] - entry->ambpressure) / (m_value - entry->ambpressure) * (100.0 - AMB_PERCENTAGE);
+			}
 		}
 
-		/* should we do more calculations?
-		 * We don't for print-mode because this info doesn't show up there */
-		if (prefs.calcndltts && !print_mode) {
-			/* only calculate ndl/tts on every 30 seconds */
-			if ((entry->sec - last_ndl_tts_calc_time) < 30) {
-				struct plot_data *prev_entry = (entry - 1);
-				entry->stoptime_calc = prev_entry->stoptime_calc;
-				entry->stopdepth_calc = prev_entry->stopdepth_calc;
-				entry->tts_calc = prev_entry->tts_calc;
-				entry->ndl_calc = prev_entry->ndl_calc;
-				continue;
-			}
+		/* only calculate ndl/tts on every 30 seconds; the simulated
+		 * ascents start from a snapshot of the tissues at this point
+		 * and are independent of each other, so they are run on the
+		 * thread pool once the whole dive has been walked */
+		if (jobs && (entry->sec - last_ndl_tts_calc_time) >= 30) {
+			struct ndl_tts_job *job = jobs + nr_jobs++;
+
 			last_ndl_tts_calc_time = entry->sec;
+			job->entry = entry;
+			job->dive = dive;
+			job->surface_pressure = surface_pressure;
+			job->deco_state = NULL;
+			cache_deco_state(tissue_tolerance, &job->deco_state);
+		}
+	}
+
+	if (jobs) {
+		struct ndl_tts_job *job = jobs;
+
+		/* the calling thread may run some of the jobs as well, so keep
+		 * the "real" deco state at the end of the dive for later restore */
+		cache_deco_state(tissue_tolerance, &cache_data);
+		run_concurrently(calculate_ndl_tts_job, jobs, nr_jobs, sizeof(*jobs));
+		restore_deco_state(cache_data);
+		free(cache_data);
+
+		/* entries between the calculations show the last results */
+		for (i = 1; i < pi->nr; i++) {
+			struct plot_data *entry = pi->entry + i;
+			struct plot_data *prev_entry = entry - 1;
 
-			/* We are going to mess up deco state, so store it for later restore */
-			char *cache_data = NULL;
-			cache_deco_state(tissue_tolerance, &cache_data);
-			calculate_ndl_tts(tissue_tolerance, entry, dive, surface_pressure);
-			/* Restore "real" deco state for next real time step */
-			tissue_tolerance = restore_deco_state(cache_data);
-			free(cache_data);
+			if (job < jobs + nr_jobs && job->entry == entry) {
+				job++;
+				continue;
+			}
+			entry->stoptime_calc = prev_entry->stoptime_calc;
+			entry->stopdepth_calc = prev_entry->stopdepth_calc;
+			entry->tts_calc = prev_entry->tts_calc;
+			entry->ndl_calc = prev_entry->ndl_calc;
 		}
+		free(jobs);
 	}
 #if DECO_CALC_DEBUG & 1
 	dump_tissues();
@@ -1050,12 +1118,10 @@ static void debug_print_profiledata(struct plot_info *pi)
  * sides, so that you can do end-points without having to worry
  * about it.
  */
-void create_plot_info_new(struct dive *dive, struct divecomputer *dc, struct plot_info *pi, bool fast)
+static void fill_plot_info(struct dive *dive, struct divecomputer *dc, struct plot_info *pi, bool fast, bool print_mode)
 {
 	int o2, he, o2max;
 	init_decompression(dive);
-	/* Create the new plot data */
-	free((void *)last_pi_entry_new);
 
 	get_dive_gas(dive, &o2, &he, &o2max);
 	if (he > 0) {
@@ -1066,7 +1132,7 @@ void create_plot_info_new(struct dive *dive, struct divecomputer *dc, struct plo
 		else
 			pi->dive_type = AIR;
 	}
-	last_pi_entry_new = populate_plot_entries(dive, dc, pi);
+	populate_plot_entries(dive, dc, pi);
 
 	check_gas_change_events(dive, dc, pi);   /* Populate the gas index from the gas change events */
 	check_setpoint_events(dive, dc, pi);     /* Populate setpoints */
@@ -1078,7 +1144,7 @@ void create_plot_info_new(struct dive *dive, struct divecomputer *dc, struct plo
 	}
 	fill_o2_values(dc, pi, dive);			 /* .. and insert the O2 sensor data having 0 values. */
 	calculate_sac(dive, pi);			 /* Calculate sac */
-	calculate_deco_information(dive, dc, pi, false); /* and ceiling information, using gradient factor values in Preferences) */
+	calculate_deco_information(dive, dc, pi, print_mode); /* and ceiling information, using gradient factor values in Preferences) */
 	calculate_gas_information_new(dive, pi);	 /* Calculate gas partial pressures */
 
 #ifdef DEBUG_GAS
@@ -1089,6 +1155,27 @@ void create_plot_info_new(struct dive *dive, struct divecomputer *dc, struct plo
 	analyze_plot_info(pi);
 }
 
+void create_plot_info_new(struct dive *dive, struct divecomputer *dc, struct plot_info *pi, bool fast)
+{
+	/* Create the new plot data */
+	free((void *)last_pi_entry_new);
+	fill_plot_info(dive, dc, pi, fast, false);
+	last_pi_entry_new = pi->entry;
+}
+
+/*
+ * The plot info of a dive for a printed or exported profile. Unlike
+ * create_plot_info_new() this leaves the plot info of the profile widget
+ * alone: the caller owns pi->entry and has to free it. The deco state is
+ * per thread, so this can run on several threads at once, as long as the
+ * dive list doesn't change meanwhile.
+ */
+void create_print_plot_info(struct dive *dive, struct divecomputer *dc, struct plot_info *pi)
+{
+	*pi = calculate_max_limits_new(dive, dc);
+	fill_plot_info(dive, dc, pi, false, true);
+}
+
 struct divecomputer *select_dc(struct dive *dive)
 {
 	unsigned int max = number_of_computers(dive);
@@ -1200,11 +1287,12 @@ static void plot_string(struct plot_info *pi, struct plot_data *entry, struct me
 	if (entry->ceiling) {
 		depthvalue = get_depth_units(entry->ceiling, NULL, &depth_unit);
 		put_format(b, translate("gettextFromC", "Calculated ceiling %.0f%s\n"), depthvalue, depth_unit);
-		if (prefs.calcalltissues) {
+		if (prefs.calcalltissues && pi->tissues) {
+			struct plot_tissue_data *tissues = pi->tissues + (entry - pi->entry);
 			int k;
 			for (k = 0; k < 16; k++) {
-				if (entry->ceilings[k]) {
-					depthvalue = get_depth_units(entry->ceilings[k], NULL, &depth_unit);
+				if (tissues->ceilings[k]) {
+					depthvalue = get_depth_units(tissues->ceilings[k], NULL, &depth_unit);
 					put_format(b, translate("gettextFromC", "Tissue %.0fmin: %.0f%s\n"), buehlmann_N2_t_halflife[k], depthvalue, depth_unit);
 				}
 			}
@@ -1222,17 +1310,27 @@ static void plot_string(struct plot_info *pi, struct plot_data *entry, struct me
 	strip_mb(b);
 }
 
+/*
+ * Find the first entry at or after 'time' (or the last entry of the
+ * dive), and if 'mb' is given describe it there. The entries are
+ * sorted by time, so this is a binary search.
+ */
 struct plot_data *get_plot_details_new(struct plot_info *pi, int time, struct membuffer *mb)
 {
-	struct plot_data *entry = NULL;
-	int i;
+	struct plot_data *entry;
+	int low = 0, high = pi->nr - 1;
 
-	for (i = 0; i < pi->nr; i++) {
-		entry = pi->entry + i;
-		if (entry->sec >= time)
-			break;
+	if (pi->nr <= 0)
+		return NULL;
+	while (low < high) {
+		int mid = low + (high - low) / 2;
+		if (pi->entry[mid].sec >= time)
+			high = mid;
+		else
+			low = mid + 1;
 	}
-	if (entry)
+	entry = pi->entry + low;
+	if (mb)
 		plot_string(pi, entry, mb, pi->has_ndl);
 	return (entry);
 }
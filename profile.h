@@ -30,8 +30,6 @@ struct plot_data {
 	/* Depth info */
 	int depth;
 	int ceiling;
-	int ceilings[16];
-	int percentages[16];
 	int ndl;
 	int tts;
 	int stoptime;
@@ -47,9 +45,6 @@ struct plot_data {
 	double mod, ead, end, eadd;
 	velocity_t velocity;
 	int speed;
-	struct plot_data *min[3];
-	struct plot_data *max[3];
-	int avg[3];
 	/* values calculated by us */
 	unsigned int in_deco_calc : 1;
 	int ndl_calc;
@@ -63,6 +58,21 @@ struct plot_data {
 	double gfline;
 };
 
+/* Per-tissue ceilings and saturation, kept apart from the plot entries
+ * as only the tissue graphs and the tool tip ever look at them */
+struct plot_tissue_data {
+	int ceilings[16];
+	int percentages[16];
+};
+
+/* The one-, two- and three-minute depth minimums, maximums and averages
+ * around an entry, only used for the depth labels of the profile */
+struct plot_minmax_data {
+	struct plot_data *min[3];
+	struct plot_data *max[3];
+	int avg[3];
+};
+
 struct ev_select {
 	char *ev_name;
 	bool plot_ev;
@@ -73,6 +83,7 @@ void compare_samples(struct plot_data *e1, struct plot_data *e2, char *buf, int
 struct plot_data *populate_plot_entries(struct dive *dive, struct divecomputer *dc, struct plot_info *pi);
 struct plot_info *analyze_plot_info(struct plot_info *pi);
 void create_plot_info_new(struct dive *dive, struct divecomputer *dc, struct plot_info *pi, bool fast);
+void create_print_plot_info(struct dive *dive, struct divecomputer *dc, struct plot_info *pi);
 void calculate_deco_information(struct dive *dive, struct divecomputer *dc, struct plot_info *pi, bool print_mode);
 struct plot_data *get_plot_details_new(struct plot_info *pi, int time, struct membuffer *);
 
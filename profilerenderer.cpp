@@ -0,0 +1,258 @@
+#include <QPainter>
+#include <QPolygonF>
+#include <QCache>
+#include <QMutex>
+#include <QCryptographicHash>
+#include <QtConcurrent>
+
+#include "profilerenderer.h"
+#include "dive.h"
+#include "divelist.h"
+#include "display.h"
+#include "profile.h"
+#include "helpers.h"
+
+/* the images are kept up to this many kB */
+#define PROFILE_IMAGE_CACHE_SIZE (64 * 1024)
+
+static QCache<QByteArray, QImage> profileImageCache(PROFILE_IMAGE_CACHE_SIZE);
+static QMutex profileImageCacheLock;
+
+static QColor profileColor(QColor color, bool grayscale)
+{
+	if (!grayscale)
+		return color;
+	int gray = qGray(color.rgb());
+	return QColor(gray, gray, gray, color.alpha());
+}
+
+QImage drawProfileImage(const struct plot_info &pi, const ProfileImageOptions &options)
+{
+	QImage image(options.size, QImage::Format_ARGB32_Premultiplied);
+	image.fill(Qt::white);
+	if (!pi.nr || options.size.isEmpty())
+		return image;
+
+	QPainter painter(&image);
+	painter.setRenderHint(QPainter::Antialiasing);
+	QFont font = painter.font();
+	font.setPixelSize(qMax(8, options.size.height() / 30));
+	painter.setFont(font);
+
+	QFontMetrics metrics(font);
+	QRectF plot(metrics.width("0000") + 4, metrics.height() / 2,
+		    options.size.width() - metrics.width("0000") - 8, options.size.height() - 2 * metrics.height() - 4);
+	int maxtime = get_maxtime((struct plot_info *)&pi);
+	int maxdepth = get_maxdepth((struct plot_info *)&pi);
+#define TIME_X(_sec) (plot.left() + (double)(_sec) * plot.width() / maxtime)
+#define DEPTH_Y(_mm) (plot.top() + (double)(_mm) * plot.height() / maxdepth)
+
+	/* the grid: depth every 10m or 30ft, time every 5 or 10 minutes */
+	int depthStep = prefs.units.length == units::METERS ? 10000 : 9144;
+	int timeStep = maxtime > 60 * 60 ? 10 * 60 : 5 * 60;
+	painter.setPen(QPen(QColor(Qt::lightGray), 1));
+	for (int depth = 0; depth <= maxdepth; depth += depthStep) {
+		painter.drawLine(QPointF(plot.left(), DEPTH_Y(depth)), QPointF(plot.right(), DEPTH_Y(depth)));
+		painter.setPen(Qt::black);
+		painter.drawText(QRectF(0, DEPTH_Y(depth) - metrics.height() / 2, plot.left() - 2, metrics.height()),
+				 Qt::AlignRight | Qt::AlignVCenter, get_depth_string(depth, false, false));
+		painter.setPen(QPen(QColor(Qt::lightGray), 1));
+	}
+	for (int time = 0; time <= maxtime; time += timeStep) {
+		painter.drawLine(QPointF(TIME_X(time), plot.top()), QPointF(TIME_X(time), plot.bottom()));
+		painter.setPen(Qt::black);
+		painter.drawText(QRectF(TIME_X(time) - metrics.width("000"), plot.bottom() + 2, 2 * metrics.width("000"), metrics.height()),
+				 Qt::AlignHCenter | Qt::AlignTop, QString::number(time / 60));
+		painter.setPen(QPen(QColor(Qt::lightGray), 1));
+	}
+
+	/* the depth profile, filled up to the surface */
+	QPolygonF depth;
+	depth << QPointF(TIME_X(pi.entry[0].sec), plot.top());
+	for (int i = 0; i < pi.nr; i++)
+		depth << QPointF(TIME_X(pi.entry[i].sec), DEPTH_Y(pi.entry[i].depth));
+	depth << QPointF(TIME_X(pi.entry[pi.nr - 1].sec), plot.top());
+	QLinearGradient gradient(0, plot.top(), 0, plot.bottom());
+	gradient.setColorAt(0, profileColor(QColor(160, 200, 240), options.grayscale));
+	gradient.setColorAt(1, profileColor(QColor(40, 80, 160), options.grayscale));
+	painter.setPen(QPen(profileColor(QColor(20, 50, 120), options.grayscale), 2));
+	painter.setBrush(gradient);
+	painter.drawPolygon(depth);
+
+	/* the calculated ceiling, if it is shown on screen as well */
+	if (prefs.calcceiling) {
+		QPolygonF ceiling;
+		ceiling << QPointF(TIME_X(pi.entry[0].sec), plot.top());
+		for (int i = 0; i < pi.nr; i++)
+			ceiling << QPointF(TIME_X(pi.entry[i].sec), DEPTH_Y(pi.entry[i].ceiling));
+		ceiling << QPointF(TIME_X(pi.entry[pi.nr - 1].sec), plot.top());
+		painter.setPen(Qt::NoPen);
+		painter.setBrush(profileColor(QColor(220, 60, 60, 120), options.grayscale));
+		painter.drawPolygon(ceiling);
+	}
+
+	/* temperature and cylinder pressure in the lower part of the plot */
+	QPolygonF temperature, pressure;
+	int temperatureRange = qMax(pi.maxtemp - pi.mintemp, 1000);
+	int pressureRange = qMax(pi.maxpressure - pi.minpressure, 1000);
+	for (int i = 0; i < pi.nr; i++) {
+		struct plot_data *entry = pi.entry + i;
+		if (entry->temperature)
+			temperature << QPointF(TIME_X(entry->sec),
+					       plot.bottom() - (double)(entry->temperature - pi.mintemp) * plot.height() / 5 / temperatureRange);
+		int mbar = GET_PRESSURE(entry);
+		if (mbar)
+			pressure << QPointF(TIME_X(entry->sec),
+					    plot.bottom() - plot.height() / 4 - (double)(mbar - pi.minpressure) * plot.height() / 2 / pressureRange);
+	}
+	painter.setBrush(Qt::NoBrush);
+	painter.setPen(QPen(profileColor(QColor(200, 120, 0), options.grayscale), 2));
+	painter.drawPolyline(temperature);
+	painter.setPen(QPen(profileColor(QColor(0, 140, 0), options.grayscale), 2));
+	painter.drawPolyline(pressure);
+#undef TIME_X
+#undef DEPTH_Y
+
+	painter.setPen(Qt::black);
+	painter.drawRect(plot);
+	return image;
+}
+
+static void hashValues(QCryptographicHash &hash, const int *values, int nr)
+{
+	hash.addData((const char *)values, nr * sizeof(*values));
+}
+
+/* everything of a dive that goes into its plot info for the given dive computer */
+static void hashDive(QCryptographicHash &hash, struct dive *dive, struct divecomputer *dc)
+{
+	int header[] = { (int)dive->id, (int)dive->when, (int)(dive->when >> 32), (int)dive->duration.seconds,
+			 dive->maxdepth.mm, dc->surface_pressure.mbar, dc->salinity, dc->divemode, dc->samples };
+	hashValues(hash, header, sizeof(header) / sizeof(header[0]));
+	for (int i = 0; i < dc->samples; i++) {
+		struct sample *s = dc->sample + i;
+		int values[] = { (int)s->time.seconds, s->depth.mm, s->temperature.mkelvin, s->cylinderpressure.mbar,
+				 s->o2cylinderpressure.mbar, s->setpoint.mbar, s->sensor, s->in_deco, s->sac.mliter };
+		hashValues(hash, values, sizeof(values) / sizeof(values[0]));
+	}
+	for (struct event *ev = dc->events; ev; ev = ev->next) {
+		int values[] = { (int)ev->time.seconds, ev->type, ev->flags, ev->value };
+		hashValues(hash, values, sizeof(values) / sizeof(values[0]));
+	}
+	for (int i = 0; i < MAX_CYLINDERS; i++) {
+		cylinder_t *cyl = dive->cylinder + i;
+		int values[] = { cyl->gasmix.o2.permille, cyl->gasmix.he.permille, cyl->start.mbar, cyl->end.mbar,
+				 cyl->type.size.mliter, cyl->type.workingpressure.mbar };
+		hashValues(hash, values, sizeof(values) / sizeof(values[0]));
+	}
+}
+
+/*
+ * The key of a profile image: the options and preferences it is drawn
+ * with, the dive itself and the dives before it that may still load
+ * the tissues (see init_decompression()).
+ */
+static QByteArray profileImageKey(struct dive *dive, struct divecomputer *dc, const ProfileImageOptions &options)
+{
+	QCryptographicHash hash(QCryptographicHash::Sha1);
+	int settings[] = { options.size.width(), options.size.height(), options.grayscale,
+			   prefs.gflow, prefs.gfhigh, prefs.calcceiling, prefs.calcceiling3m, prefs.zoomed_plot, prefs.decosac,
+			   prefs.units.length, prefs.units.pressure, prefs.units.temperature };
+	hashValues(hash, settings, sizeof(settings) / sizeof(settings[0]));
+	hashDive(hash, dive, dc);
+
+	timestamp_t when = dive->when;
+	for (int i = get_divenr(dive) - 1; i >= 0; i--) {
+		struct dive *pdive = get_dive(i);
+		if (pdive->when + pdive->duration.seconds + 48 * 60 * 60 < when)
+			break;
+		hashDive(hash, pdive, &pdive->dc);
+		when = pdive->when;
+	}
+	return hash.result();
+}
+
+struct ProfileImageJob {
+	struct dive *dive;
+	struct divecomputer *dc;
+	ProfileImageOptions options;
+};
+
+static QImage renderProfileImage(const ProfileImageJob &job)
+{
+	struct plot_info pi;
+
+	create_print_plot_info(job.dive, job.dc, &pi);
+	QImage image = drawProfileImage(pi, job.options);
+	free(pi.entry);
+	return image;
+}
+
+static bool cachedProfileImage(const QByteArray &key, QImage &image)
+{
+	QMutexLocker locker(&profileImageCacheLock);
+	QImage *cached = profileImageCache.object(key);
+	if (!cached)
+		return false;
+	image = *cached;
+	return true;
+}
+
+static void cacheProfileImage(const QByteArray &key, const QImage &image)
+{
+	QMutexLocker locker(&profileImageCacheLock);
+	profileImageCache.insert(key, new QImage(image), qMax(1, image.byteCount() / 1024));
+}
+
+QImage profileImage(struct dive *dive, struct divecomputer *dc, const ProfileImageOptions &options)
+{
+	QByteArray key = profileImageKey(dive, dc, options);
+	QImage image;
+
+	if (cachedProfileImage(key, image))
+		return image;
+	ProfileImageJob job = { dive, dc, options };
+	image = renderProfileImage(job);
+	cacheProfileImage(key, image);
+	return image;
+}
+
+/*
+ * The profiles of the first dive computer of the dives; the ones that are
+ * not in the cache are drawn on the thread pool, which relies on the deco
+ * state (including the factor caches in deco.c) being per thread.
+ */
+QList<QImage> profileImages(const QList<struct dive *> &dives, const ProfileImageOptions &options)
+{
+	QList<QImage> images;
+	QList<QByteArray> keys;
+	QList<ProfileImageJob> jobs;
+	QList<int> missing;
+
+	for (int i = 0; i < dives.count(); i++) {
+		QByteArray key = profileImageKey(dives.at(i), &dives.at(i)->dc, options);
+		QImage image;
+		if (!cachedProfileImage(key, image)) {
+			ProfileImageJob job = { dives.at(i), &dives.at(i)->dc, options };
+			jobs.append(job);
+			missing.append(i);
+		}
+		images.append(image);
+		keys.append(key);
+	}
+	if (jobs.isEmpty())
+		return images;
+
+	QList<QImage> rendered = QtConcurrent::blockingMapped<QList<QImage> >(jobs, renderProfileImage);
+	for (int i = 0; i < missing.count(); i++) {
+		images[missing.at(i)] = rendered.at(i);
+		cacheProfileImage(keys.at(missing.at(i)), rendered.at(i));
+	}
+	return images;
+}
+
+void clearProfileImageCache()
+{
+	QMutexLocker locker(&profileImageCacheLock);
+	profileImageCache.clear();
+}
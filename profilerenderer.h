@@ -0,0 +1,34 @@
+#ifndef PROFILERENDERER_H
+#define PROFILERENDERER_H
+
+#include <QImage>
+#include <QList>
+#include <QSize>
+
+struct dive;
+struct divecomputer;
+struct plot_info;
+
+/*
+ * Profile images for printing and exporting, drawn straight from the
+ * plot info of a dive instead of through the profile widget. This works
+ * without a widget and on any thread, so the images of several dives
+ * can be drawn in parallel.
+ */
+struct ProfileImageOptions {
+	QSize size;
+	bool grayscale;
+};
+
+QImage drawProfileImage(const struct plot_info &pi, const ProfileImageOptions &options);
+
+/*
+ * The images of whole dives are cached by the dive, the content that
+ * goes into its profile and the options, so asking for the same profile
+ * again is cheap as long as the dive didn't change.
+ */
+QImage profileImage(struct dive *dive, struct divecomputer *dc, const ProfileImageOptions &options);
+QList<QImage> profileImages(const QList<struct dive *> &dives, const ProfileImageOptions &options);
+void clearProfileImageCache();
+
+#endif // PROFILERENDERER_H
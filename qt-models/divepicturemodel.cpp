@@ -2,6 +2,7 @@
 #include "dive.h"
 #include "metrics.h"
 #include "divelist.h"
+#include "qthelper.h"
 
 #include <QtConcurrent>
 
@@ -13,18 +14,31 @@ typedef QPair<picturepointer, QImage> SPixmap;
 static SPixmap scaleImages(picturepointer picture)
 {
 	static QHash <QString, QImage > cache;
+	static QMutex cacheMutex;
 	SPixmap ret;
 	ret.first = picture;
+
+	QMutexLocker locker(&cacheMutex);
 	if (cache.contains(picture->filename) && !cache.value(picture->filename).isNull()) {
 		ret.second = cache.value(picture->filename);
-	} else {
-		int dim = defaultIconMetrics().sz_pic;
-		QImage p = SHashedImage(picture);
-		if(!p.isNull())
+		return ret;
+	}
+	locker.unlock();
+
+	// only decode the full image if there is no thumbnail from an earlier session
+	int dim = defaultIconMetrics().sz_pic;
+	QImage p = cachedThumbnail(picture->hash, dim);
+	if (p.isNull()) {
+		p = SHashedImage(picture);
+		if (!p.isNull()) {
 			p = p.scaled(dim, dim, Qt::KeepAspectRatio);
-			cache.insert(picture->filename, p);
-		ret.second = p;
+			addThumbnailToCache(picture->hash, dim, p);
+		}
 	}
+
+	locker.relock();
+	cache.insert(picture->filename, p);
+	ret.second = p;
 	return ret;
 }
 
@@ -19,7 +19,7 @@ QVariant DivePlotDataModel::data(const QModelIndex &index, int role) const
 	if ((!index.isValid()) || (index.row() >= pInfo.nr))
 		return QVariant();
 
-	plot_data item = pInfo.entry[index.row()];
+	const plot_data &item = pInfo.entry[index.row()];
 	if (role == Qt::DisplayRole) {
 		switch (index.column()) {
 		case DEPTH:
@@ -70,11 +70,11 @@ QVariant DivePlotDataModel::data(const QModelIndex &index, int role) const
 	}
 
 	if (role == Qt::DisplayRole && index.column() >= TISSUE_1 && index.column() <= TISSUE_16) {
-		return item.ceilings[index.column() - TISSUE_1];
+		return pInfo.tissues ? pInfo.tissues[index.row()].ceilings[index.column() - TISSUE_1] : 0;
 	}
 
 	if (role == Qt::DisplayRole && index.column() >= PERCENTAGE_1 && index.column() <= PERCENTAGE_16) {
-		return item.percentages[index.column() - PERCENTAGE_1];
+		return pInfo.tissues ? pInfo.tissues[index.row()].percentages[index.column() - PERCENTAGE_1] : 0;
 	}
 
 	if (role == Qt::BackgroundRole) {
@@ -3,6 +3,7 @@
 #include "models.h"
 #include "divelistview.h"
 #include "display.h"
+#include "divesearchindex.h"
 
 #define CREATE_INSTANCE_METHOD( CLASS ) \
 CLASS *CLASS::instance() \
@@ -44,79 +45,186 @@ Qt::ItemFlags CLASS::flags(const QModelIndex &index) const \
 	return QStringListModel::flags(index) | Qt::ItemIsUserCheckable; \
 }
 
-#define CREATE_DATA_METHOD( CLASS, COUNTER_FUNCTION ) \
+#define CREATE_DATA_METHOD( CLASS ) \
 QVariant CLASS::data(const QModelIndex &index, int role) const \
 { \
 	if (role == Qt::CheckStateRole) { \
 		return checkState[index.row()] ? Qt::Checked : Qt::Unchecked; \
 	} else if (role == Qt::DisplayRole) { \
 		QString value = stringList()[index.row()]; \
-		int count = COUNTER_FUNCTION((index.row() == rowCount() - 1) ? "" : value.toUtf8().data()); \
-		return value + QString(" (%1)").arg(count); \
+		return value + QString(" (%1)").arg(diveCount(index.row())); \
 	} \
 	return QVariant(); \
 }
 
-#define CREATE_COMMON_METHODS_FOR_FILTER( CLASS, COUNTER_FUNCTION ) \
+#define CREATE_UPDATE_DIVES_METHOD( CLASS ) \
+void CLASS::updateDives(const QList<struct dive *> &dives) \
+{ \
+	if (!updateIndex(dives)) { \
+		repopulate(); \
+		return; \
+	} \
+	emit dataChanged(createIndex(0, 0), createIndex(rowCount() - 1, 0)); \
+}
+
+#define CREATE_COMMON_METHODS_FOR_FILTER( CLASS ) \
 CREATE_FLAGS_METHOD( CLASS ); \
+CREATE_UPDATE_DIVES_METHOD( CLASS ); \
 CREATE_CLEAR_FILTER_METHOD( CLASS ); \
 CREATE_MODEL_SET_DATA_METHOD( CLASS ); \
 CREATE_INSTANCE_METHOD( CLASS ); \
-CREATE_DATA_METHOD( CLASS, COUNTER_FUNCTION )
+CREATE_DATA_METHOD( CLASS )
 
-CREATE_COMMON_METHODS_FOR_FILTER(TagFilterModel, count_dives_with_tag)
-CREATE_COMMON_METHODS_FOR_FILTER(BuddyFilterModel, count_dives_with_person)
-CREATE_COMMON_METHODS_FOR_FILTER(LocationFilterModel, count_dives_with_location)
-CREATE_COMMON_METHODS_FOR_FILTER(SuitsFilterModel, count_dives_with_suit)
+CREATE_COMMON_METHODS_FOR_FILTER(TagFilterModel)
+CREATE_COMMON_METHODS_FOR_FILTER(BuddyFilterModel)
+CREATE_COMMON_METHODS_FOR_FILTER(LocationFilterModel)
+CREATE_COMMON_METHODS_FOR_FILTER(SuitsFilterModel)
 
 CREATE_INSTANCE_METHOD(MultiFilterSortModel)
 
-SuitsFilterModel::SuitsFilterModel(QObject *parent) : QStringListModel(parent)
+QStringList MultiFilterInterface::buildIndex(const QString &noValueName)
 {
+	QMap<QString, QBitArray> values;
+	QBitArray noValue(dive_table.nr);
+	struct dive *dive;
+	int i;
+
+	diveIndex.clear();
+	for_each_dive (i, dive) {
+		QStringList diveValueList = diveValues(dive);
+		if (diveValueList.isEmpty())
+			noValue.setBit(i);
+		Q_FOREACH (const QString &value, diveValueList) {
+			QBitArray &dives = values[value];
+			if (dives.isEmpty())
+				dives.resize(dive_table.nr);
+			dives.setBit(i);
+		}
+		diveIndex.insert(dive, i);
+	}
+	nrDives = dive_table.nr;
+
+	// QMap keeps its keys sorted, so this is also the order of the list
+	QStringList list = values.keys();
+	rowDives = values.values().toVector();
+	rowDives.append(noValue);
+	rowDiveCount.resize(rowDives.count());
+	for (i = 0; i < rowDives.count(); i++)
+		rowDiveCount[i] = rowDives[i].count(true);
+	valueRow.clear();
+	for (i = 0; i < list.count(); i++)
+		valueRow.insert(list[i], i);
+	list << noValueName;
+	return list;
 }
 
-bool SuitsFilterModel::doFilter(dive *d, QModelIndex &index0, QAbstractItemModel *sourceModel) const
+// the index was built for the dive table as it is now: same dives, same order
+bool MultiFilterInterface::indexIsCurrent() const
 {
-	if (!anyChecked) {
-		return true;
+	struct dive *dive;
+	int i;
+
+	if (rowDives.isEmpty() || nrDives != dive_table.nr)
+		return false;
+	for_each_dive (i, dive) {
+		if (diveIndex.value(dive, -1) != i)
+			return false;
 	}
+	return true;
+}
+
+/*
+ * Move edited dives to the rows of their new values. This only works if
+ * the dive table didn't change otherwise and all the values already have
+ * a row; if not, the filter has to be repopulated.
+ */
+bool MultiFilterInterface::updateIndex(const QList<struct dive *> &dives)
+{
+	if (!indexIsCurrent())
+		return false;
+	QList<QVector<int> > diveRows;
+	Q_FOREACH (struct dive *dive, dives) {
+		QVector<int> rows;
+		Q_FOREACH (const QString &value, diveValues(dive)) {
+			int row = valueRow.value(value, -1);
+			if (row < 0)
+				return false;
+			rows.append(row);
+		}
+		if (rows.isEmpty())
+			rows.append(rowDives.count() - 1);
+		diveRows.append(rows);
+	}
+	for (int i = 0; i < dives.count(); i++) {
+		int idx = diveIndex.value(dives[i]);
+		for (int row = 0; row < rowDives.count(); row++) {
+			bool wasSet = rowDives[row].testBit(idx);
+			bool isSet = diveRows[i].contains(row);
+			if (wasSet == isSet)
+				continue;
+			rowDives[row].setBit(idx, isSet);
+			rowDiveCount[row] += isSet ? 1 : -1;
+		}
+	}
+	return true;
+}
+
+int MultiFilterInterface::diveCount(int row) const
+{
+	return row < rowDiveCount.count() ? rowDiveCount[row] : 0;
+}
+
+bool MultiFilterInterface::doFilter(struct dive *d, QModelIndex &index0, QAbstractItemModel *sourceModel) const
+{
+	// If there's nothing checked, this should show everything
+	if (!anyChecked)
+		return true;
 
 	// Checked means 'Show', Unchecked means 'Hide'.
-	QString suit(d->suit);
-	// only show empty suit dives if the user checked that.
-	if (suit.isEmpty()) {
-		if (rowCount() > 0)
-			return checkState[rowCount() - 1];
-		else
+	int idx = diveIndex.value(d, -1);
+	if (idx < 0 || get_dive(idx) != d)
+		return true;
+	for (int i = 0; i < rowDives.count(); i++) {
+		if (checkState[i] && rowDives[i].testBit(idx))
 			return true;
 	}
+	return false;
+}
 
-	// there is a suit selected
-	QStringList suitList = stringList();
-	if (!suitList.isEmpty()) {
-		suitList.removeLast(); // remove the "Show Empty Suits";
-		for (int i = 0; i < rowCount(); i++) {
-			if (checkState[i] && (suit.indexOf(stringList()[i]) != -1)) {
-				return true;
-			}
-		}
+/*
+ * The dives this filter lets through, those of all the checked rows, by
+ * their index in the dive table. A filter that has no index for the dive
+ * table as it is now lets all of them through, like doFilter() does for
+ * the dives it doesn't know.
+ */
+QBitArray MultiFilterInterface::filteredDives() const
+{
+	if (!anyChecked || !indexIsCurrent())
+		return QBitArray(dive_table.nr, true);
+
+	QBitArray dives(dive_table.nr);
+	for (int i = 0; i < rowDives.count(); i++) {
+		if (checkState[i])
+			dives |= rowDives[i];
 	}
-	return false;
+	return dives;
+}
+
+SuitsFilterModel::SuitsFilterModel(QObject *parent) : QStringListModel(parent)
+{
+}
+
+QStringList SuitsFilterModel::diveValues(struct dive *d) const
+{
+	QStringList values;
+	if (!same_string(d->suit, ""))
+		values << d->suit;
+	return values;
 }
 
 void SuitsFilterModel::repopulate()
 {
-	QStringList list;
-	struct dive *dive;
-	int i = 0;
-	for_each_dive (i, dive) {
-		QString suit(dive->suit);
-		if (!suit.isEmpty() && !list.contains(suit)) {
-			list.append(suit);
-		}
-	}
-	qSort(list);
-	list << tr("No suit set");
+	QStringList list = buildIndex(tr("No suit set"));
 	setStringList(list);
 	delete[] checkState;
 	checkState = new bool[list.count()];
@@ -129,19 +237,17 @@ TagFilterModel::TagFilterModel(QObject *parent) : QStringListModel(parent)
 {
 }
 
+QStringList TagFilterModel::diveValues(struct dive *d) const
+{
+	QStringList values;
+	for (struct tag_entry *tag = d->tag_list; tag; tag = tag->next)
+		values << tag->tag->name;
+	return values;
+}
+
 void TagFilterModel::repopulate()
 {
-	if (g_tag_list == NULL)
-		return;
-	QStringList list;
-	struct tag_entry *current_tag_entry = g_tag_list;
-	while (current_tag_entry != NULL) {
-		if (count_dives_with_tag(current_tag_entry->tag->name) > 0)
-			list.append(QString(current_tag_entry->tag->name));
-		current_tag_entry = current_tag_entry->next;
-	}
-	qSort(list);
-	list << tr("Empty tags");
+	QStringList list = buildIndex(tr("Empty tags"));
 	setStringList(list);
 	delete[] checkState;
 	checkState = new bool[list.count()];
@@ -150,87 +256,25 @@ void TagFilterModel::repopulate()
 	anyChecked = false;
 }
 
-bool TagFilterModel::doFilter(dive *d, QModelIndex &index0, QAbstractItemModel *sourceModel) const
-{
-	// If there's nothing checked, this should show everything
-	if (!anyChecked) {
-		return true;
-	}
-	// Checked means 'Show', Unchecked means 'Hide'.
-	struct tag_entry *head = d->tag_list;
-
-	if (!head) { // last tag means "Show empty tags";
-		if (rowCount() > 0)
-			return checkState[rowCount() - 1];
-		else
-			return true;
-	}
-
-	// have at least one tag.
-	QStringList tagList = stringList();
-	if (!tagList.isEmpty()) {
-		tagList.removeLast(); // remove the "Show Empty Tags";
-		while (head) {
-			QString tagName(head->tag->name);
-			int index = tagList.indexOf(tagName);
-			if (checkState[index])
-				return true;
-			head = head->next;
-		}
-	}
-	return false;
-}
-
 BuddyFilterModel::BuddyFilterModel(QObject *parent) : QStringListModel(parent)
 {
 }
 
-bool BuddyFilterModel::doFilter(dive *d, QModelIndex &index0, QAbstractItemModel *sourceModel) const
+QStringList BuddyFilterModel::diveValues(struct dive *d) const
 {
-	// If there's nothing checked, this should show everything
-	if (!anyChecked) {
-		return true;
-	}
-	// Checked means 'Show', Unchecked means 'Hide'.
-	QString diveBuddy(d->buddy);
-	QString divemaster(d->divemaster);
-	// only show empty buddie dives if the user checked that.
-	if (diveBuddy.isEmpty() && divemaster.isEmpty()) {
-		if (rowCount() > 0)
-			return checkState[rowCount() - 1];
-		else
-			return true;
-	}
-
-	// have at least one buddy
-	QStringList buddyList = stringList();
-	if (!buddyList.isEmpty()) {
-		buddyList.removeLast(); // remove the "Show Empty Tags";
-		for (int i = 0; i < rowCount(); i++) {
-			if (checkState[i] && (diveBuddy.indexOf(stringList()[i]) != -1 || divemaster.indexOf(stringList()[i]) != -1)) {
-				return true;
-			}
-		}
+	QStringList values;
+	QString people = QString(d->buddy) + "," + QString(d->divemaster);
+	Q_FOREACH (const QString &person, people.split(',', QString::SkipEmptyParts)) {
+		// Remove any leading spaces
+		if (!person.trimmed().isEmpty() && !values.contains(person.trimmed()))
+			values << person.trimmed();
 	}
-	return false;
+	return values;
 }
 
 void BuddyFilterModel::repopulate()
 {
-	QStringList list;
-	struct dive *dive;
-	int i = 0;
-	for_each_dive (i, dive) {
-		QString persons = QString(dive->buddy) + "," + QString(dive->divemaster);
-		Q_FOREACH (const QString &person, persons.split(',', QString::SkipEmptyParts)) {
-			// Remove any leading spaces
-			if (!list.contains(person.trimmed())) {
-				list.append(person.trimmed());
-			}
-		}
-	}
-	qSort(list);
-	list << tr("No buddies");
+	QStringList list = buildIndex(tr("No buddies"));
 	setStringList(list);
 	delete[] checkState;
 	checkState = new bool[list.count()];
@@ -243,47 +287,18 @@ LocationFilterModel::LocationFilterModel(QObject *parent) : QStringListModel(par
 {
 }
 
-bool LocationFilterModel::doFilter(struct dive *d, QModelIndex &index0, QAbstractItemModel *sourceModel) const
+QStringList LocationFilterModel::diveValues(struct dive *d) const
 {
-	if (!anyChecked) {
-		return true;
-	}
-	// Checked means 'Show', Unchecked means 'Hide'.
-	QString location(get_dive_location(d));
-	// only show empty location dives if the user checked that.
-	if (location.isEmpty()) {
-		if (rowCount() > 0)
-			return checkState[rowCount() - 1];
-		else
-			return true;
-	}
-
-	// there is a location selected
-	QStringList locationList = stringList();
-	if (!locationList.isEmpty()) {
-		locationList.removeLast(); // remove the "Show Empty Tags";
-		for (int i = 0; i < rowCount(); i++) {
-			if (checkState[i] && (location.indexOf(stringList()[i]) != -1)) {
-				return true;
-			}
-		}
-	}
-	return false;
+	QStringList values;
+	const char *location = get_dive_location(d);
+	if (!same_string(location, ""))
+		values << location;
+	return values;
 }
 
 void LocationFilterModel::repopulate()
 {
-	QStringList list;
-	struct dive *dive;
-	int i = 0;
-	for_each_dive (i, dive) {
-		QString location(get_dive_location(dive));
-		if (!location.isEmpty() && !list.contains(location)) {
-			list.append(location);
-		}
-	}
-	qSort(list);
-	list << tr("No location set");
+	QStringList list = buildIndex(tr("No location set"));
 	setStringList(list);
 	delete[] checkState;
 	checkState = new bool[list.count()];
@@ -317,7 +332,7 @@ bool MultiFilterSortModel::filterAcceptsRow(int source_row, const QModelIndex &s
 		return d->dive_site_uuid == curr_dive_site->uuid;
 	}
 
-	if (justCleared || models.isEmpty())
+	if (justCleared || (models.isEmpty() && searchText.isEmpty()))
 		return true;
 
 	if (!d) { // It's a trip, only show the ones that have dives to be shown.
@@ -328,15 +343,54 @@ bool MultiFilterSortModel::filterAcceptsRow(int source_row, const QModelIndex &s
 		}
 		return showTrip;
 	}
+
+	int idx = diveIndex.value(d, -1);
+	if (idx >= 0 && idx < visibleDives.size() && get_dive(idx) == d)
+		return visibleDives.testBit(idx);
+
+	// a dive that wasn't there when the filters last changed
 	Q_FOREACH (MultiFilterInterface *model, models) {
 		if (!model->doFilter(d, index0, sourceModel()))
 			shouldShow = false;
 	}
+	if (!searchText.isEmpty() && !DiveSearchIndex::diveMatches(d, searchText))
+		shouldShow = false;
 
 	filter_dive(d, shouldShow);
 	return shouldShow;
 }
 
+/*
+ * Combine the dives each filter lets through into the set of visible
+ * dives, and hide (and deselect) the others right away, so that
+ * filterAcceptsRow() only needs to look up the bit of each dive.
+ */
+void MultiFilterSortModel::updateVisibleDives()
+{
+	int i;
+	struct dive *d;
+
+	visibleDives.clear();
+	diveIndex.clear();
+	if (curr_dive_site || justCleared || (models.isEmpty() && searchText.isEmpty()))
+		return;
+
+	visibleDives = QBitArray(dive_table.nr, true);
+	Q_FOREACH (MultiFilterInterface *model, models)
+		visibleDives &= model->filteredDives();
+	QSet<int> found;
+	if (!searchText.isEmpty())
+		found = DiveSearchIndex::instance()->search(searchText);
+	for_each_dive (i, d) {
+		diveIndex.insert(d, i);
+		if (!searchText.isEmpty() && !found.contains(d->id))
+			visibleDives.clearBit(i);
+		d->hidden_by_filter = !visibleDives.testBit(i);
+		if (d->hidden_by_filter && d->selected)
+			deselect_dive(i);
+	}
+}
+
 void MultiFilterSortModel::myInvalidate()
 {
 	int i;
@@ -345,6 +399,7 @@ void MultiFilterSortModel::myInvalidate()
 
 	divesDisplayed = 0;
 
+	updateVisibleDives();
 	invalidate();
 
 	// first make sure the trips are no longer shown as selected
@@ -353,26 +408,23 @@ void MultiFilterSortModel::myInvalidate()
 	// TODO: This should go internally to DiveList, to be triggered after a filter is due.
 	dlv->clearTripSelection();
 
+	// find the dives that should still be selected (the filter above unselected any
+	// dive that's no longer visible) and count the ones that are shown
+	QList<int> curSelectedDives;
+	for_each_dive (i, d) {
+		if (d->selected)
+			curSelectedDives.append(i);
+		if (!d->hidden_by_filter)
+			divesDisplayed++;
+	}
+
 	// if we have no more selected dives, clean up the display - this later triggers us
 	// to pick one of the dives that are shown in the list as selected dive which is the
-	// natural behavior
-	if (amount_selected == 0) {
+	// natural behavior; otherwise select the remaining ones again
+	if (amount_selected == 0)
 		MainWindow::instance()->cleanUpEmpty();
-	} else {
-		// otherwise find the dives that should still be selected (the filter above unselected any
-		// dive that's no longer visible) and select them again
-		QList<int> curSelectedDives;
-		for_each_dive (i, d) {
-			if (d->selected)
-				curSelectedDives.append(get_divenr(d));
-		}
+	else
 		dlv->selectDives(curSelectedDives);
-	}
-
-	for_each_dive (i,d) {
-		if (!d->hidden_by_filter)
-			divesDisplayed++;
-	}
 
 	emit filterFinished();
 
@@ -387,6 +439,8 @@ void MultiFilterSortModel::addFilterModel(MultiFilterInterface *model)
 	Q_ASSERT(itemModel);
 	models.append(model);
 	connect(itemModel, SIGNAL(dataChanged(QModelIndex, QModelIndex)), this, SLOT(myInvalidate()));
+	// repopulating a filter clears it, before the dive list gets reloaded
+	connect(itemModel, SIGNAL(modelReset()), this, SLOT(updateVisibleDives()));
 }
 
 void MultiFilterSortModel::removeFilterModel(MultiFilterInterface *model)
@@ -395,6 +449,7 @@ void MultiFilterSortModel::removeFilterModel(MultiFilterInterface *model)
 	Q_ASSERT(itemModel);
 	models.removeAll(model);
 	disconnect(itemModel, SIGNAL(dataChanged(QModelIndex, QModelIndex)), this, SLOT(myInvalidate()));
+	disconnect(itemModel, SIGNAL(modelReset()), this, SLOT(updateVisibleDives()));
 }
 
 void MultiFilterSortModel::clearFilter()
@@ -407,6 +462,14 @@ void MultiFilterSortModel::clearFilter()
 	myInvalidate();
 }
 
+void MultiFilterSortModel::setSearchText(const QString &text)
+{
+	if (text.trimmed() == searchText)
+		return;
+	searchText = text.trimmed();
+	myInvalidate();
+}
+
 void MultiFilterSortModel::startFilterDiveSite(uint32_t uuid)
 {
 	curr_dive_site = get_dive_site_by_uuid(uuid);
@@ -3,15 +3,34 @@
 
 #include <QStringListModel>
 #include <QSortFilterProxyModel>
+#include <QBitArray>
+#include <QHash>
+#include <QMap>
 #include <stdint.h>
 
 class MultiFilterInterface {
 public:
-	MultiFilterInterface() : checkState(NULL), anyChecked(false) {}
-	virtual bool doFilter(struct dive *d, QModelIndex &index0, QAbstractItemModel *sourceModel) const = 0;
+	MultiFilterInterface() : checkState(NULL), anyChecked(false), nrDives(0) {}
+	bool doFilter(struct dive *d, QModelIndex &index0, QAbstractItemModel *sourceModel) const;
 	virtual void clearFilter() = 0;
+	int diveCount(int row) const;
+	QBitArray filteredDives() const;
 	bool *checkState;
 	bool anyChecked;
+
+protected:
+	/* The filters keep an inverted index: for each row of the list the
+	 * dives it applies to, by their index in the dive table. The last row
+	 * is for the dives that have no value set. */
+	virtual QStringList diveValues(struct dive *d) const = 0;
+	QStringList buildIndex(const QString &noValueName);
+	bool updateIndex(const QList<struct dive *> &dives);
+	bool indexIsCurrent() const;
+	QVector<QBitArray> rowDives;
+	QVector<int> rowDiveCount;
+	QHash<QString, int> valueRow;
+	QHash<struct dive *, int> diveIndex;
+	int nrDives;
 };
 
 class TagFilterModel : public QStringListModel, public MultiFilterInterface {
@@ -21,14 +40,15 @@ public:
 	virtual QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
 	virtual bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole);
 	virtual Qt::ItemFlags flags(const QModelIndex &index) const;
-	bool doFilter(struct dive *d, QModelIndex &index0, QAbstractItemModel *sourceModel) const;
 	void clearFilter();
+	void updateDives(const QList<struct dive *> &dives);
 public
 slots:
 	void repopulate();
 
 private:
 	explicit TagFilterModel(QObject *parent = 0);
+	QStringList diveValues(struct dive *d) const;
 };
 
 class BuddyFilterModel : public QStringListModel, public MultiFilterInterface {
@@ -38,14 +58,15 @@ public:
 	virtual QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
 	virtual bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole);
 	virtual Qt::ItemFlags flags(const QModelIndex &index) const;
-	bool doFilter(struct dive *d, QModelIndex &index0, QAbstractItemModel *sourceModel) const;
 	void clearFilter();
+	void updateDives(const QList<struct dive *> &dives);
 public
 slots:
 	void repopulate();
 
 private:
 	explicit BuddyFilterModel(QObject *parent = 0);
+	QStringList diveValues(struct dive *d) const;
 };
 
 class LocationFilterModel : public QStringListModel, public MultiFilterInterface {
@@ -55,14 +76,15 @@ public:
 	virtual QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
 	virtual bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole);
 	virtual Qt::ItemFlags flags(const QModelIndex &index) const;
-	bool doFilter(struct dive *d, QModelIndex &index0, QAbstractItemModel *sourceModel) const;
 	void clearFilter();
+	void updateDives(const QList<struct dive *> &dives);
 public
 slots:
 	void repopulate();
 
 private:
 	explicit LocationFilterModel(QObject *parent = 0);
+	QStringList diveValues(struct dive *d) const;
 };
 
 class SuitsFilterModel : public QStringListModel, public MultiFilterInterface {
@@ -72,14 +94,15 @@ public:
 	virtual QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
 	virtual bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole);
 	virtual Qt::ItemFlags flags(const QModelIndex &index) const;
-	bool doFilter(struct dive *d, QModelIndex &index0, QAbstractItemModel *sourceModel) const;
 	void clearFilter();
+	void updateDives(const QList<struct dive *> &dives);
 public
 slots:
 	void repopulate();
 
 private:
 	explicit SuitsFilterModel(QObject *parent = 0);
+	QStringList diveValues(struct dive *d) const;
 };
 
 class MultiFilterSortModel : public QSortFilterProxyModel {
@@ -96,14 +119,24 @@ slots:
 	void clearFilter();
 	void startFilterDiveSite(uint32_t uuid);
 	void stopFilterDiveSite();
+	void setSearchText(const QString &text);
 
 signals:
 	void filterFinished();
+private
+slots:
+	void updateVisibleDives();
+
 private:
 	MultiFilterSortModel(QObject *parent = 0);
 	QList<MultiFilterInterface *> models;
+	QString searchText;
 	bool justCleared;
 	struct dive_site *curr_dive_site;
+	/* the dives that pass all the filters, by their index in the dive table,
+	 * worked out whenever the filters change */
+	QBitArray visibleDives;
+	QHash<struct dive *, int> diveIndex;
 };
 
 #endif
@@ -919,15 +919,13 @@ void DiveListView::matchImagesToDives(QStringList fileNames)
 		return;
 	updateLastImageTimeOffset(shiftDialog.amount());
 
-	Q_FOREACH (const QString &fileName, fileNames) {
-		int j = 0;
-		struct dive *dive;
-		for_each_dive (j, dive) {
-			if (!dive->selected)
-				continue;
-			dive_create_picture(dive, copy_string(fileName.toUtf8().data()), shiftDialog.amount());
-		}
-	}
+	QList<QByteArray> names;
+	QVector<char *> files;
+	Q_FOREACH (const QString &fileName, fileNames)
+		names.append(fileName.toUtf8());
+	for (int i = 0; i < names.count(); i++)
+		files.append(names[i].data());
+	create_pictures_for_selected_dives(files.data(), files.count(), shiftDialog.amount());
 
 	mark_divelist_changed(true);
 	copy_dive(current_dive, &displayed_dive);
@@ -2,6 +2,7 @@
 #include <QShortcut>
 #include <QSettings>
 #include <QtConcurrent>
+#include <QProgressDialog>
 
 #include "divelogexportdialog.h"
 #include "divelogexportlogic.h"
@@ -60,6 +61,9 @@ DiveLogExportDialog::DiveLogExportDialog(QWidget *parent) : QDialog(parent),
 	if (settings.contains("exportPhotos")) {
 		ui->exportPhotos->setChecked(settings.value("exportPhotos").toBool());
 	}
+	if (settings.contains("diveShards")) {
+		ui->exportDiveShards->setChecked(settings.value("diveShards").toBool());
+	}
 	settings.endGroup();
 }
 
@@ -89,6 +93,23 @@ void DiveLogExportDialog::showExplanation()
 	}
 }
 
+/* shows the progress of the HTML export and lets the user cancel it */
+class HtmlExportProgressDialog : public HtmlExportProgress {
+public:
+	HtmlExportProgressDialog(QProgressDialog *dialog) : dialog(dialog)
+	{
+	}
+	bool update(int done, int total)
+	{
+		dialog->setMaximum(total);
+		dialog->setValue(done);
+		return !dialog->wasCanceled();
+	}
+
+private:
+	QProgressDialog *dialog;
+};
+
 void DiveLogExportDialog::exportHtmlInit(const QString &filename)
 {
 	struct htmlExportSetting hes;
@@ -96,13 +117,22 @@ void DiveLogExportDialog::exportHtmlInit(const QString &filename)
 	hes.exportPhotos = ui->exportPhotos->isChecked();
 	hes.selectedOnly = ui->exportSelectedDives->isChecked();
 	hes.listOnly = ui->exportListOnly->isChecked();
+	hes.shardDives = ui->exportDiveShards->isChecked();
 	hes.fontFamily = ui->fontSelection->itemData(ui->fontSelection->currentIndex()).toString();
 	hes.fontSize = ui->fontSizeSelection->currentText();
 	hes.themeSelection = ui->themeSelection->currentIndex();
 	hes.subsurfaceNumbers = ui->exportSubsurfaceNumber->isChecked();
 	hes.yearlyStatistics = ui->exportStatistics->isChecked();
 
-	exportHtmlInitLogic(filename, hes);
+	QProgressDialog dialog(tr("Exporting dives..."), tr("Cancel"), 0, 0, this);
+	dialog.setWindowModality(Qt::WindowModal);
+	dialog.setMinimumDuration(500);
+	HtmlExportProgressDialog progress(&dialog);
+	if (!exportHtmlInitLogic(filename, hes, &progress)) {
+		if (dialog.wasCanceled())
+			report_error("%s", qPrintable(tr("HTML export canceled")));
+		MainWindow::instance()->getNotificationWidget()->showNotification(get_error_string(), KMessageWidget::Error);
+	}
 }
 
 void DiveLogExportDialog::exportHTMLsettings(const QString &filename)
@@ -116,6 +146,7 @@ void DiveLogExportDialog::exportHTMLsettings(const QString &filename)
 	settings.setValue("yearlyStatistics", ui->exportStatistics->isChecked());
 	settings.setValue("listOnly", ui->exportListOnly->isChecked());
 	settings.setValue("exportPhotos", ui->exportPhotos->isChecked());
+	settings.setValue("diveShards", ui->exportDiveShards->isChecked());
 	settings.endGroup();
 
 }
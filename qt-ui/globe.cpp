@@ -9,6 +9,7 @@
 #include <QTimer>
 #include <QContextMenuEvent>
 #include <QMouseEvent>
+#include <QSet>
 
 #include <marble/AbstractFloatItem.h>
 #include <marble/GeoDataPlacemark.h>
@@ -38,7 +39,8 @@ GlobeGPS::GlobeGPS(QWidget *parent) : MarbleWidget(parent),
 	fixZoomTimer(new QTimer(this)),
 	currentZoomLevel(0),
 	needResetZoom(false),
-	editingDiveLocation(false)
+	editingDiveLocation(false),
+	clusterSize(0)
 {
 #ifdef MARBLE_SUBSURFACE_BRANCH
 	// we need to make sure this gets called after the command line arguments have
@@ -87,6 +89,7 @@ GlobeGPS::GlobeGPS(QWidget *parent) : MarbleWidget(parent),
 	setMinimumHeight(0);
 	setMinimumWidth(0);
 	connect(fixZoomTimer, SIGNAL(timeout()), this, SLOT(fixZoom()));
+	connect(this, SIGNAL(zoomChanged(int)), this, SLOT(updateClusters()));
 	fixZoomTimer->setSingleShot(true);
 	installEventFilter(this);
 }
@@ -162,21 +165,14 @@ void GlobeGPS::mouseClicked(qreal lon, qreal lat, GeoDataCoordinates::Unit unit)
 	struct dive *dive;
 	bool clear = !(QApplication::keyboardModifiers() & Qt::ControlModifier);
 	QList<int> selectedDiveIds;
+	QSet<uint32_t> sites;
+	Q_FOREACH (const DiveSiteGrid::Site &site, siteGrid.sitesNear(lat_udeg, lon_udeg, resolve))
+		sites.insert(site.uuid);
+	if (sites.isEmpty())
+		return;
 	for_each_dive (idx, dive) {
-		long lat_diff, lon_diff;
-		struct dive_site *ds = get_dive_site_for_dive(dive);
-		if (!dive_site_has_gps_location(ds))
-			continue;
-		lat_diff = labs(ds->latitude.udeg - lat_udeg);
-		lon_diff = labs(ds->longitude.udeg - lon_udeg);
-		if (lat_diff > 180000000)
-			lat_diff = 360000000 - lat_diff;
-		if (lon_diff > 180000000)
-			lon_diff = 180000000 - lon_diff;
-		if (lat_diff > resolve || lon_diff > resolve)
-			continue;
-
-		selectedDiveIds.push_back(idx);
+		if (sites.contains(dive->dive_site_uuid))
+			selectedDiveIds.push_back(idx);
 	}
 	if (selectedDiveIds.empty())
 		return;
@@ -185,50 +181,110 @@ void GlobeGPS::mouseClicked(qreal lon, qreal lat, GeoDataCoordinates::Unit unit)
 	MainWindow::instance()->dive_list()->selectDives(selectedDiveIds);
 }
 
-void GlobeGPS::repopulateLabels()
+/*
+ * When zoomed out, the dive sites in the same cell of a grid (in micro
+ * degrees) are drawn as a single marker. The cells get coarser in
+ * powers of two as the view gets further away, so that only zooming
+ * past one of those steps needs the markers to be rebuilt.
+ */
+static int clusterSizeForDistance(qreal distance)
+{
+	int size = 25000;
+
+	if (distance < 50)
+		return 0;
+	while (size < distance * 500 && size < 90000000)
+		size *= 2;
+	return size;
+}
+
+void GlobeGPS::updateClusters()
+{
+	if (clusterSizeForDistance(distance()) != clusterSize)
+		populateLabels();
+}
+
+static GeoDataPlacemark *placemarkForSite(struct dive_site *ds)
+{
+	GeoDataPlacemark *place = new GeoDataPlacemark(ds->name);
+	place->setCoordinate(ds->longitude.udeg / 1000000.0, ds->latitude.udeg / 1000000.0, 0, GeoDataCoordinates::Degree);
+	return place;
+}
+
+void GlobeGPS::populateLabels()
 {
 	struct dive_site *ds;
 	int idx;
-	QMap<QString, GeoDataPlacemark *> locationMap;
+	// sites we already placed a marker for, to not add a dive location twice
+	DiveSiteGrid placed(1000);
+	QHash<uint32_t, QString> placedNames;
+	QHash<quint64, QVector<struct dive_site *> > clusters;
 	if (loadedDives) {
 		model()->treeModel()->removeDocument(loadedDives);
 		delete loadedDives;
 	}
 	loadedDives = new GeoDataDocument;
+	siteGrid.clear();
+	clusterSize = clusterSizeForDistance(distance());
 
 	for_each_dive_site(idx, ds) {
+		if (!dive_site_has_gps_location(ds))
+			continue;
+		siteGrid.insert(ds->uuid, ds->latitude.udeg, ds->longitude.udeg);
 		if (ds->uuid == displayed_dive_site.uuid)
 			continue;
-		if (dive_site_has_gps_location(ds)) {
-			GeoDataPlacemark *place = new GeoDataPlacemark(ds->name);
-			place->setCoordinate(ds->longitude.udeg / 1000000.0, ds->latitude.udeg / 1000000.0, 0, GeoDataCoordinates::Degree);
-
-			// don't add dive locations twice, unless they are at least 50m apart
-			if (locationMap[QString(ds->name)]) {
-				GeoDataCoordinates existingLocation = locationMap[QString(ds->name)]->coordinate();
-				GeoDataLineString segment = GeoDataLineString();
-				segment.append(existingLocation);
-				GeoDataCoordinates newLocation = place->coordinate();
-				segment.append(newLocation);
-				double dist = segment.length(6371);
-				// the dist is scaled to the radius given - so with 6371km as radius
-				// 50m turns into 0.05 as threashold
-				if (dist < 0.05)
-					continue;
+		if (clusterSize) {
+			clusters[DiveSiteGrid::cellKey(ds->latitude.udeg, ds->longitude.udeg, clusterSize)].append(ds);
+			continue;
+		}
+
+		// don't add dive locations twice, unless they are at least 50m apart
+		// (50m is about 450 micro degrees of latitude, and more of longitude
+		// the further we are from the equator)
+		bool duplicate = false;
+		int radius = 450 / qMax(cos(udeg_to_radians(ds->latitude.udeg)), 0.01);
+		Q_FOREACH (const DiveSiteGrid::Site &site, placed.sitesNear(ds->latitude.udeg, ds->longitude.udeg, radius)) {
+			degrees_t latitude = { site.latitude }, longitude = { site.longitude };
+			if (placedNames.value(site.uuid) == QString(ds->name) &&
+			    get_distance(latitude, longitude, ds->latitude, ds->longitude) < 50) {
+				duplicate = true;
+				break;
 			}
-			locationMap[QString(ds->name)] = place;
-			loadedDives->append(place);
 		}
+		if (duplicate)
+			continue;
+		placed.insert(ds->uuid, ds->latitude.udeg, ds->longitude.udeg);
+		placedNames.insert(ds->uuid, QString(ds->name));
+		loadedDives->append(placemarkForSite(ds));
+	}
+
+	Q_FOREACH (const QVector<struct dive_site *> &cluster, clusters) {
+		if (cluster.count() == 1) {
+			loadedDives->append(placemarkForSite(cluster.first()));
+			continue;
+		}
+		qint64 latitude = 0, longitude = 0;
+		Q_FOREACH (struct dive_site *site, cluster) {
+			latitude += site->latitude.udeg;
+			longitude += site->longitude.udeg;
+		}
+		GeoDataPlacemark *place = new GeoDataPlacemark(tr("%1 dive sites").arg(cluster.count()));
+		place->setCoordinate(longitude / cluster.count() / 1000000.0, latitude / cluster.count() / 1000000.0, 0, GeoDataCoordinates::Degree);
+		loadedDives->append(place);
 	}
 
 	if (displayed_dive_site.uuid && dive_site_has_gps_location(&displayed_dive_site)) {
 		GeoDataPlacemark *place = new GeoDataPlacemark(displayed_dive_site.name);
 		place->setCoordinate(displayed_dive_site.longitude.udeg / 1000000.0,
 							 displayed_dive_site.latitude.udeg / 1000000.0, 0, GeoDataCoordinates::Degree);
-		locationMap[QString(displayed_dive_site.name)] = place;
 		loadedDives->append(place);
 	}
 	model()->treeModel()->addDocument(loadedDives);
+}
+
+void GlobeGPS::repopulateLabels()
+{
+	populateLabels();
 
 	struct dive_site *center = displayed_dive_site.uuid != 0 ?
 			&displayed_dive_site : current_dive ?
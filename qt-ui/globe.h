@@ -9,6 +9,8 @@
 
 #include <QHash>
 
+#include "divesitegrid.h"
+
 namespace Marble{
 	class GeoDataDocument;
 }
@@ -31,6 +33,8 @@ protected:
 	/* reimp */ void contextMenuEvent(QContextMenuEvent *);
 
 private:
+	void populateLabels();
+
 	GeoDataDocument *loadedDives;
 	KMessageWidget *messageWidget;
 	QTimer *fixZoomTimer;
@@ -38,6 +42,8 @@ private:
 	bool needResetZoom;
 	bool editingDiveLocation;
 	bool doubleClick;
+	DiveSiteGrid siteGrid;
+	int clusterSize;
 
 signals:
 	void coordinatesChanged();
@@ -45,6 +51,7 @@ signals:
 public
 slots:
 	void repopulateLabels();
+	void updateClusters();
 	void changeDiveGeoPosition(qreal lon, qreal lat, GeoDataCoordinates::Unit);
 	void mouseClicked(qreal lon, qreal lat, GeoDataCoordinates::Unit);
 	void fixZoom();
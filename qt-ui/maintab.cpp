@@ -22,6 +22,7 @@
 #include "divecomputerextradatamodel.h"
 #include "divelocationmodel.h"
 #include "divesite.h"
+#include "filtermodels.h"
 
 #if defined(FBSUPPORT)
 #include "socialnetworks.h"
@@ -34,6 +35,7 @@
 #include <QMessageBox>
 #include <QDesktopServices>
 #include <QStringList>
+#include <QSet>
 
 MainTab::MainTab(QWidget *parent) : QTabWidget(parent),
 	weightModel(new WeightModel(this)),
@@ -54,6 +56,7 @@ MainTab::MainTab(QWidget *parent) : QTabWidget(parent),
 	ui.weights->setModel(weightModel);
 	ui.photosView->setModel(divePictureModel);
 	connect(ui.photosView, SIGNAL(photoDoubleClicked(QString)), this, SLOT(photoDoubleClicked(QString)));
+	connect(&statisticsWatcher, SIGNAL(finished()), this, SLOT(updateSelectionStatistics()));
 	ui.extraData->setModel(extraDataModel);
 	closeMessage();
 
@@ -455,7 +458,6 @@ void MainTab::updateDiveInfo(bool clear)
 	struct dive *prevd;
 	char buf[1024];
 
-	process_selected_dives();
 	process_all_dives(&displayed_dive, &prevd);
 	ui.location->blockSignals(true);
 
@@ -605,87 +607,11 @@ void MainTab::updateDiveInfo(bool clear)
 			ui.salinityText->setText(QString("%1g/l").arg(displayed_dive.salinity / 10.0));
 		else
 			ui.salinityText->clear();
-		ui.depthLimits->setMaximum(get_depth_string(stats_selection.max_depth, true));
-		ui.depthLimits->setMinimum(get_depth_string(stats_selection.min_depth, true));
-		// the overall average depth is really confusing when listed between the
-		// deepest and shallowest dive - let's just not set it
-		// ui.depthLimits->setAverage(get_depth_string(stats_selection.avg_depth, true));
-		ui.depthLimits->overrideMaxToolTipText(tr("Deepest dive"));
-		ui.depthLimits->overrideMinToolTipText(tr("Shallowest dive"));
-		if (amount_selected > 1 && stats_selection.max_sac.mliter)
-			ui.sacLimits->setMaximum(get_volume_string(stats_selection.max_sac, true).append(tr("/min")));
-		else
-			ui.sacLimits->setMaximum("");
-		if (amount_selected > 1 && stats_selection.min_sac.mliter)
-			ui.sacLimits->setMinimum(get_volume_string(stats_selection.min_sac, true).append(tr("/min")));
-		else
-			ui.sacLimits->setMinimum("");
-		if (stats_selection.avg_sac.mliter)
-			ui.sacLimits->setAverage(get_volume_string(stats_selection.avg_sac, true).append(tr("/min")));
-		else
-			ui.sacLimits->setAverage("");
-		ui.sacLimits->overrideMaxToolTipText(tr("Highest total SAC of a dive"));
-		ui.sacLimits->overrideMinToolTipText(tr("Lowest total SAC of a dive"));
-		ui.sacLimits->overrideAvgToolTipText(tr("Average total SAC of all selected dives"));
-		ui.divesAllText->setText(QString::number(stats_selection.selection_size));
-		temp.mkelvin = stats_selection.max_temp;
-		ui.tempLimits->setMaximum(get_temperature_string(temp, true));
-		temp.mkelvin = stats_selection.min_temp;
-		ui.tempLimits->setMinimum(get_temperature_string(temp, true));
-		if (stats_selection.combined_temp && stats_selection.combined_count) {
-			const char *unit;
-			get_temp_units(0, &unit);
-			ui.tempLimits->setAverage(QString("%1%2").arg(stats_selection.combined_temp / stats_selection.combined_count, 0, 'f', 1).arg(unit));
-		}
-		ui.tempLimits->overrideMaxToolTipText(tr("Highest temperature"));
-		ui.tempLimits->overrideMinToolTipText(tr("Lowest temperature"));
-		ui.tempLimits->overrideAvgToolTipText(tr("Average temperature of all selected dives"));
-		ui.totalTimeAllText->setText(get_time_string(stats_selection.total_time.seconds, 0));
-		int seconds = stats_selection.total_time.seconds;
-		if (stats_selection.selection_size)
-			seconds /= stats_selection.selection_size;
-		ui.timeLimits->setAverage(get_time_string(seconds, 0));
-		if (amount_selected > 1) {
-			ui.timeLimits->setMaximum(get_time_string(stats_selection.longest_time.seconds, 0));
-			ui.timeLimits->setMinimum(get_time_string(stats_selection.shortest_time.seconds, 0));
-		}
-		ui.timeLimits->overrideMaxToolTipText(tr("Longest dive"));
-		ui.timeLimits->overrideMinToolTipText(tr("Shortest dive"));
-		ui.timeLimits->overrideAvgToolTipText(tr("Average length of all selected dives"));
-		// now let's get some gas use statistics
-		QVector<QPair<QString, int> > gasUsed;
-		QString gasUsedString;
-		volume_t vol;
-		selectedDivesGasUsed(gasUsed);
-		for (int j = 0; j < 20; j++) {
-			if (gasUsed.isEmpty())
-				break;
-			QPair<QString, int> gasPair = gasUsed.last();
-			gasUsed.pop_back();
-			vol.mliter = gasPair.second;
-			gasUsedString.append(gasPair.first).append(": ").append(get_volume_string(vol, true)).append("\n");
-		}
-		if (!gasUsed.isEmpty())
-			gasUsedString.append("...");
-		volume_t o2_tot = {}, he_tot = {};
-		selected_dives_gas_parts(&o2_tot, &he_tot);
-
-		/* No need to show the gas mixing information if diving
-		 * with pure air, and only display the he / O2 part when
-		 * it is used.
-		 */
-		if (he_tot.mliter || o2_tot.mliter) {
-			gasUsedString.append(tr("These gases could be\nmixed from Air and using:\n"));
-			if (he_tot.mliter)
-				gasUsedString.append(QString("He: %1").arg(get_volume_string(he_tot, true)));
-			if (he_tot.mliter && o2_tot.mliter)
-				gasUsedString.append(tr(" and "));
-			if (o2_tot.mliter)
-				gasUsedString.append(QString("O2: %2\n").arg(get_volume_string(o2_tot, true)));
-		}
-		ui.gasConsumption->setText(gasUsedString);
+		// the statistics of the selection get filled in once they are worked out
+		statisticsWatcher.setFuture(selectedDivesStatistics());
 	} else {
 		/* clear the fields */
+		statisticsWatcher.cancel();
 		clearInfo();
 		clearStats();
 		clearEquipment();
@@ -705,6 +631,94 @@ void MainTab::updateDiveInfo(bool clear)
 	emit diveSiteChanged(displayed_dive.dive_site_uuid);
 }
 
+void MainTab::updateSelectionStatistics()
+{
+	if (statisticsWatcher.isCanceled())
+		return;
+	SelectionStatistics result = statisticsWatcher.result();
+	temperature_t temp;
+
+	stats_selection = result.stats;
+	ui.depthLimits->setMaximum(get_depth_string(stats_selection.max_depth, true));
+	ui.depthLimits->setMinimum(get_depth_string(stats_selection.min_depth, true));
+	// the overall average depth is really confusing when listed between the
+	// deepest and shallowest dive - let's just not set it
+	// ui.depthLimits->setAverage(get_depth_string(stats_selection.avg_depth, true));
+	ui.depthLimits->overrideMaxToolTipText(tr("Deepest dive"));
+	ui.depthLimits->overrideMinToolTipText(tr("Shallowest dive"));
+	if (amount_selected > 1 && stats_selection.max_sac.mliter)
+		ui.sacLimits->setMaximum(get_volume_string(stats_selection.max_sac, true).append(tr("/min")));
+	else
+		ui.sacLimits->setMaximum("");
+	if (amount_selected > 1 && stats_selection.min_sac.mliter)
+		ui.sacLimits->setMinimum(get_volume_string(stats_selection.min_sac, true).append(tr("/min")));
+	else
+		ui.sacLimits->setMinimum("");
+	if (stats_selection.avg_sac.mliter)
+		ui.sacLimits->setAverage(get_volume_string(stats_selection.avg_sac, true).append(tr("/min")));
+	else
+		ui.sacLimits->setAverage("");
+	ui.sacLimits->overrideMaxToolTipText(tr("Highest total SAC of a dive"));
+	ui.sacLimits->overrideMinToolTipText(tr("Lowest total SAC of a dive"));
+	ui.sacLimits->overrideAvgToolTipText(tr("Average total SAC of all selected dives"));
+	ui.divesAllText->setText(QString::number(stats_selection.selection_size));
+	temp.mkelvin = stats_selection.max_temp;
+	ui.tempLimits->setMaximum(get_temperature_string(temp, true));
+	temp.mkelvin = stats_selection.min_temp;
+	ui.tempLimits->setMinimum(get_temperature_string(temp, true));
+	if (stats_selection.combined_temp && stats_selection.combined_count) {
+		const char *unit;
+		get_temp_units(0, &unit);
+		ui.tempLimits->setAverage(QString("%1%2").arg(stats_selection.combined_temp / stats_selection.combined_count, 0, 'f', 1).arg(unit));
+	}
+	ui.tempLimits->overrideMaxToolTipText(tr("Highest temperature"));
+	ui.tempLimits->overrideMinToolTipText(tr("Lowest temperature"));
+	ui.tempLimits->overrideAvgToolTipText(tr("Average temperature of all selected dives"));
+	ui.totalTimeAllText->setText(get_time_string(stats_selection.total_time.seconds, 0));
+	int seconds = stats_selection.total_time.seconds;
+	if (stats_selection.selection_size)
+		seconds /= stats_selection.selection_size;
+	ui.timeLimits->setAverage(get_time_string(seconds, 0));
+	if (amount_selected > 1) {
+		ui.timeLimits->setMaximum(get_time_string(stats_selection.longest_time.seconds, 0));
+		ui.timeLimits->setMinimum(get_time_string(stats_selection.shortest_time.seconds, 0));
+	}
+	ui.timeLimits->overrideMaxToolTipText(tr("Longest dive"));
+	ui.timeLimits->overrideMinToolTipText(tr("Shortest dive"));
+	ui.timeLimits->overrideAvgToolTipText(tr("Average length of all selected dives"));
+	// now let's get some gas use statistics
+	QVector<QPair<QString, int> > gasUsed;
+	QString gasUsedString;
+	volume_t vol;
+	sortedGasUsed(result.gasUsed, gasUsed);
+	for (int j = 0; j < 20; j++) {
+		if (gasUsed.isEmpty())
+			break;
+		QPair<QString, int> gasPair = gasUsed.last();
+		gasUsed.pop_back();
+		vol.mliter = gasPair.second;
+		gasUsedString.append(gasPair.first).append(": ").append(get_volume_string(vol, true)).append("\n");
+	}
+	if (!gasUsed.isEmpty())
+		gasUsedString.append("...");
+	volume_t o2_tot = result.o2, he_tot = result.he;
+
+	/* No need to show the gas mixing information if diving
+	 * with pure air, and only display the he / O2 part when
+	 * it is used.
+	 */
+	if (he_tot.mliter || o2_tot.mliter) {
+		gasUsedString.append(tr("These gases could be\nmixed from Air and using:\n"));
+		if (he_tot.mliter)
+			gasUsedString.append(QString("He: %1").arg(get_volume_string(he_tot, true)));
+		if (he_tot.mliter && o2_tot.mliter)
+			gasUsedString.append(tr(" and "));
+		if (o2_tot.mliter)
+			gasUsedString.append(QString("O2: %2\n").arg(get_volume_string(o2_tot, true)));
+	}
+	ui.gasConsumption->setText(gasUsedString);
+}
+
 void MainTab::addCylinder_clicked()
 {
 	if (editMode == NONE)
@@ -928,7 +942,9 @@ void MainTab::acceptChanges()
 			MainWindow::instance()->graphics()->replot();
 		MainWindow::instance()->dive_list()->rememberSelection();
 		sort_table(&dive_table);
-		MainWindow::instance()->refreshDisplay();
+		updateFilters();
+		MainWindow::instance()->refreshDisplay(false);
+		MainWindow::instance()->recreateDiveList(false);
 		MainWindow::instance()->dive_list()->restoreSelection();
 	}
 	DivePlannerPointsModel::instance()->setPlanMode(DivePlannerPointsModel::NOTHING);
@@ -940,6 +956,33 @@ void MainTab::acceptChanges()
 	acceptingEdit = false;
 }
 
+/*
+ * Only the edited dives changed, so move them to the rows of their new
+ * values in the filters instead of rebuilding those; renaming a dive site
+ * changes the location of all the dives there. The filters repopulate
+ * themselves if that isn't enough (new values, dives moved in the table).
+ */
+void MainTab::updateFilters()
+{
+	QList<struct dive *> editedDives;
+	QSet<uint32_t> sites;
+	struct dive *d;
+	int i;
+
+	for_each_dive (i, d) {
+		if (d->selected && d->dive_site_uuid)
+			sites.insert(d->dive_site_uuid);
+	}
+	for_each_dive (i, d) {
+		if (d->selected || (d->dive_site_uuid && sites.contains(d->dive_site_uuid)))
+			editedDives.append(d);
+	}
+	TagFilterModel::instance()->updateDives(editedDives);
+	BuddyFilterModel::instance()->updateDives(editedDives);
+	LocationFilterModel::instance()->updateDives(editedDives);
+	SuitsFilterModel::instance()->updateDives(editedDives);
+}
+
 void MainTab::resetPallete()
 {
 	QPalette p;
@@ -11,10 +11,12 @@
 #include <QDialog>
 #include <QMap>
 #include <QUuid>
+#include <QFutureWatcher>
 
 #include "ui_maintab.h"
 #include "completionmodels.h"
 #include "dive.h"
+#include "helpers.h"
 
 class WeightModel;
 class CylindersModel;
@@ -96,6 +98,7 @@ slots:
 	void enableGeoLookupEdition();
 	void disableGeoLookupEdition();
 	void setCurrentLocationIndex();
+	void updateSelectionStatistics();
 private:
 	Ui::MainTab ui;
 	WeightModel *weightModel;
@@ -112,6 +115,7 @@ private:
 	bool modified;
 	bool copyPaste;
 	void resetPallete();
+	void updateFilters();
 	void saveTags();
 	void saveTaggedStrings();
 	void diffTaggedStrings(QString currentString, QString displayedString, QStringList &addedList, QStringList &removedList);
@@ -119,6 +123,7 @@ private:
 	dive_trip_t *currentTrip;
 	dive_trip_t displayedTrip;
 	bool acceptingEdit;
+	QFutureWatcher<SelectionStatistics> statisticsWatcher;
 };
 
 #endif // MAINTAB_H
@@ -11,6 +11,7 @@
 #include <QSettings>
 #include <QShortcut>
 #include <QToolBar>
+#include <QProgressDialog>
 #include "version.h"
 #include "divelistview.h"
 #include "downloadfromdivecomputer.h"
@@ -38,6 +39,8 @@
 #include "divelogexportdialog.h"
 #include "usersurvey.h"
 #include "divesitehelpers.h"
+#include "diveimport.h"
+#include "divesearchindex.h"
 #include "locationinformation.h"
 #include "windowtitleupdate.h"
 #ifndef NO_USERMANUAL
@@ -279,13 +282,17 @@ void MainWindow::refreshDisplay(bool doRecreateDiveList)
 		cleanUpEmpty();
 }
 
-void MainWindow::recreateDiveList()
+void MainWindow::recreateDiveList(bool repopulateFilters)
 {
+	// the filters index the dive table, so they need to be up to date before the list filters the dives
+	if (repopulateFilters) {
+		TagFilterModel::instance()->repopulate();
+		BuddyFilterModel::instance()->repopulate();
+		LocationFilterModel::instance()->repopulate();
+		SuitsFilterModel::instance()->repopulate();
+	}
+	DiveSearchIndex::instance()->update();
 	dive_list()->reload(DiveTripModel::CURRENT);
-	TagFilterModel::instance()->repopulate();
-	BuddyFilterModel::instance()->repopulate();
-	LocationFilterModel::instance()->repopulate();
-	SuitsFilterModel::instance()->repopulate();
 }
 
 void MainWindow::current_dive_changed(int divenr)
@@ -1468,13 +1475,26 @@ void MainWindow::importFiles(const QStringList fileNames)
 	if (fileNames.isEmpty())
 		return;
 
-	QByteArray fileNamePtr;
-
-	for (int i = 0; i < fileNames.size(); ++i) {
-		fileNamePtr = QFile::encodeName(fileNames.at(i));
-		parse_file(fileNamePtr.data());
+	// the files are read in the background and parsed into a private table
+	// one by one; the parsers touch the global trips and sites, so events
+	// only get processed (by the modal progress dialog) in between files,
+	// and the result is merged into the dive list once all files are done.
+	// A canceled import is undone when it goes out of scope
+	{
+		DiveImport import(fileNames);
+		QProgressDialog progress(tr("Importing dive log files"), tr("Cancel"), 0, import.count(), this);
+		progress.setWindowModality(Qt::WindowModal);
+		progress.setMinimumDuration(500);
+		for (int i = 0; !import.atEnd() && !progress.wasCanceled(); i++) {
+			import.parseNext();
+			progress.setValue(i + 1);
+		}
+		if (!progress.wasCanceled())
+			import.commit();
 	}
-	process_dives(true, false);
+	QString warning = get_error_string();
+	if (!warning.isEmpty())
+		getNotificationWidget()->showNotification(warning, KMessageWidget::Information);
 	refreshDisplay();
 }
 
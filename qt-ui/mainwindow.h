@@ -180,7 +180,7 @@ slots:
 	void turnOffNdlTts();
 	void readSettings();
 	void refreshDisplay(bool doRecreateDiveList = true);
-	void recreateDiveList();
+	void recreateDiveList(bool repopulateFilters = true);
 	void showProfile();
 	void editCurrentDive();
 	void planCanceled();
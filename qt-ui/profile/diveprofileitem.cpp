@@ -15,6 +15,7 @@
 #include "diveplanner.h"
 
 #include <QSettings>
+#include <QGraphicsView>
 
 AbstractProfilePolygonItem::AbstractProfilePolygonItem() : QObject(), QGraphicsPolygonItem(), hAxis(NULL), vAxis(NULL), dataModel(NULL), hDataColumn(-1), vDataColumn(-1)
 {
@@ -85,6 +86,48 @@ bool AbstractProfilePolygonItem::shouldCalculateStuff(const QModelIndex &topLeft
 	return true;
 }
 
+/*
+ * Of all the points that fall into the same column of half a device pixel
+ * only the first, the lowest, the highest and the last are kept. This bounds
+ * the size of the polygons by the width of the view instead of the sample
+ * rate of the dive computer, and nothing visible gets lost. The columns
+ * depend on the view transform, so the polygons are rebuilt on zoom.
+ */
+QPolygonF AbstractProfilePolygonItem::decimate(const QPolygonF &poly, QVector<int> *rows) const
+{
+	QPolygonF ret;
+	int i = 0, count = poly.count();
+
+	if (rows)
+		rows->clear();
+	if (!scene() || scene()->views().isEmpty()) {
+		for (i = 0; rows && i < count; i++)
+			rows->append(i);
+		return poly;
+	}
+
+	qreal columnsPerUnit = 2 * scene()->views().first()->transform().m11();
+	while (i < count) {
+		qreal column = floor(poly[i].x() * columnsPerUnit);
+		int first = i, min = i, max = i;
+		while (++i < count && floor(poly[i].x() * columnsPerUnit) == column) {
+			if (poly[i].y() < poly[min].y())
+				min = i;
+			if (poly[i].y() > poly[max].y())
+				max = i;
+		}
+		int keep[4] = { first, qMin(min, max), qMax(min, max), i - 1 };
+		for (int k = 0; k < 4; k++) {
+			if (k && keep[k] == keep[k - 1])
+				continue;
+			ret.append(poly[keep[k]]);
+			if (rows)
+				rows->append(keep[k]);
+		}
+	}
+	return ret;
+}
+
 void AbstractProfilePolygonItem::modelDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
 {
 	// We don't have enougth data to calculate things, quit.
@@ -101,7 +144,7 @@ void AbstractProfilePolygonItem::modelDataChanged(const QModelIndex &topLeft, co
 		QPointF point(hAxis->posAtValue(horizontalValue), vAxis->posAtValue(verticalValue));
 		poly.append(point);
 	}
-	setPolygon(poly);
+	setPolygon(decimate(poly, &polygonRows));
 
 	qDeleteAll(texts);
 	texts.clear();
@@ -130,8 +173,8 @@ void DiveProfileItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *o
 	pen.setWidth(2);
 	QPolygonF poly = polygon();
 	// This paints the colors of the velocities.
-	for (int i = 1, count = dataModel->rowCount(); i < count; i++) {
-		QModelIndex colorIndex = dataModel->index(i, DivePlotDataModel::COLOR);
+	for (int i = 1, count = polygonRows.count(); i < count; i++) {
+		QModelIndex colorIndex = dataModel->index(polygonRows[i], DivePlotDataModel::COLOR);
 		pen.setBrush(QBrush(colorIndex.data(Qt::BackgroundRole).value<QColor>()));
 		painter->setPen(pen);
 		painter->drawLine(poly[i - 1], poly[i]);
@@ -142,10 +185,13 @@ void DiveProfileItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *o
 int DiveProfileItem::maxCeiling(int row)
 {
 	int max = -1;
-	plot_data *entry = dataModel->data().entry + row;
+	const plot_info &pInfo = dataModel->data();
+	if (!pInfo.tissues)
+		return max;
+	plot_tissue_data *tissues = pInfo.tissues + row;
 	for (int tissue = 0; tissue < 16; tissue++) {
-		if (max < entry->ceilings[tissue])
-			max = entry->ceilings[tissue];
+		if (max < tissues->ceilings[tissue])
+			max = tissues->ceilings[tissue];
 	}
 	return max;
 }
@@ -182,7 +228,7 @@ void DiveProfileItem::modelDataChanged(const QModelIndex &topLeft, const QModelI
 
 	/* Show any ceiling we may have encountered */
 	if (prefs.dcceiling && !prefs.redceiling) {
-		QPolygonF p = polygon();
+		QPolygonF p;
 		plot_data *entry = dataModel->data().entry + dataModel->rowCount() - 1;
 		for (int i = dataModel->rowCount() - 1; i >= 0; i--, entry--) {
 			if (!entry->in_deco) {
@@ -192,7 +238,7 @@ void DiveProfileItem::modelDataChanged(const QModelIndex &topLeft, const QModelI
 				p.append(QPointF(hAxis->posAtValue(entry->sec), vAxis->posAtValue(qMin(entry->stopdepth, entry->depth))));
 			}
 		}
-		setPolygon(p);
+		setPolygon(polygon() + decimate(p));
 	}
 
 	// This is the blueish gradient that the Depth Profile should have.
@@ -202,19 +248,23 @@ void DiveProfileItem::modelDataChanged(const QModelIndex &topLeft, const QModelI
 	pat.setColorAt(0, getColor(DEPTH_TOP));
 	setBrush(QBrush(pat));
 
+	const plot_info &pInfo = dataModel->data();
+	if (!pInfo.minmax)
+		return;
 	int last = -1;
 	for (int i = 0, count = dataModel->rowCount(); i < count; i++) {
 
-		struct plot_data *entry = dataModel->data().entry + i;
+		struct plot_data *entry = pInfo.entry + i;
+		struct plot_minmax_data *minmax = pInfo.minmax + i;
 		if (entry->depth < 2000)
 			continue;
 
-		if ((entry == entry->max[2]) && entry->depth / 100 != last) {
+		if ((entry == minmax->max[2]) && entry->depth / 100 != last) {
 			plot_depth_sample(entry, Qt::AlignHCenter | Qt::AlignBottom, getColor(SAMPLE_DEEP));
 			last = entry->depth / 100;
 		}
 
-		if ((entry == entry->min[2]) && entry->depth / 100 != last) {
+		if ((entry == minmax->min[2]) && entry->depth / 100 != last) {
 			plot_depth_sample(entry, Qt::AlignHCenter | Qt::AlignTop, getColor(SAMPLE_SHALLOW));
 			last = entry->depth / 100;
 		}
@@ -303,7 +353,7 @@ void DiveHeartrateItem::modelDataChanged(const QModelIndex &topLeft, const QMode
 		createTextItem(sec, hr);
 		last_printed_hr = hr;
 	}
-	setPolygon(poly);
+	setPolygon(decimate(poly));
 
 	if (texts.count())
 		texts.last()->setAlignment(Qt::AlignLeft | Qt::AlignBottom);
@@ -365,7 +415,7 @@ void DivePercentageItem::modelDataChanged(const QModelIndex &topLeft, const QMod
 		QPointF point(hAxis->posAtValue(sec), vAxis->posAtValue(hr));
 		poly.append(point);
 	}
-	setPolygon(poly);
+	setPolygon(decimate(poly));
 
 	if (texts.count())
 		texts.last()->setAlignment(Qt::AlignLeft | Qt::AlignBottom);
@@ -414,7 +464,7 @@ void DiveAmbPressureItem::modelDataChanged(const QModelIndex &topLeft, const QMo
 		QPointF point(hAxis->posAtValue(sec), vAxis->posAtValue(hr));
 		poly.append(point);
 	}
-	setPolygon(poly);
+	setPolygon(decimate(poly));
 
 	if (texts.count())
 		texts.last()->setAlignment(Qt::AlignLeft | Qt::AlignBottom);
@@ -463,7 +513,7 @@ void DiveGFLineItem::modelDataChanged(const QModelIndex &topLeft, const QModelIn
 		QPointF point(hAxis->posAtValue(sec), vAxis->posAtValue(hr));
 		poly.append(point);
 	}
-	setPolygon(poly);
+	setPolygon(decimate(poly));
 
 	if (texts.count())
 		texts.last()->setAlignment(Qt::AlignLeft | Qt::AlignBottom);
@@ -526,7 +576,7 @@ void DiveTemperatureItem::modelDataChanged(const QModelIndex &topLeft, const QMo
 			createTextItem(sec, mkelvin);
 		last_printed_temp = mkelvin;
 	}
-	setPolygon(poly);
+	setPolygon(decimate(poly));
 
 	/* it would be nice to print the end temperature, if it's
 	* different or if the last temperature print has been more
@@ -593,7 +643,7 @@ void DiveMeanDepthItem::modelDataChanged(const QModelIndex &topLeft, const QMode
 		poly.append(point);
 	}
 	lastRunningSum = meandepthvalue;
-	setPolygon(poly);
+	setPolygon(decimate(poly));
 	createTextItem();
 }
 
@@ -638,9 +688,12 @@ void DiveGasPressureItem::modelDataChanged(const QModelIndex &topLeft, const QMo
 	int last_index = -1;
 	int o2mbar;
 	QPolygonF boundingPoly, o2Poly; // This is the "Whole Item", but a pressure can be divided in N Polygons.
+	QVector<QVector<int> > rows;
 	polygons.clear();
-	if (displayed_dive.dc.divemode == CCR)
+	if (displayed_dive.dc.divemode == CCR) {
 		polygons.append(o2Poly);
+		rows.append(QVector<int>());
+	}
 
 	for (int i = 0, count = dataModel->rowCount(); i < count; i++) {
 		o2mbar = 0;
@@ -651,6 +704,7 @@ void DiveGasPressureItem::modelDataChanged(const QModelIndex &topLeft, const QMo
 
 		if (entry->cylinderindex != last_index) {
 			polygons.append(QPolygonF()); // this is the polygon that will be actually drawn on screen.
+			rows.append(QVector<int>());
 			last_index = entry->cylinderindex;
 		}
 		if (!mbar) {
@@ -660,13 +714,23 @@ void DiveGasPressureItem::modelDataChanged(const QModelIndex &topLeft, const QMo
 			QPointF o2point(hAxis->posAtValue(entry->sec), vAxis->posAtValue(o2mbar));
 			boundingPoly.push_back(o2point);
 			polygons.first().push_back(o2point);
+			rows.first().push_back(i);
 		}
 
 		QPointF point(hAxis->posAtValue(entry->sec), vAxis->posAtValue(mbar));
 		boundingPoly.push_back(point);    // The BoundingRect
 		polygons.last().push_back(point); // The polygon thta will be plotted.
+		rows.last().push_back(i);
 	}
 	setPolygon(boundingPoly);
+	polygonEntries.resize(polygons.count());
+	for (int i = 0; i < polygons.count(); i++) {
+		QVector<int> kept;
+		polygons[i] = decimate(polygons[i], &kept);
+		polygonEntries[i].clear();
+		Q_FOREACH (int k, kept)
+			polygonEntries[i].append(rows[i][k]);
+	}
 	qDeleteAll(texts);
 	texts.clear();
 	int mbar, cyl;
@@ -777,9 +841,10 @@ void DiveGasPressureItem::paint(QPainter *painter, const QStyleOptionGraphicsIte
 	pen.setWidth(2);
 	painter->save();
 	struct plot_data *entry;
-	Q_FOREACH (const QPolygonF &poly, polygons) {
-		entry = dataModel->data().entry;
-		for (int i = 1, count = poly.count(); i < count; i++, entry++) {
+	for (int p = 0; p < polygons.count(); p++) {
+		const QPolygonF &poly = polygons[p];
+		for (int i = 1, count = poly.count(); i < count; i++) {
+			entry = dataModel->data().entry + polygonEntries[p][i - 1];
 			pen.setBrush(getSacColor(entry->sac, displayed_dive.sac));
 			painter->setPen(pen);
 			painter->drawLine(poly[i - 1], poly[i]);
@@ -864,7 +929,7 @@ void DiveReportedCeiling::modelDataChanged(const QModelIndex &topLeft, const QMo
 			p.append(QPointF(hAxis->posAtValue(entry->sec), vAxis->posAtValue(0)));
 		}
 	}
-	setPolygon(p);
+	setPolygon(decimate(p));
 	QLinearGradient pat(0, p.boundingRect().top(), 0, p.boundingRect().bottom());
 	// does the user want the ceiling in "surface color" or in red?
 	if (prefs.redceiling) {
@@ -937,7 +1002,9 @@ void PartialPressureGasItem::modelDataChanged(const QModelIndex &topLeft, const
 			inAlertFragment = false;
 		}
 	}
-	setPolygon(poly);
+	setPolygon(decimate(poly));
+	for (int i = 0; i < alertPolygons.count(); i++)
+		alertPolygons[i] = decimate(alertPolygons[i]);
 	/*
 	createPPLegend(trUtf8("pN" UTF8_SUBSCRIPT_2),getColor(PN2), legendPos);
 	*/
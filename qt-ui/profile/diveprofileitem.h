@@ -60,12 +60,17 @@ protected:
 	 */
 	bool shouldCalculateStuff(const QModelIndex &topLeft, const QModelIndex &bottomRight);
 
+	/* thin out a polyline to what can be told apart at the current zoom level, keeping
+	 * the peaks; if 'rows' is given it gets the index in 'poly' of each point kept */
+	QPolygonF decimate(const QPolygonF &poly, QVector<int> *rows = 0) const;
+
 	DiveCartesianAxis *hAxis;
 	DiveCartesianAxis *vAxis;
 	DivePlotDataModel *dataModel;
 	int hDataColumn;
 	int vDataColumn;
 	QList<DiveTextItem *> texts;
+	QVector<int> polygonRows; // the model row of each point of the polygon
 };
 
 class DiveProfileItem : public AbstractProfilePolygonItem {
@@ -170,6 +175,7 @@ private:
 	void plotPressureValue(int mbar, int sec, QFlags<Qt::AlignmentFlag> align, double offset);
 	void plotGasValue(int mbar, int sec, struct gasmix gasmix, QFlags<Qt::AlignmentFlag> align, double offset);
 	QVector<QPolygonF> polygons;
+	QVector<QVector<int> > polygonEntries; // the plot entry of each point of the polygons
 };
 
 class DiveCalculatedCeiling : public AbstractProfilePolygonItem {
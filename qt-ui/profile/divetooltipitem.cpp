@@ -221,6 +221,9 @@ void ToolTipItem::readPos()
 void ToolTipItem::setPlotInfo(const plot_info &plot)
 {
 	pInfo = plot;
+	entryText.clear();
+	entryText.resize(pInfo.nr);
+	lastTime = -1;
 }
 
 void ToolTipItem::setTimeAxis(DiveCartesianAxis *axis)
@@ -246,9 +249,15 @@ void ToolTipItem::refresh(const QPointF &pos)
 	lastTime = time;
 	clear();
 
-	mb.len = 0;
-	entry = get_plot_details_new(&pInfo, time, &mb);
+	entry = get_plot_details_new(&pInfo, time, NULL);
 	if (entry) {
+		QString &text = entryText[entry - pInfo.entry];
+		if (text.isNull()) {
+			mb.len = 0;
+			get_plot_details_new(&pInfo, time, &mb);
+			text = QString::fromUtf8(mb.buffer, mb.len);
+		}
+
 		tissues.fill();
 		painter.setPen(QColor(0, 0, 0, 0));
 		painter.setBrush(QColor(LIMENADE1));
@@ -262,11 +271,14 @@ void ToolTipItem::refresh(const QPointF &pos)
 		painter.drawLine(0, 60 - AMB_PERCENTAGE * (entry->pressures.n2 + entry->pressures.he) / entry->ambpressure / 2,
 				16, 60 - AMB_PERCENTAGE * (entry->pressures.n2 + entry->pressures.he) / entry->ambpressure /2);
 		painter.setPen(QColor(0, 0, 0, 127));
-		for (int i=0; i<16; i++) {
-			painter.drawLine(i, 60, i, 60 - entry->percentages[i] / 2);
+		if (pInfo.tissues) {
+			plot_tissue_data *tissueData = pInfo.tissues + (entry - pInfo.entry);
+			for (int i=0; i<16; i++) {
+				painter.drawLine(i, 60, i, 60 - tissueData->percentages[i] / 2);
+			}
 		}
 		entryToolTip.first->setPixmap(tissues);
-		entryToolTip.second->setText(QString::fromUtf8(mb.buffer, mb.len));
+		entryToolTip.second->setText(text);
 	}
 
 	Q_FOREACH (QGraphicsItem *item, scene()->items(pos, Qt::IntersectsItemBoundingRect
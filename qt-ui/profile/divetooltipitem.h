@@ -59,6 +59,7 @@ private:
 	QRectF nextRectangle;
 	DiveCartesianAxis *timeAxis;
 	plot_info pInfo;
+	QVector<QString> entryText; // the description of each entry, once we needed it
 	int lastTime;
 	QTime refreshTime;
 	QList<QGraphicsItem*> oldSelection;
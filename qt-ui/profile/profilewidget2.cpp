@@ -450,6 +450,8 @@ void ProfileWidget2::setupItem(AbstractProfilePolygonItem *item, DiveCartesianAx
 	item->setVerticalDataColumn(vData);
 	item->setHorizontalDataColumn(hData);
 	item->setZValue(zValue);
+	// the polygons are thinned out to what the view can show
+	connect(this, SIGNAL(viewScaleChanged()), item, SLOT(modelDataChanged()));
 }
 
 void ProfileWidget2::setupSceneAndFlags()
@@ -731,6 +733,7 @@ void ProfileWidget2::resizeEvent(QResizeEvent *event)
 	QGraphicsView::resizeEvent(event);
 	fitInView(sceneRect(), Qt::IgnoreAspectRatio);
 	fixBackgroundPos();
+	emit viewScaleChanged();
 }
 
 void ProfileWidget2::mousePressEvent(QMouseEvent *event)
@@ -797,6 +800,7 @@ void ProfileWidget2::wheelEvent(QWheelEvent *event)
 		scale(1.0 / zoomFactor, 1.0 / zoomFactor);
 		zoomLevel--;
 	}
+	emit viewScaleChanged();
 	scrollViewTo(event->pos());
 	toolTipItem->setPos(mapToScene(toolTipPos));
 }
@@ -337,15 +337,25 @@ void ShiftImageTimesDialog::updateInvalid()
 	ui.invalidLabel->hide();
 	ui.invalidLabel->clear();
 
-	Q_FOREACH (const QString &fileName, fileNames) {
-		if (picture_check_valid(fileName.toUtf8().data(), m_amount))
+	QList<QByteArray> names;
+	QVector<char *> files;
+	Q_FOREACH (const QString &fileName, fileNames)
+		names.append(fileName.toUtf8());
+	for (int i = 0; i < names.count(); i++)
+		files.append(names[i].data());
+	QVector<timestamp_t> timestamps(files.count());
+	QVector<bool> valid(files.count());
+	pictures_check_valid(files.data(), files.count(), m_amount, timestamps.data(), valid.data());
+
+	for (int i = 0; i < fileNames.count(); i++) {
+		if (valid[i])
 			continue;
 
 		// We've found invalid image
-		timestamp = picture_get_timestamp(fileName.toUtf8().data());
+		timestamp = timestamps[i];
 		dcImageEpoch = timestamp;
 		time.setTime_t(timestamp + m_amount);
-		ui.invalidLabel->setText(ui.invalidLabel->text() + fileName + " " + time.toString() + "\n");
+		ui.invalidLabel->setText(ui.invalidLabel->text() + fileNames[i] + " " + time.toString() + "\n");
 		allValid = false;
 	}
 
@@ -678,6 +688,15 @@ MultiFilter::MultiFilter(QWidget *parent) : QWidget(parent)
 	connect(ui.clear, SIGNAL(clicked(bool)), MultiFilterSortModel::instance(), SLOT(clearFilter()));
 	connect(ui.maximize, SIGNAL(clicked(bool)), this, SLOT(adjustHeight()));
 
+	// free text search over notes, dive sites, buddies, suits and tags
+	QLineEdit *searchText = new QLineEdit(this);
+	searchText->setPlaceholderText(tr("Search"));
+	searchText->setToolTip(tr("Show the dives whose notes, dive site, buddy, divemaster, suit or tags contain all these words"));
+	ui.horizontalLayout->insertWidget(0, searchText);
+	connect(searchText, SIGNAL(textChanged(QString)), MultiFilterSortModel::instance(), SLOT(setSearchText(QString)));
+	connect(ui.clear, SIGNAL(clicked(bool)), searchText, SLOT(clear()));
+	connect(ui.close, SIGNAL(clicked(bool)), searchText, SLOT(clear()));
+
 	l->addWidget(tagFilter);
 	l->addWidget(new BuddyFilter());
 	l->addWidget(new LocationFilter());
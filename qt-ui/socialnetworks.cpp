@@ -17,6 +17,7 @@
 #include <QInputDialog>
 #include "mainwindow.h"
 #include "profile/profilewidget2.h"
+#include "profilerenderer.h"
 #include "pref.h"
 #include "helpers.h"
 #include "ui_socialnetworksdialog.h"
@@ -215,13 +216,12 @@ void FacebookManager::sendDive()
 	requestAlbumId();
 
 	ProfileWidget2 *profile = MainWindow::instance()->graphics();
-	profile->setToolTipVisibile(false);
-	QPixmap pix = QPixmap::grabWidget(profile);
-	profile->setToolTipVisibile(true);
+	ProfileImageOptions options = { profile->size(), false };
+	QImage image = profileImage(current_dive, current_dc, options);
 	QByteArray bytes;
 	QBuffer buffer(&bytes);
 	buffer.open(QIODevice::WriteOnly);
-	pix.save(&buffer, "PNG");
+	image.save(&buffer, "PNG");
 	QUrl url("https://graph.facebook.com/v2.2/" + QString(prefs.facebook.album_id) + "/photos?" +
 		 "&access_token=" + QString(prefs.facebook.access_token) +
 		 "&source=image" +
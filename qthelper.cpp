@@ -25,6 +25,7 @@
 #include <QDateTime>
 #include <QImageReader>
 #include <QtConcurrent>
+#include <QSharedPointer>
 
 #include <libxslt/documents.h>
 
@@ -323,22 +324,6 @@ extern "C" xsltStylesheetPtr get_stylesheet(const char *name)
 }
 
 
-extern "C" timestamp_t picture_get_timestamp(char *filename)
-{
-	EXIFInfo exif;
-	memblock mem;
-	int retval;
-
-	// filename might not be the actual filename, so let's go via the hash.
-	if (readfile(localFilePath(QString(filename)).toUtf8().data(), &mem) <= 0)
-		return 0;
-	retval = exif.parseFrom((const unsigned char *)mem.buffer, (unsigned)mem.size);
-	free(mem.buffer);
-	if (retval != PARSE_EXIF_SUCCESS)
-		return 0;
-	return exif.epoch();
-}
-
 extern "C" const char *system_default_directory(void)
 {
 	static char filename[PATH_MAX];
@@ -380,44 +365,77 @@ extern "C" void copy_image_and_overwrite(const char *cfileName, const char *cnew
 	QFile::copy(fileName, newName);
 }
 
-extern "C" bool string_sequence_contains(const char *string_sequence, const char *text)
+static bool lessThan(const QPair<QString, int> &a, const QPair<QString, int> &b)
 {
-	if (same_string(text, "") || same_string(string_sequence, ""))
-		return false;
+	return a.second < b.second;
+}
 
-	QString stringSequence(string_sequence);
-	QStringList strings = stringSequence.split(",", QString::SkipEmptyParts);
-	Q_FOREACH (const QString& string, strings) {
-		if (string.trimmed().compare(QString(text).trimmed(), Qt::CaseInsensitive) == 0)
-			return true;
+SelectionStatistics::SelectionStatistics()
+{
+	memset(&stats, 0, sizeof(stats));
+	o2.mliter = 0;
+	he.mliter = 0;
+}
+
+// the map step: runs on a worker thread and only looks at the copy of the dive's data
+static SelectionStatistics diveStatistics(const QSharedPointer<struct selected_dive_info> &dive)
+{
+	SelectionStatistics result;
+	volume_t diveGases[MAX_CYLINDERS] = {};
+	char gas[64];
+
+	process_selected_dive_info(dive.data(), &result.stats, diveGases);
+	for (int j = 0; j < MAX_CYLINDERS; j++) {
+		if (!diveGases[j].mliter)
+			continue;
+		// not gasname(), its buffer is shared by all the threads
+		get_gas_string(&dive->dive.cylinder[j].gasmix, gas, sizeof(gas));
+		result.gasUsed[gas] += diveGases[j].mliter;
 	}
-	return false;
+	add_gas_parts(dive->dive.cylinder, diveGases, &result.o2, &result.he);
+	return result;
 }
 
-static bool lessThan(const QPair<QString, int> &a, const QPair<QString, int> &b)
+static void mergeStatistics(SelectionStatistics &result, const SelectionStatistics &part)
 {
-	return a.second < b.second;
+	merge_stats(&result.stats, &part.stats);
+	QMap<QString, int>::const_iterator it;
+	for (it = part.gasUsed.constBegin(); it != part.gasUsed.constEnd(); ++it)
+		result.gasUsed[it.key()] += it.value();
+	result.o2.mliter += part.o2.mliter;
+	result.he.mliter += part.he.mliter;
 }
 
-void selectedDivesGasUsed(QVector<QPair<QString, int> > &gasUsedOrdered)
+/*
+ * Work out the statistics and gas use of the selected dives in the
+ * background. Only copying what's needed of the dives happens here, so
+ * they can be edited or deleted while this runs; the statistics, the
+ * walk over the gas changes and the gas use are all done on the thread
+ * pool. The copies go away with the last reference to them, even if
+ * the calculation is canceled.
+ */
+QFuture<SelectionStatistics> selectedDivesStatistics()
 {
-	int i, j;
+	int i;
 	struct dive *d;
-	QMap<QString, int> gasUsed;
+	QVector<QSharedPointer<struct selected_dive_info> > dives;
+
+	dives.reserve(amount_selected);
 	for_each_dive (i, d) {
 		if (!d->selected)
 			continue;
-		volume_t diveGases[MAX_CYLINDERS] = {};
-		get_gas_used(d, diveGases);
-		for (j = 0; j < MAX_CYLINDERS; j++)
-			if (diveGases[j].mliter) {
-				QString gasName = gasname(&d->cylinder[j].gasmix);
-				gasUsed[gasName] += diveGases[j].mliter;
-			}
-	}
-	Q_FOREACH(const QString& gas, gasUsed.keys()) {
-		gasUsedOrdered.append(qMakePair(gas, gasUsed[gas]));
+		struct selected_dive_info *info = get_selected_dive_info(d);
+		if (info)
+			dives.append(QSharedPointer<struct selected_dive_info>(info, free_selected_dive_info));
 	}
+	return QtConcurrent::mappedReduced(dives, diveStatistics, mergeStatistics, QtConcurrent::UnorderedReduce);
+}
+
+void sortedGasUsed(const QMap<QString, int> &gasUsed, QVector<QPair<QString, int> > &gasUsedOrdered)
+{
+	QMap<QString, int>::const_iterator it;
+	for (it = gasUsed.constBegin(); it != gasUsed.constEnd(); ++it)
+		gasUsedOrdered.append(qMakePair(it.key(), it.value()));
 	qSort(gasUsedOrdered.begin(), gasUsedOrdered.end(), lessThan);
 }
 
@@ -781,6 +799,128 @@ QHash<QString, QByteArray> hashOf;
 QMutex hashOfMutex;
 QHash<QByteArray, QString> localFilenameOf;
 
+/*
+ * What we know about an image file: its hash and the bits of the EXIF
+ * data we care about. This is kept across sessions and is valid as long
+ * as the file's size and modification time don't change, so rescanning
+ * a directory tree only needs to look at new or changed files.
+ */
+#define IMAGE_CACHE_VERSION 1
+
+struct image_info {
+	qint64 size;
+	qint64 mtime;
+	QByteArray hash;
+	bool exif_valid;
+	qint64 timestamp;
+	qint32 latitude, longitude;
+};
+
+static QHash<QString, struct image_info> imageInfoOf;
+static QMutex imageInfoMutex;
+
+static QDataStream &operator<<(QDataStream &stream, const struct image_info &info)
+{
+	return stream << info.size << info.mtime << info.hash << info.exif_valid <<
+			 info.timestamp << info.latitude << info.longitude;
+}
+
+static QDataStream &operator>>(QDataStream &stream, struct image_info &info)
+{
+	return stream >> info.size >> info.mtime >> info.hash >> info.exif_valid >>
+			 info.timestamp >> info.latitude >> info.longitude;
+}
+
+/* look up the cache entry for a file; a stale entry is reset to the current size / mtime */
+static bool cachedImageInfo(const QString &filename, struct image_info *info)
+{
+	QFileInfo fi(filename);
+	qint64 mtime = fi.lastModified().toMSecsSinceEpoch();
+	QMutexLocker locker(&imageInfoMutex);
+	QHash<QString, struct image_info>::const_iterator it = imageInfoOf.constFind(filename);
+
+	if (it != imageInfoOf.constEnd() && it->size == fi.size() && it->mtime == mtime) {
+		*info = *it;
+		return true;
+	}
+	info->size = fi.size();
+	info->mtime = mtime;
+	info->hash.clear();
+	info->exif_valid = false;
+	info->timestamp = 0;
+	info->latitude = info->longitude = 0;
+	return false;
+}
+
+static void storeImageInfo(const QString &filename, const struct image_info &info)
+{
+	QMutexLocker locker(&imageInfoMutex);
+	imageInfoOf[filename] = info;
+}
+
+/*
+ * JPEG files consist of marker segments, and the EXIF data lives in an
+ * APP1 segment before the actual image data. So walk the segment headers
+ * and only read that one segment instead of the whole (possibly huge)
+ * image file.
+ */
+static int parseExifHeader(const QString &filename, EXIFInfo &exif)
+{
+	QFile imagefile(filename);
+	unsigned char marker[4];
+
+	if (!imagefile.open(QIODevice::ReadOnly))
+		return PARSE_EXIF_ERROR_NO_JPEG;
+	if (imagefile.read((char *)marker, 2) != 2 || marker[0] != 0xFF || marker[1] != 0xD8)
+		return PARSE_EXIF_ERROR_NO_JPEG;
+	exif.clear();
+	for (;;) {
+		unsigned length;
+
+		if (imagefile.read((char *)marker, 4) != 4 || marker[0] != 0xFF)
+			return PARSE_EXIF_ERROR_CORRUPT;
+		/* start of scan / end of image: there is no more meta data */
+		if (marker[1] == 0xDA || marker[1] == 0xD9)
+			return PARSE_EXIF_ERROR_NO_EXIF;
+		length = marker[2] << 8 | marker[3];
+		if (length < 2)
+			return PARSE_EXIF_ERROR_CORRUPT;
+		if (marker[1] == 0xE1) {
+			QByteArray segment = imagefile.read(length - 2);
+			int retval = exif.parseFromEXIFSegment((const unsigned char *)segment.constData(), segment.size());
+			/* APP1 is also used for XMP data, so keep looking */
+			if (retval != PARSE_EXIF_ERROR_NO_EXIF)
+				return retval;
+		} else if (!imagefile.seek(imagefile.pos() + length - 2)) {
+			return PARSE_EXIF_ERROR_CORRUPT;
+		}
+	}
+}
+
+/* get the EXIF meta data of an image file, from the cache if it is still valid */
+static bool imageMetaData(const QString &filename, struct image_info *info)
+{
+	EXIFInfo exif;
+
+	if (cachedImageInfo(filename, info))
+		return true;
+	if (!QFile::exists(filename))
+		return false;
+	if (parseExifHeader(filename, exif) == PARSE_EXIF_SUCCESS) {
+		info->exif_valid = true;
+		info->timestamp = exif.epoch();
+		info->latitude = lrint(1000000.0 * exif.GeoLocation.Latitude);
+		info->longitude = lrint(1000000.0 * exif.GeoLocation.Longitude);
+	}
+	storeImageInfo(filename, *info);
+	return true;
+}
+
+static QString imageCacheFilename()
+{
+	return QString(system_default_directory()).append("/imagecache");
+}
+
 extern "C" char * hashstring(char * filename)
 {
 	return hashOf[QString(filename)].toHex().data();
@@ -794,6 +934,16 @@ void read_hashes()
 		stream >> localFilenameOf;
 		hashfile.close();
 	}
+
+	QFile cachefile(imageCacheFilename());
+	if (cachefile.open(QIODevice::ReadOnly)) {
+		QDataStream stream(&cachefile);
+		quint32 version;
+		stream >> version;
+		if (version == IMAGE_CACHE_VERSION)
+			stream >> imageInfoOf;
+		cachefile.close();
+	}
 }
 
 void write_hashes()
@@ -806,6 +956,16 @@ void write_hashes()
 	} else {
 		qDebug() << "cannot open" << hashfile.fileName();
 	}
+
+	QSaveFile cachefile(imageCacheFilename());
+	if (cachefile.open(QIODevice::WriteOnly)) {
+		QDataStream stream(&cachefile);
+		QMutexLocker locker(&imageInfoMutex);
+		stream << (quint32)IMAGE_CACHE_VERSION << imageInfoOf;
+		cachefile.commit();
+	} else {
+		qDebug() << "cannot open" << cachefile.fileName();
+	}
 }
 
 void add_hash(const QString filename, QByteArray hash)
@@ -817,11 +977,24 @@ void add_hash(const QString filename, QByteArray hash)
 
 QByteArray hashFile(const QString filename)
 {
+	struct image_info info;
+
+	// unchanged files don't need to be read again
+	if (cachedImageInfo(filename, &info) && !info.hash.isEmpty()) {
+		add_hash(filename, info.hash);
+		return info.hash;
+	}
+
 	QCryptographicHash hash(QCryptographicHash::Sha1);
 	QFile imagefile(filename);
 	imagefile.open(QIODevice::ReadOnly);
 	hash.addData(&imagefile);
 	add_hash(filename, hash.result());
+
+	// keep the EXIF data we might already have for this version of the file
+	imageMetaData(filename, &info);
+	info.hash = hash.result();
+	storeImageInfo(filename, info);
 	return hash.result();
 }
 
@@ -856,6 +1029,66 @@ void updateHash(struct picture *picture) {
 	free(old);
 }
 
+/*
+ * On-disk store of picture thumbnails, keyed by the hash of the picture
+ * and the thumbnail size, so that each session doesn't have to decode
+ * all the full resolution images again just to show the thumbnails.
+ * Once the store grows beyond THUMBNAIL_CACHE_SIZE the oldest
+ * thumbnails are dropped.
+ */
+#define THUMBNAIL_CACHE_SIZE (128 * 1024 * 1024)
+
+static QMutex thumbnailMutex;
+static qint64 thumbnailCacheSize = -1;
+
+static QString thumbnailDir()
+{
+	return QStandardPaths::standardLocations(QStandardPaths::CacheLocation).first().append("/thumbnails/");
+}
+
+static QString thumbnailFilename(const char *hash, int size)
+{
+	return thumbnailDir().append(QString("%1-%2.jpg").arg(hash).arg(size));
+}
+
+QImage cachedThumbnail(const char *hash, int size)
+{
+	if (same_string(hash, ""))
+		return QImage();
+	return QImage(thumbnailFilename(hash, size));
+}
+
+void addThumbnailToCache(const char *hash, int size, const QImage &thumbnail)
+{
+	if (same_string(hash, "") || thumbnail.isNull())
+		return;
+
+	QMutexLocker locker(&thumbnailMutex);
+	QDir dir(thumbnailDir());
+	QString filename = thumbnailFilename(hash, size);
+	if (!dir.exists())
+		dir.mkpath(thumbnailDir());
+	if (!thumbnail.save(filename, "JPG", 85))
+		return;
+
+	if (thumbnailCacheSize >= 0) {
+		thumbnailCacheSize += QFileInfo(filename).size();
+		if (thumbnailCacheSize <= THUMBNAIL_CACHE_SIZE)
+			return;
+	}
+	// oldest first
+	QFileInfoList thumbnails = dir.entryInfoList(QDir::Files, QDir::Time | QDir::Reversed);
+	thumbnailCacheSize = 0;
+	Q_FOREACH (const QFileInfo &fi, thumbnails)
+		thumbnailCacheSize += fi.size();
+	Q_FOREACH (const QFileInfo &fi, thumbnails) {
+		if (thumbnailCacheSize <= THUMBNAIL_CACHE_SIZE * 3 / 4)
+			break;
+		if (QFile::remove(fi.absoluteFilePath()))
+			thumbnailCacheSize -= fi.size();
+	}
+}
+
 void learnImages(const QDir dir, int max_recursions, bool recursed)
 {
 	QDir current(dir);
@@ -878,21 +1111,49 @@ void learnImages(const QDir dir, int max_recursions, bool recursed)
 	QtConcurrent::blockingMap(files, hashFile);
 }
 
+/* Lets the C core hand a set of independent items to the thread pool */
+class ConcurrentCall {
+public:
+	typedef void result_type;
+	ConcurrentCall(void (*func)(void *)) : func(func)
+	{
+	}
+	void operator()(void *item) const
+	{
+		func(item);
+	}
+
+private:
+	void (*func)(void *);
+};
+
+extern "C" void run_concurrently(void (*func)(void *), void *items, int nr, size_t size)
+{
+	QVector<void *> list(nr);
+
+	for (int i = 0; i < nr; i++)
+		list[i] = (char *)items + i * size;
+	QtConcurrent::blockingMap(list, ConcurrentCall(func));
+}
+
 extern "C" void picture_load_exif_data(struct picture *p)
 {
-	EXIFInfo exif;
-	memblock mem;
-
-	if (readfile(localFilePath(QString(p->filename)).toUtf8().data(), &mem) <= 0)
-		goto picture_load_exit;
-	if (exif.parseFrom((const unsigned char *)mem.buffer, (unsigned)mem.size) != PARSE_EXIF_SUCCESS)
-		goto picture_load_exit;
-	p->longitude.udeg= lrint(1000000.0 * exif.GeoLocation.Longitude);
-	p->latitude.udeg  = lrint(1000000.0 * exif.GeoLocation.Latitude);
-
-picture_load_exit:
-	free(mem.buffer);
-	return;
+	struct image_info info;
+
+	if (!imageMetaData(localFilePath(QString(p->filename)), &info) || !info.exif_valid)
+		return;
+	p->longitude.udeg = info.longitude;
+	p->latitude.udeg = info.latitude;
+}
+
+extern "C" timestamp_t picture_get_timestamp(char *filename)
+{
+	struct image_info info;
+
+	// filename might not be the actual filename, so let's go via the hash.
+	if (!imageMetaData(localFilePath(QString(filename)), &info) || !info.exif_valid)
+		return 0;
+	return info.timestamp;
 }
 
 QString get_gas_string(struct gasmix gas)
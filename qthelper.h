@@ -8,6 +8,7 @@
 #include "divelist.h"
 #include <QTranslator>
 #include <QDir>
+#include <QImage>
 
 // global pointers for our translation
 extern QTranslator *qtTranslator, *ssrfTranslator;
@@ -27,6 +28,8 @@ void add_hash(const QString filename, QByteArray hash);
 QString localFilePath(const QString originalFilename);
 QString fileFromHash(char *hash);
 void learnHash(struct picture *picture, QByteArray hash);
+QImage cachedThumbnail(const char *hash, int size);
+void addThumbnailToCache(const char *hash, int size, const QImage &thumbnail);
 weight_t string_to_weight(const char *str);
 depth_t string_to_depth(const char *str);
 pressure_t string_to_pressure(const char *str);
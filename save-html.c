@@ -25,7 +25,6 @@ void save_photos(struct membuffer *b, const char *photos_dir, struct dive *dive)
 		char *fname = get_file_name(pic->filename);
 		put_format(b, "{\"filename\":\"%s\"}", fname);
 		free(fname);
-		copy_image_and_overwrite(pic->filename, photos_dir);
 		pic = pic->next;
 	} while (pic);
 	put_string(b, "],");
@@ -156,8 +155,6 @@ static void put_cylinder_HTML(struct membuffer *b, struct dive *dive)
 void put_HTML_samples(struct membuffer *b, struct dive *dive)
 {
 	int i;
-	put_format(b, "\"maxdepth\":%d,", dive->dc.maxdepth.mm);
-	put_format(b, "\"duration\":%d,", dive->dc.duration.seconds);
 	struct sample *s = dive->dc.sample;
 
 	if (!dive->dc.samples)
@@ -301,6 +298,22 @@ void put_HTML_tags(struct membuffer *b, struct dive *dive, const char *pre, cons
 	put_string(b, post);
 }
 
+/*
+ * The part of a dive that is only needed by the detailed dive view:
+ * everything here ends in a comma, so it can go in front of any other field.
+ */
+void write_dive_details(struct membuffer *b, struct dive *dive, const char *photos_dir)
+{
+	put_cylinder_HTML(b, dive);
+	put_weightsystem_HTML(b, dive);
+	put_HTML_samples(b, dive);
+	put_HTML_bookmarks(b, dive);
+	write_dive_status(b, dive);
+	if (photos_dir && strcmp(photos_dir, ""))
+		save_photos(b, photos_dir, dive);
+	write_divecomputers(b, dive);
+}
+
 /* if exporting list_only mode, we neglect exporting the samples, bookmarks and cylinders */
 void write_one_dive(struct membuffer *b, struct dive *dive, const char *photos_dir, int *dive_no, const bool list_only)
 {
@@ -323,101 +336,124 @@ void write_one_dive(struct membuffer *b, struct dive *dive, const char *photos_d
 	write_attribute(b, "divemaster", dive->divemaster, ", ");
 	write_attribute(b, "suit", dive->suit, ", ");
 	put_HTML_tags(b, dive, "\"tags\":", ",");
-	if (!list_only) {
-		put_cylinder_HTML(b, dive);
-		put_weightsystem_HTML(b, dive);
-		put_HTML_samples(b, dive);
-		put_HTML_bookmarks(b, dive);
-		write_dive_status(b, dive);
-		if (photos_dir && strcmp(photos_dir, ""))
-			save_photos(b, photos_dir, dive);
-		write_divecomputers(b, dive);
-	}
+	put_format(b, "\"maxdepth\":%d,", dive->dc.maxdepth.mm);
+	put_format(b, "\"duration\":%d,", dive->dc.duration.seconds);
+	if (!list_only)
+		write_dive_details(b, dive, photos_dir);
 	put_HTML_notes(b, dive, "\"notes\":\"", "\"");
 	put_string(b, "}\n");
 	(*dive_no)++;
 }
 
-void write_no_trip(struct membuffer *b, int *dive_no, bool selected_only, const char *photos_dir, const bool list_only, char *sep)
+/*
+ * Collect the dives to export, grouped the way they are written: each
+ * trip with its dives (in the order the trips first show up in the dive
+ * list), then all the remaining dives in an "Other" group with a NULL trip.
+ * Trips without any dive to export are left out.
+ */
+int get_html_export_trips(bool selected_only, struct html_export_trip **trips)
 {
-	int i;
+	int i, nr = 0;
 	struct dive *dive;
-	char *separator = "";
-	bool found_sel_dive = 0;
+	dive_trip_t *trip;
+	struct html_export_trip *res, *other;
+
+	for (trip = dive_trip_list; trip != NULL; trip = trip->next)
+		trip->index = 0;
+
+	/* at most one group per dive, plus "Other" */
+	res = calloc(dive_table.nr + 1, sizeof(struct html_export_trip));
+	if (!res) {
+		*trips = NULL;
+		return 0;
+	}
+
+	for_each_dive (i, dive) {
+		struct dive *d;
+		struct html_export_trip *group = res + nr;
+
+		trip = dive->divetrip;
+
+		/*Continue if the dive have no trips or we have seen this trip before*/
+		if (!trip || trip->index)
+			continue;
+		trip->index = 1;
 
+		for (d = trip->dives; d != NULL; d = d->next) {
+			if (d->selected || !selected_only)
+				group->nr++;
+		}
+		if (!group->nr)
+			continue;
+		group->trip = trip;
+		group->dives = malloc(group->nr * sizeof(struct dive *));
+		group->nr = 0;
+		for (d = trip->dives; d != NULL; d = d->next) {
+			if (d->selected || !selected_only)
+				group->dives[group->nr++] = d;
+		}
+		nr++;
+	}
+
+	/*Save all remaining trips into Others*/
+	other = res + nr;
 	for_each_dive (i, dive) {
 		// write dive if it doesn't belong to any trip and the dive is selected
 		// or we are in exporting all dives mode.
 		if (!dive->divetrip && (dive->selected || !selected_only)) {
-			if (!found_sel_dive) {
-				put_format(b, "%c{", *sep);
-				(*sep) = ',';
-				put_format(b, "\"name\":\"Other\",");
-				put_format(b, "\"dives\":[");
-				found_sel_dive = 1;
-			}
-			put_string(b, separator);
-			separator = ", ";
-			write_one_dive(b, dive, photos_dir, dive_no, list_only);
+			if (!other->dives)
+				other->dives = malloc(dive_table.nr * sizeof(struct dive *));
+			other->dives[other->nr++] = dive;
 		}
 	}
-	if (found_sel_dive)
-		put_format(b, "]}\n\n");
+	if (other->nr)
+		nr++;
+
+	*trips = res;
+	return nr;
 }
 
-void write_trip(struct membuffer *b, dive_trip_t *trip, int *dive_no, bool selected_only, const char *photos_dir, const bool list_only, char *sep)
+void free_html_export_trips(struct html_export_trip *trips, int nr)
 {
-	struct dive *dive;
-	char *separator = "";
-	bool found_sel_dive = 0;
-
-	for (dive = trip->dives; dive != NULL; dive = dive->next) {
-		if (!dive->selected && selected_only)
-			continue;
-
-		// save trip if found at least one selected dive.
-		if (!found_sel_dive) {
-			found_sel_dive = 1;
-			put_format(b, "%c {", *sep);
-			(*sep) = ',';
-			put_format(b, "\"name\":\"%s\",", trip->location);
-			put_format(b, "\"dives\":[");
-		}
-		put_string(b, separator);
-		separator = ", ";
-		write_one_dive(b, dive, photos_dir, dive_no, list_only);
-	}
+	int i;
 
-	// close the trip object if contain dives.
-	if (found_sel_dive)
-		put_format(b, "]}\n\n");
+	for (i = 0; i < nr; i++)
+		free(trips[i].dives);
+	free(trips);
 }
 
-void write_trips(struct membuffer *b, const char *photos_dir, bool selected_only, const bool list_only)
+void write_trip_start(struct membuffer *b, const struct html_export_trip *trip, bool first)
 {
-	int i, dive_no = 0;
-	struct dive *dive;
-	dive_trip_t *trip;
-	char sep_ = ' ';
-	char *sep = &sep_;
+	char sep = first ? ' ' : ',';
 
-	for (trip = dive_trip_list; trip != NULL; trip = trip->next)
-		trip->index = 0;
+	if (trip->trip)
+		put_format(b, "%c {\"name\":\"%s\",", sep, trip->trip->location);
+	else
+		put_format(b, "%c{\"name\":\"Other\",", sep);
+	put_format(b, "\"dives\":[");
+}
 
-	for_each_dive (i, dive) {
-		trip = dive->divetrip;
+void write_trip_end(struct membuffer *b)
+{
+	put_format(b, "]}\n\n");
+}
 
-		/*Continue if the dive have no trips or we have seen this trip before*/
-		if (!trip || trip->index)
-			continue;
+void write_trips(struct membuffer *b, const char *photos_dir, bool selected_only, const bool list_only)
+{
+	int i, j, nr, dive_no = 0;
+	struct html_export_trip *trips;
 
-		/* We haven't seen this trip before - save it and all dives */
-		trip->index = 1;
-		write_trip(b, trip, &dive_no, selected_only, photos_dir, list_only, sep);
+	nr = get_html_export_trips(selected_only, &trips);
+	for (i = 0; i < nr; i++) {
+		write_trip_start(b, trips + i, i == 0);
+		for (j = 0; j < trips[i].nr; j++) {
+			if (j)
+				put_string(b, ", ");
+			write_one_dive(b, trips[i].dives[j], photos_dir, &dive_no, list_only);
+		}
+		write_trip_end(b);
 	}
-
-	/*Save all remaining trips into Others*/
-	write_no_trip(b, &dive_no, selected_only, photos_dir, list_only, sep);
+	free_html_export_trips(trips, nr);
 }
 
 void export_list(struct membuffer *b, const char *photos_dir, bool selected_only, const bool list_only)
@@ -427,22 +463,6 @@ void export_list(struct membuffer *b, const char *photos_dir, bool selected_only
 	put_string(b, "]");
 }
 
-void export_HTML(const char *file_name, const char *photos_dir, const bool selected_only, const bool list_only)
-{
-	FILE *f;
-
-	struct membuffer buf = { 0 };
-	export_list(&buf, photos_dir, selected_only, list_only);
-
-	f = subsurface_fopen(file_name, "w+");
-	if (!f)
-		report_error(translate("gettextFromC", "Can't open file %s"), file_name);
-
-	flush_buffer(&buf, f); /*check for writing errors? */
-	free_buffer(&buf);
-	fclose(f);
-}
-
 void export_translation(const char *file_name)
 {
 	FILE *f;
@@ -18,7 +18,20 @@ void put_HTML_pressure_units(struct membuffer *b, pressure_t pressure, const cha
 void put_HTML_weight_units(struct membuffer *b, unsigned int grams, const char *pre, const char *post);
 void put_HTML_volume_units(struct membuffer *b, unsigned int ml, const char *pre, const char *post);
 
-void export_HTML(const char *file_name, const char *photos_dir, const bool selected_only, const bool list_only);
+/* the dives of one trip of an HTML export, or the ones without a trip if 'trip' is NULL */
+struct html_export_trip {
+	dive_trip_t *trip;
+	int nr;
+	struct dive **dives;
+};
+
+int get_html_export_trips(bool selected_only, struct html_export_trip **trips);
+void free_html_export_trips(struct html_export_trip *trips, int nr);
+void write_trip_start(struct membuffer *b, const struct html_export_trip *trip, bool first);
+void write_trip_end(struct membuffer *b);
+void write_dive_details(struct membuffer *b, struct dive *dive, const char *photos_dir);
+void write_one_dive(struct membuffer *b, struct dive *dive, const char *photos_dir, int *dive_no, const bool list_only);
+
 void export_list(struct membuffer *b, const char *photos_dir, bool selected_only, const bool list_only);
 
 void export_translation(const char *file_name);
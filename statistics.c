@@ -15,7 +15,6 @@
 #include "divelist.h"
 #include "statistics.h"
 
-static stats_t stats;
 stats_t stats_selection;
 stats_t *stats_monthly = NULL;
 stats_t *stats_yearly = NULL;
@@ -88,123 +87,431 @@ char *get_minutes(int seconds)
 	return buf;
 }
 
-void process_all_dives(struct dive *dive, struct dive **prev_dive)
+/*
+ * The yearly, monthly and per trip statistics are kept as running
+ * aggregates, so that only the dives that were added, removed or
+ * edited since the last call need to be looked at. The sums can
+ * simply be taken back when a dive goes away; the extremes can't,
+ * so a bucket that loses the dive holding one is recomputed.
+ */
+
+/* what a dive contributes to the statistics, as of the last time we looked at it */
+struct stats_entry {
+	struct dive *dive;
+	timestamp_t when;
+	dive_trip_t *trip;
+	int year, month;
+	int duration, maxdepth, meandepth, sac;
+	int mintemp, maxtemp, meantemp;
+};
+
+struct stats_bucket {
+	intptr_t key;
+	unsigned int nr;
+	long long total_time, depth_time, sac_time, sac_volume;
+	double temp_sum;
+	unsigned int temp_count;
+	int shortest_time, longest_time;
+	int min_depth, max_depth;
+	int min_sac, max_sac;
+	int min_temp, max_temp;
+	bool stale;
+};
+
+/* kept sorted by key */
+struct stats_bucket_table {
+	int nr, allocated;
+	struct stats_bucket *buckets;
+};
+
+static struct stats_entry *stats_entries;
+static int nr_stats_entries;
+static struct stats_bucket_table years, months, trips;
+static struct stats_bucket all_trips;
+
+static void fill_stats_entry(struct stats_entry *e, struct dive *dp, bool known)
 {
-	int idx;
-	struct dive *dp;
 	struct tm tm;
-	int current_year = 0;
-	int current_month = 0;
-	int year_iter = 0;
-	int month_iter = 0;
-	int prev_month = 0, prev_year = 0;
-	int trip_iter = 0;
-	dive_trip_t *trip_ptr = 0;
-	unsigned int size;
-
-	*prev_dive = NULL;
-	memset(&stats, 0, sizeof(stats));
-	if (dive_table.nr > 0) {
-		stats.shortest_time.seconds = dive_table.dives[0]->duration.seconds;
-		stats.min_depth.mm = dive_table.dives[0]->maxdepth.mm;
-		stats.selection_size = dive_table.nr;
-	}
-
-	/* allocate sufficient space to hold the worst
-	 * case (one dive per year or all dives during
-	 * one month) for yearly and monthly statistics*/
 
-	free(stats_yearly);
-	free(stats_monthly);
-	free(stats_by_trip);
+	if (!known || e->when != dp->when) {
+		utc_mkdate(dp->when, &tm);
+		e->year = tm.tm_year + 1900;
+		e->month = tm.tm_mon + 1;
+	}
+	e->dive = dp;
+	e->when = dp->when;
+	e->trip = dp->divetrip;
+	e->duration = dp->duration.seconds;
+	e->maxdepth = dp->maxdepth.mm;
+	e->meandepth = dp->meandepth.mm;
+	e->sac = dp->sac;
+	e->mintemp = dp->mintemp.mkelvin;
+	e->maxtemp = dp->maxtemp.mkelvin;
+	e->meantemp = e->mintemp ? (e->mintemp + e->maxtemp) / 2 : e->maxtemp;
+}
 
-	size = sizeof(stats_t) * (dive_table.nr + 1);
-	stats_yearly = malloc(size);
-	stats_monthly = malloc(size);
-	stats_by_trip = malloc(size);
-	if (!stats_yearly || !stats_monthly || !stats_by_trip)
-		return;
-	memset(stats_yearly, 0, size);
-	memset(stats_monthly, 0, size);
-	memset(stats_by_trip, 0, size);
-	stats_yearly[0].is_year = true;
+static bool stats_entry_changed(const struct stats_entry *e, struct dive *dp)
+{
+	return e->when != dp->when || e->trip != dp->divetrip ||
+	       e->duration != dp->duration.seconds ||
+	       e->maxdepth != dp->maxdepth.mm || e->meandepth != dp->meandepth.mm ||
+	       e->sac != dp->sac ||
+	       e->mintemp != dp->mintemp.mkelvin || e->maxtemp != dp->maxtemp.mkelvin;
+}
 
-	/* this relies on the fact that the dives in the dive_table
-	 * are in chronological order */
-	for_each_dive (idx, dp) {
-		if (dive && dp->when == dive->when) {
-			/* that's the one we are showing */
-			if (idx > 0)
-				*prev_dive = dive_table.dives[idx - 1];
-		}
-		process_dive(dp, &stats);
+/* less than .1 l/min is bogus, even with a pSCR - and we drop zero-duration dives */
+static bool has_sac(const struct stats_entry *e)
+{
+	return e->duration && e->sac > 100;
+}
 
-		/* yearly statistics */
-		utc_mkdate(dp->when, &tm);
-		if (current_year == 0)
-			current_year = tm.tm_year + 1900;
+static void add_extremes(struct stats_bucket *b, const struct stats_entry *e)
+{
+	if (e->duration > b->longest_time)
+		b->longest_time = e->duration;
+	if (e->duration && (!b->shortest_time || e->duration < b->shortest_time))
+		b->shortest_time = e->duration;
+	if (e->maxdepth > b->max_depth)
+		b->max_depth = e->maxdepth;
+	if (e->maxdepth && (!b->min_depth || e->maxdepth < b->min_depth))
+		b->min_depth = e->maxdepth;
+	if (has_sac(e)) {
+		if (e->sac > b->max_sac)
+			b->max_sac = e->sac;
+		if (!b->min_sac || e->sac < b->min_sac)
+			b->min_sac = e->sac;
+	}
+	if (e->maxtemp && (!b->max_temp || e->maxtemp > b->max_temp))
+		b->max_temp = e->maxtemp;
+	if (e->mintemp && (!b->min_temp || e->mintemp < b->min_temp))
+		b->min_temp = e->mintemp;
+}
 
-		if (current_year != tm.tm_year + 1900) {
-			current_year = tm.tm_year + 1900;
-			process_dive(dp, &(stats_yearly[++year_iter]));
-			stats_yearly[year_iter].is_year = true;
-		} else {
-			process_dive(dp, &(stats_yearly[year_iter]));
-		}
-		stats_yearly[year_iter].selection_size++;
-		stats_yearly[year_iter].period = current_year;
+static void add_to_bucket(struct stats_bucket *b, const struct stats_entry *e)
+{
+	b->nr++;
+	b->total_time += e->duration;
+	b->depth_time += (long long)e->duration * e->meandepth;
+	if (has_sac(e)) {
+		b->sac_time += e->duration;
+		b->sac_volume += (long long)e->duration * e->sac;
+	}
+	if (e->meantemp) {
+		b->temp_sum += e->meantemp;
+		b->temp_count++;
+	}
+	add_extremes(b, e);
+}
 
-		if (dp->divetrip != NULL) {
-			if (trip_ptr != dp->divetrip) {
-				trip_ptr = dp->divetrip;
-				trip_iter++;
-			}
+static void remove_from_bucket(struct stats_bucket *b, const struct stats_entry *e)
+{
+	b->nr--;
+	b->total_time -= e->duration;
+	b->depth_time -= (long long)e->duration * e->meandepth;
+	if (has_sac(e)) {
+		b->sac_time -= e->duration;
+		b->sac_volume -= (long long)e->duration * e->sac;
+	}
+	if (e->meantemp) {
+		b->temp_sum -= e->meantemp;
+		b->temp_count--;
+	}
+	if (e->duration == b->longest_time || e->duration == b->shortest_time ||
+	    e->maxdepth == b->max_depth || e->maxdepth == b->min_depth ||
+	    (has_sac(e) && (e->sac == b->max_sac || e->sac == b->min_sac)) ||
+	    (e->maxtemp && e->maxtemp == b->max_temp) ||
+	    (e->mintemp && e->mintemp == b->min_temp))
+		b->stale = true;
+}
+
+static struct stats_bucket *get_stats_bucket(struct stats_bucket_table *table, intptr_t key, bool create)
+{
+	int low = 0, high = table->nr;
+
+	while (low < high) {
+		int mid = (low + high) / 2;
+		if (table->buckets[mid].key < key)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	if (low < table->nr && table->buckets[low].key == key)
+		return table->buckets + low;
+	if (!create)
+		return NULL;
+	if (table->nr == table->allocated) {
+		table->allocated = (table->allocated + 8) * 3 / 2;
+		table->buckets = realloc(table->buckets, table->allocated * sizeof(struct stats_bucket));
+		if (!table->buckets)
+			exit(1);
+	}
+	memmove(table->buckets + low + 1, table->buckets + low, (table->nr - low) * sizeof(struct stats_bucket));
+	table->nr++;
+	memset(table->buckets + low, 0, sizeof(struct stats_bucket));
+	table->buckets[low].key = key;
+	return table->buckets + low;
+}
+
+static intptr_t month_key(const struct stats_entry *e)
+{
+	return e->year * 12 + e->month - 1;
+}
+
+static void add_stats_entry(const struct stats_entry *e)
+{
+	add_to_bucket(get_stats_bucket(&years, e->year, true), e);
+	add_to_bucket(get_stats_bucket(&months, month_key(e), true), e);
+	if (e->trip) {
+		add_to_bucket(get_stats_bucket(&trips, (intptr_t)e->trip, true), e);
+		add_to_bucket(&all_trips, e);
+	}
+}
 
-			/* stats_by_trip[0] is all the dives combined */
-			stats_by_trip[0].selection_size++;
-			process_dive(dp, &(stats_by_trip[0]));
-			stats_by_trip[0].is_trip = true;
-			stats_by_trip[0].location = strdup("All (by trip stats)");
+static void remove_stats_entry(const struct stats_entry *e)
+{
+	remove_from_bucket(get_stats_bucket(&years, e->year, false), e);
+	remove_from_bucket(get_stats_bucket(&months, month_key(e), false), e);
+	if (e->trip) {
+		remove_from_bucket(get_stats_bucket(&trips, (intptr_t)e->trip, false), e);
+		remove_from_bucket(&all_trips, e);
+	}
+}
+
+static int stats_entry_cmp(const void *_a, const void *_b)
+{
+	uintptr_t a = (uintptr_t)((const struct stats_entry *)_a)->dive;
+	uintptr_t b = (uintptr_t)((const struct stats_entry *)_b)->dive;
 
-			process_dive(dp, &(stats_by_trip[trip_iter]));
-			stats_by_trip[trip_iter].selection_size++;
-			stats_by_trip[trip_iter].is_trip = true;
-			stats_by_trip[trip_iter].location = dp->divetrip->location;
+	return a < b ? -1 : a > b;
+}
+
+/*
+ * Bring the aggregates in line with the dive table, returns whether
+ * anything changed. The dives are matched up with their entries by
+ * address; when the table still holds the same dives in the same order
+ * that's just a walk over both.
+ */
+static bool update_stats_entries(void)
+{
+	int i, j;
+	struct dive *dp;
+	struct stats_entry *old = stats_entries;
+	int nr_old = nr_stats_entries;
+	char *matched;
+	bool changed = false;
+
+	for (i = 0; i < nr_old && i < dive_table.nr && old[i].dive == dive_table.dives[i]; i++)
+		;
+	if (i == nr_old && i == dive_table.nr) {
+		for_each_dive (i, dp) {
+			if (!stats_entry_changed(old + i, dp))
+				continue;
+			remove_stats_entry(old + i);
+			fill_stats_entry(old + i, dp, true);
+			add_stats_entry(old + i);
+			changed = true;
 		}
+		return changed;
+	}
 
-		/* monthly statistics */
-		if (current_month == 0) {
-			current_month = tm.tm_mon + 1;
-		} else {
-			if (current_month != tm.tm_mon + 1)
-				current_month = tm.tm_mon + 1;
-			if (prev_month != current_month || prev_year != current_year)
-				month_iter++;
+	/* dives were added, removed or moved around */
+	qsort(old, nr_old, sizeof(struct stats_entry), stats_entry_cmp);
+	matched = calloc(nr_old + 1, 1);
+	stats_entries = calloc(dive_table.nr + 1, sizeof(struct stats_entry));
+	if (!matched || !stats_entries)
+		exit(1);
+	nr_stats_entries = dive_table.nr;
+	for_each_dive (i, dp) {
+		struct stats_entry key = { .dive = dp };
+		struct stats_entry *e = bsearch(&key, old, nr_old, sizeof(struct stats_entry), stats_entry_cmp);
+
+		if (e) {
+			matched[e - old] = 1;
+			stats_entries[i] = *e;
+			if (!stats_entry_changed(e, dp))
+				continue;
+			remove_stats_entry(e);
 		}
-		process_dive(dp, &(stats_monthly[month_iter]));
-		stats_monthly[month_iter].selection_size++;
-		stats_monthly[month_iter].period = current_month;
-		prev_month = current_month;
-		prev_year = current_year;
+		fill_stats_entry(stats_entries + i, dp, e != NULL);
+		add_stats_entry(stats_entries + i);
 	}
+	for (j = 0; j < nr_old; j++) {
+		if (!matched[j])
+			remove_stats_entry(old + j);
+	}
+	free(matched);
+	free(old);
+	return true;
 }
 
-/* make sure we skip the selected summary entries */
-void process_selected_dives(void)
+static void reset_extremes(struct stats_bucket *b)
 {
-	struct dive *dive;
-	unsigned int i, nr;
+	b->shortest_time = b->longest_time = 0;
+	b->min_depth = b->max_depth = 0;
+	b->min_sac = b->max_sac = 0;
+	b->min_temp = b->max_temp = 0;
+}
 
-	memset(&stats_selection, 0, sizeof(stats_selection));
+/* drop the empty buckets, returns whether any of the others lost an extreme */
+static bool prepare_stale_buckets(struct stats_bucket_table *table)
+{
+	int i, j;
+	bool stale = false;
 
-	nr = 0;
-	for_each_dive(i, dive) {
-		if (dive->selected) {
-			process_dive(dive, &stats_selection);
-			nr++;
+	for (i = 0, j = 0; i < table->nr; i++) {
+		struct stats_bucket *b = table->buckets + i;
+		if (!b->nr)
+			continue;
+		if (b->stale) {
+			reset_extremes(b);
+			stale = true;
 		}
+		table->buckets[j++] = *b;
+	}
+	table->nr = j;
+	return stale;
+}
+
+static void clear_stale(struct stats_bucket_table *table)
+{
+	int i;
+
+	for (i = 0; i < table->nr; i++)
+		table->buckets[i].stale = false;
+}
+
+static void update_stale_extremes(struct stats_bucket *b, const struct stats_entry *e)
+{
+	if (b->stale)
+		add_extremes(b, e);
+}
+
+static void recompute_stale_buckets(void)
+{
+	int i;
+	bool stale = false;
+
+	stale |= prepare_stale_buckets(&years);
+	stale |= prepare_stale_buckets(&months);
+	stale |= prepare_stale_buckets(&trips);
+	if (all_trips.stale) {
+		reset_extremes(&all_trips);
+		stale = true;
+	}
+	if (!stale)
+		return;
+	for (i = 0; i < nr_stats_entries; i++) {
+		const struct stats_entry *e = stats_entries + i;
+		update_stale_extremes(get_stats_bucket(&years, e->year, false), e);
+		update_stale_extremes(get_stats_bucket(&months, month_key(e), false), e);
+		if (e->trip) {
+			update_stale_extremes(get_stats_bucket(&trips, (intptr_t)e->trip, false), e);
+			update_stale_extremes(&all_trips, e);
+		}
+	}
+	clear_stale(&years);
+	clear_stale(&months);
+	clear_stale(&trips);
+	all_trips.stale = false;
+}
+
+static void fill_stats(stats_t *stats, const struct stats_bucket *b)
+{
+	stats->selection_size = b->nr;
+	stats->total_time.seconds = b->total_time;
+	stats->shortest_time.seconds = b->shortest_time;
+	stats->longest_time.seconds = b->longest_time;
+	stats->min_depth.mm = b->min_depth;
+	stats->max_depth.mm = b->max_depth;
+	stats->avg_depth.mm = b->total_time ? b->depth_time / b->total_time : 0;
+	stats->min_sac.mliter = b->min_sac;
+	stats->max_sac.mliter = b->max_sac;
+	stats->avg_sac.mliter = b->sac_time ? b->sac_volume / b->sac_time : 0;
+	stats->total_sac_time = b->sac_time;
+	stats->min_temp = b->min_temp;
+	stats->max_temp = b->max_temp;
+	/* the mean temperatures are kept in mkelvin, the UI wants a sum in the user's units */
+	stats->combined_count = b->temp_count;
+	if (b->temp_count)
+		stats->combined_temp = get_temp_units(rint(b->temp_sum / b->temp_count), NULL) * b->temp_count;
+}
+
+static int trip_bucket_cmp(const void *_a, const void *_b)
+{
+	const dive_trip_t *a = (const dive_trip_t *)(*(struct stats_bucket *const *)_a)->key;
+	const dive_trip_t *b = (const dive_trip_t *)(*(struct stats_bucket *const *)_b)->key;
+
+	return a->when < b->when ? -1 : a->when > b->when;
+}
+
+/* (re)build the arrays the UI walks - this only depends on the number of buckets */
+static void fill_period_stats(void)
+{
+	int i;
+	struct stats_bucket **by_time;
+
+	free(stats_yearly);
+	free(stats_monthly);
+	free(stats_by_trip);
+	stats_yearly = calloc(years.nr + 1, sizeof(stats_t));
+	stats_monthly = calloc(months.nr + 1, sizeof(stats_t));
+	stats_by_trip = calloc(trips.nr + 2, sizeof(stats_t));
+	by_time = calloc(trips.nr + 1, sizeof(struct stats_bucket *));
+	if (!stats_yearly || !stats_monthly || !stats_by_trip || !by_time)
+		exit(1);
+
+	stats_yearly[0].is_year = true;
+	for (i = 0; i < years.nr; i++) {
+		fill_stats(stats_yearly + i, years.buckets + i);
+		stats_yearly[i].period = years.buckets[i].key;
+		stats_yearly[i].is_year = true;
+	}
+	for (i = 0; i < months.nr; i++) {
+		fill_stats(stats_monthly + i, months.buckets + i);
+		stats_monthly[i].period = months.buckets[i].key % 12 + 1;
+	}
+
+	/* stats_by_trip[0] is all the dives combined, then the trips in order */
+	if (trips.nr) {
+		fill_stats(stats_by_trip, &all_trips);
+		stats_by_trip[0].is_trip = true;
+		stats_by_trip[0].location = "All (by trip stats)";
+	}
+	for (i = 0; i < trips.nr; i++)
+		by_time[i] = trips.buckets + i;
+	qsort(by_time, trips.nr, sizeof(struct stats_bucket *), trip_bucket_cmp);
+	for (i = 0; i < trips.nr; i++) {
+		fill_stats(stats_by_trip + i + 1, by_time[i]);
+		stats_by_trip[i + 1].is_trip = true;
+		stats_by_trip[i + 1].location = ((dive_trip_t *)by_time[i]->key)->location;
+	}
+	free(by_time);
+}
+
+/* this relies on the fact that the dives in the dive_table are in chronological order */
+static struct dive *find_previous_dive(struct dive *dive)
+{
+	int low = 0, high = dive_table.nr;
+
+	while (low < high) {
+		int mid = (low + high) / 2;
+		if (get_dive(mid)->when < dive->when)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	if (low > 0 && low < dive_table.nr && get_dive(low)->when == dive->when)
+		return get_dive(low - 1);
+	return NULL;
+}
+
+void process_all_dives(struct dive *dive, struct dive **prev_dive)
+{
+	*prev_dive = dive ? find_previous_dive(dive) : NULL;
+	if (update_stats_entries() || !stats_yearly) {
+		recompute_stale_buckets();
+		fill_period_stats();
 	}
-	stats_selection.selection_size = nr;
 }
 
 char *get_time_string(int seconds, int maxdays)
@@ -294,41 +601,56 @@ void get_selected_dives_text(char *buffer, int size)
 
 #define SOME_GAS 5000 // 5bar drop in cylinder pressure makes cylinder used
 
-bool is_cylinder_used(struct dive *dive, int idx)
+/* which cylinders a dive used, as a bitmask - this walks the gas changes only once */
+static unsigned int get_used_cylinders(struct dive *dive)
 {
 	struct divecomputer *dc;
 	bool firstGasExplicit = false;
-	if (cylinder_none(&dive->cylinder[idx]))
-		return false;
+	unsigned int used = 0;
+	int idx;
 
-	if ((dive->cylinder[idx].start.mbar - dive->cylinder[idx].end.mbar) > SOME_GAS)
-		return true;
 	for_each_dc(dive, dc) {
 		struct event *event = get_next_event(dc->events, "gaschange");
 		while (event) {
 			if (dc->sample && (event->time.seconds == 0 ||
 					   (dc->samples && dc->sample[0].time.seconds == event->time.seconds)))
 				firstGasExplicit = true;
-			if (get_cylinder_index(dive, event) == idx)
-				return true;
+			idx = get_cylinder_index(dive, event);
+			if (idx >= 0 && idx < MAX_CYLINDERS)
+				used |= 1 << idx;
 			event = get_next_event(event->next, "gaschange");
 		}
-		if (dc->divemode == CCR && (idx == dive->diluent_cylinder_index || idx == dive->oxygen_cylinder_index))
-			return true;
+		if (dc->divemode == CCR) {
+			if (dive->diluent_cylinder_index >= 0 && dive->diluent_cylinder_index < MAX_CYLINDERS)
+				used |= 1 << dive->diluent_cylinder_index;
+			if (dive->oxygen_cylinder_index >= 0 && dive->oxygen_cylinder_index < MAX_CYLINDERS)
+				used |= 1 << dive->oxygen_cylinder_index;
+		}
 	}
-	if (idx == 0 && !firstGasExplicit)
-		return true;
-	return false;
+	if (!firstGasExplicit)
+		used |= 1;
+	for (idx = 0; idx < MAX_CYLINDERS; idx++) {
+		if (cylinder_none(&dive->cylinder[idx]))
+			used &= ~(1 << idx);
+		else if ((dive->cylinder[idx].start.mbar - dive->cylinder[idx].end.mbar) > SOME_GAS)
+			used |= 1 << idx;
+	}
+	return used;
 }
 
-void get_gas_used(struct dive *dive, volume_t gases[MAX_CYLINDERS])
+bool is_cylinder_used(struct dive *dive, int idx)
+{
+	return get_used_cylinders(dive) & (1 << idx);
+}
+
+void get_cylinders_gas_used(cylinder_t cylinder[MAX_CYLINDERS], unsigned int used, volume_t gases[MAX_CYLINDERS])
 {
 	int idx;
 	for (idx = 0; idx < MAX_CYLINDERS; idx++) {
-		cylinder_t *cyl = &dive->cylinder[idx];
+		cylinder_t *cyl = &cylinder[idx];
 		pressure_t start, end;
 
-		if (!is_cylinder_used(dive, idx))
+		if (!(used & (1 << idx)))
 			continue;
 
 		start = cyl->start.mbar ? cyl->start : cyl->sample_start;
@@ -338,6 +660,11 @@ void get_gas_used(struct dive *dive, volume_t gases[MAX_CYLINDERS])
 	}
 }
 
+void get_gas_used(struct dive *dive, volume_t gases[MAX_CYLINDERS])
+{
+	get_cylinders_gas_used(dive->cylinder, get_used_cylinders(dive), gases);
+}
+
 /* Quite crude reverse-blender-function, but it produces a approx result */
 static void get_gas_parts(struct gasmix mix, volume_t vol, int o2_in_topup, volume_t *o2, volume_t *he)
 {
@@ -354,22 +681,155 @@ static void get_gas_parts(struct gasmix mix, volume_t vol, int o2_in_topup, volu
 	o2->mliter += vol.mliter - he->mliter - air.mliter;
 }
 
-void selected_dives_gas_parts(volume_t *o2_tot, volume_t *he_tot)
+void add_gas_parts(cylinder_t cylinder[MAX_CYLINDERS], volume_t gases[MAX_CYLINDERS], volume_t *o2_tot, volume_t *he_tot)
 {
-	int i, j;
-	struct dive *d;
-	for_each_dive (i, d) {
-		if (!d->selected)
-			continue;
-		volume_t diveGases[MAX_CYLINDERS] = {};
-		get_gas_used(d, diveGases);
-		for (j = 0; j < MAX_CYLINDERS; j++) {
-			if (diveGases[j].mliter) {
-				volume_t o2 = {}, he = {};
-				get_gas_parts(d->cylinder[j].gasmix, diveGases[j], O2_IN_AIR, &o2, &he);
-				o2_tot->mliter += o2.mliter;
-				he_tot->mliter += he.mliter;
+	int j;
+	for (j = 0; j < MAX_CYLINDERS; j++) {
+		if (gases[j].mliter) {
+			volume_t o2 = {}, he = {};
+			get_gas_parts(cylinder[j].gasmix, gases[j], O2_IN_AIR, &o2, &he);
+			o2_tot->mliter += o2.mliter;
+			he_tot->mliter += he.mliter;
+		}
+	}
+}
+
+/*
+ * Copy what the selection statistics need of a dive, so that they can be
+ * worked out on other threads without touching the dive again: the values
+ * process_dive() looks at, the cylinders, and for each dive computer its
+ * mode, the time of its first sample and its gas changes.
+ */
+struct selected_dive_info *get_selected_dive_info(struct dive *dive)
+{
+	struct selected_dive_info *info = calloc(1, sizeof(*info));
+	struct divecomputer *dc, *copy;
+	struct event *ev, **pev;
+	int i;
+
+	if (!info)
+		return NULL;
+	info->dive.duration = dive->duration;
+	info->dive.maxdepth = dive->maxdepth;
+	info->dive.meandepth = dive->meandepth;
+	info->dive.maxtemp = dive->maxtemp;
+	info->dive.mintemp = dive->mintemp;
+	info->dive.sac = dive->sac;
+	info->dive.diluent_cylinder_index = dive->diluent_cylinder_index;
+	info->dive.oxygen_cylinder_index = dive->oxygen_cylinder_index;
+	memcpy(info->dive.cylinder, dive->cylinder, sizeof(info->dive.cylinder));
+	/* the descriptions are only ever checked for being set */
+	for (i = 0; i < MAX_CYLINDERS; i++) {
+		if (info->dive.cylinder[i].type.description)
+			info->dive.cylinder[i].type.description = "";
+	}
+
+	copy = &info->dive.dc;
+	for_each_dc (dive, dc) {
+		if (dc != &dive->dc) {
+			copy->next = calloc(1, sizeof(struct divecomputer));
+			if (!copy->next)
+				break;
+			copy = copy->next;
+		}
+		copy->divemode = dc->divemode;
+		if (dc->sample) {
+			copy->sample = malloc(sizeof(struct sample));
+			if (copy->sample && dc->samples) {
+				copy->sample[0] = dc->sample[0];
+				copy->samples = copy->alloc_samples = 1;
 			}
 		}
+		pev = &copy->events;
+		for (ev = get_next_event(dc->events, "gaschange"); ev; ev = get_next_event(ev->next, "gaschange")) {
+			int size = sizeof(*ev) + strlen(ev->name) + 1;
+			struct event *new_ev = malloc(size);
+			if (!new_ev)
+				break;
+			memcpy(new_ev, ev, size);
+			*pev = new_ev;
+			pev = &new_ev->next;
+		}
+		*pev = NULL;
 	}
+	return info;
+}
+
+/* the statistics of a single copied dive, and the gas it used from each cylinder */
+void process_selected_dive_info(struct selected_dive_info *info, stats_t *stats, volume_t gases[MAX_CYLINDERS])
+{
+	memset(stats, 0, sizeof(*stats));
+	process_dive(&info->dive, stats);
+	stats->selection_size = 1;
+	get_cylinders_gas_used(info->dive.cylinder, get_used_cylinders(&info->dive), gases);
+}
+
+void free_selected_dive_info(struct selected_dive_info *info)
+{
+	struct divecomputer *dc, *next;
+
+	if (!info)
+		return;
+	for (dc = &info->dive.dc; dc; dc = next) {
+		next = dc->next;
+		free_events(dc->events);
+		free(dc->sample);
+		if (dc != &info->dive.dc)
+			free(dc);
+	}
+	free(info);
+}
+
+static void merge_min(int *value, int other)
+{
+	if (other && (!*value || other < *value))
+		*value = other;
+}
+
+static void merge_max(int *value, int other)
+{
+	if (other > *value)
+		*value = other;
+}
+
+/* the same for durations, which are unsigned */
+static void merge_min_duration(duration_t *value, duration_t other)
+{
+	if (other.seconds && (!value->seconds || other.seconds < value->seconds))
+		*value = other;
+}
+
+static void merge_max_duration(duration_t *value, duration_t other)
+{
+	if (other.seconds > value->seconds)
+		*value = other;
+}
+
+/* fold the statistics of another set of dives into these - the order doesn't matter */
+void merge_stats(stats_t *stats, const stats_t *other)
+{
+	int total_time = stats->total_time.seconds + other->total_time.seconds;
+	unsigned int sac_time = stats->total_sac_time + other->total_sac_time;
+
+	if (total_time)
+		stats->avg_depth.mm = (1.0 * stats->total_time.seconds * stats->avg_depth.mm +
+				       1.0 * other->total_time.seconds * other->avg_depth.mm) /
+				      total_time;
+	stats->total_time.seconds = total_time;
+	if (sac_time)
+		stats->avg_sac.mliter = (1.0 * stats->total_sac_time * stats->avg_sac.mliter +
+					 1.0 * other->total_sac_time * other->avg_sac.mliter) /
+					sac_time;
+	stats->total_sac_time = sac_time;
+	merge_min_duration(&stats->shortest_time, other->shortest_time);
+	merge_max_duration(&stats->longest_time, other->longest_time);
+	merge_min(&stats->min_depth.mm, other->min_depth.mm);
+	merge_max(&stats->max_depth.mm, other->max_depth.mm);
+	merge_min(&stats->min_sac.mliter, other->min_sac.mliter);
+	merge_max(&stats->max_sac.mliter, other->max_sac.mliter);
+	merge_min(&stats->min_temp, other->min_temp);
+	merge_max(&stats->max_temp, other->max_temp);
+	stats->combined_temp += other->combined_temp;
+	stats->combined_count += other->combined_count;
+	stats->selection_size += other->selection_size;
 }
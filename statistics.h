@@ -35,6 +35,13 @@ typedef struct
 	bool is_trip;
 	char *location;
 } stats_t;
+
+/* what the selection statistics need of a dive: a copy of it with nothing
+ * behind its pointers but dive computers that only have their gas changes */
+struct selected_dive_info {
+	struct dive dive;
+};
+
 extern stats_t stats_selection;
 extern stats_t *stats_yearly;
 extern stats_t *stats_monthly;
@@ -45,8 +52,12 @@ extern char *get_minutes(int seconds);
 extern void process_all_dives(struct dive *dive, struct dive **prev_dive);
 extern void get_selected_dives_text(char *buffer, int size);
 extern void get_gas_used(struct dive *dive, volume_t gases[MAX_CYLINDERS]);
-extern void process_selected_dives(void);
-void selected_dives_gas_parts(volume_t *o2_tot, volume_t *he_tot);
+extern struct selected_dive_info *get_selected_dive_info(struct dive *dive);
+extern void process_selected_dive_info(struct selected_dive_info *info, stats_t *stats, volume_t gases[MAX_CYLINDERS]);
+extern void free_selected_dive_info(struct selected_dive_info *info);
+extern void merge_stats(stats_t *stats, const stats_t *other);
+extern void get_cylinders_gas_used(cylinder_t cylinder[MAX_CYLINDERS], unsigned int used, volume_t gases[MAX_CYLINDERS]);
+extern void add_gas_parts(cylinder_t cylinder[MAX_CYLINDERS], volume_t gases[MAX_CYLINDERS], volume_t *o2_tot, volume_t *he_tot);
 
 #ifdef __cplusplus
 }
@@ -1,10 +1,62 @@
 #include <string>
+#include <QtConcurrent>
+#include <QCryptographicHash>
+#include <QCache>
 
 #include "templatelayout.h"
 #include "helpers.h"
 
-TemplateLayout::TemplateLayout()
+/* how many dive blocks a worker thread renders with one template engine */
+#define TEMPLATE_CHUNK 32
+
+/*
+ * Rendered dive blocks, keyed by the template file and the content of
+ * the dive, so printing dives again only renders the ones that changed.
+ * Only used from the GUI thread.
+ */
+static QCache<QByteArray, QString> diveBlockCache(4096);
+
+struct DiveChunk {
+	QString templateDir;
+	QList<Dive> dives;
+};
+
+static Grantlee::Engine *createEngine(const QString &templateDir, QObject *parent)
 {
+	Grantlee::Engine *engine = new Grantlee::Engine(parent);
+	QSharedPointer<Grantlee::FileSystemTemplateLoader> templateLoader =
+		QSharedPointer<Grantlee::FileSystemTemplateLoader>(new Grantlee::FileSystemTemplateLoader());
+	templateLoader->setTemplateDirs(QStringList() << templateDir);
+	engine->addTemplateLoader(templateLoader);
+	return engine;
+}
+
+/* runs on the thread pool, so every chunk gets its own engine */
+static QStringList renderDiveChunk(const DiveChunk &chunk)
+{
+	QStringList blocks;
+	Grantlee::Engine *engine = createEngine(chunk.templateDir, 0);
+	Grantlee::Template t = engine->loadByName("dive.html");
+	if (!t || t->error()) {
+		qDebug() << "Can't load template";
+		delete engine;
+		return blocks;
+	}
+	Q_FOREACH (const Dive &dive, chunk.dives) {
+		QVariantHash mapping;
+		mapping.insert("dive", QVariant::fromValue(dive));
+		Grantlee::Context c(mapping);
+		blocks.append(t->render(&c));
+		if (t->error())
+			qDebug() << "Can't render template";
+	}
+	delete engine;
+	return blocks;
+}
+
+TemplateLayout::TemplateLayout() : m_engine(NULL), m_chunks(0)
+{
+	Grantlee::registerMetaType<Dive>();
 }
 
 TemplateLayout::~TemplateLayout()
@@ -12,36 +64,52 @@ TemplateLayout::~TemplateLayout()
 	delete m_engine;
 }
 
-int TemplateLayout::getTotalWork()
+QString TemplateLayout::templateDir()
 {
-	int dives = 0, i;
-	struct dive *dive;
-	for_each_dive (i, dive) {
-		//TODO check for exporting selected dives only
-		if (!dive->selected)
-			continue;
-		dives++;
-	}
-	return dives;
+	return getSubsurfaceDataPath("printing_templates");
 }
 
-QString TemplateLayout::generate()
+/* the template file and its modification time go into every key */
+static QString templateStamp(const QString &templateDir)
 {
-	int progress = 0;
-	int totalWork = getTotalWork();
-
-	QString htmlContent;
-	m_engine = new Grantlee::Engine(this);
+	QFileInfo info(templateDir + QDir::separator() + "dive.html");
+	return info.absoluteFilePath() + " " + info.lastModified().toString(Qt::ISODate);
+}
 
-	QSharedPointer<Grantlee::FileSystemTemplateLoader> m_templateLoader =
-		QSharedPointer<Grantlee::FileSystemTemplateLoader>(new Grantlee::FileSystemTemplateLoader());
-	m_templateLoader->setTemplateDirs(QStringList() << getSubsurfaceDataPath("printing_templates"));
-	m_engine->addTemplateLoader(m_templateLoader);
+static QByteArray diveBlockKey(const QString &stamp, const Dive &dive)
+{
+	QCryptographicHash hash(QCryptographicHash::Sha1);
+	QStringList fields;
+
+	fields << stamp << QString::number(dive.number()) << dive.date() << dive.time() << dive.location()
+	       << dive.duration() << dive.depth() << dive.divemaster() << dive.buddy()
+	       << dive.airTemp() << dive.waterTemp() << dive.notes();
+	Q_FOREACH (const QString &field, fields) {
+		hash.addData(field.toUtf8());
+		hash.addData("", 1);
+	}
+	return hash.result();
+}
 
-	Grantlee::registerMetaType<Dive>();
+void TemplateLayout::chunksRendered(int chunks)
+{
+	if (m_chunks)
+		emit progressUpdated(chunks * 100.0 / m_chunks);
+}
 
-	QVariantHash mapping;
-	QVariantList diveList;
+/*
+ * Render the dive block of every selected dive. The ones that are not
+ * in the cache are rendered in chunks on the thread pool, while the GUI
+ * thread keeps processing events (but no user input) until they are done.
+ */
+QStringList TemplateLayout::renderDives()
+{
+	QStringList blocks;
+	QList<QByteArray> keys;
+	QList<int> missing;
+	QList<DiveChunk> chunks;
+	QString dir = templateDir();
+	QString stamp = templateStamp(dir);
 
 	struct dive *dive;
 	int i;
@@ -50,11 +118,59 @@ QString TemplateLayout::generate()
 		if (!dive->selected)
 			continue;
 		Dive d(dive);
-		diveList.append(QVariant::fromValue(d));
-		progress++;
-		emit progressUpdated(progress * 100.0 / totalWork);
+		QByteArray key = diveBlockKey(stamp, d);
+		QString *cached = diveBlockCache.object(key);
+		blocks.append(cached ? *cached : QString());
+		keys.append(key);
+		if (cached)
+			continue;
+		if (missing.count() % TEMPLATE_CHUNK == 0) {
+			DiveChunk chunk = { dir, QList<Dive>() };
+			chunks.append(chunk);
+		}
+		chunks.last().dives.append(d);
+		missing.append(blocks.count() - 1);
+	}
+
+	m_chunks = chunks.count();
+	if (chunks.isEmpty()) {
+		emit progressUpdated(100);
+		return blocks;
 	}
-	mapping.insert("dives", diveList);
+
+	QFutureWatcher<QStringList> watcher;
+	QEventLoop loop;
+	connect(&watcher, SIGNAL(finished()), &loop, SLOT(quit()));
+	connect(&watcher, SIGNAL(progressValueChanged(int)), this, SLOT(chunksRendered(int)));
+	watcher.setFuture(QtConcurrent::mapped(chunks, renderDiveChunk));
+	loop.exec(QEventLoop::ExcludeUserInputEvents);
+
+	int n = 0;
+	for (int c = 0; c < chunks.count(); c++) {
+		QStringList rendered = watcher.future().resultAt(c);
+		for (int j = 0; j < chunks.at(c).dives.count(); j++, n++) {
+			if (j >= rendered.count())
+				continue;
+			int index = missing.at(n);
+			blocks[index] = rendered.at(j);
+			diveBlockCache.insert(keys.at(index), new QString(rendered.at(j)));
+		}
+	}
+	return blocks;
+}
+
+/* put the given dive blocks into the page template */
+QString TemplateLayout::generate(const QStringList &diveBlocks)
+{
+	QString htmlContent;
+	if (!m_engine)
+		m_engine = createEngine(templateDir(), this);
+
+	QVariantHash mapping;
+	QVariantList blockList;
+	Q_FOREACH (const QString &block, diveBlocks)
+		blockList.append(block);
+	mapping.insert("dive_blocks", blockList);
 
 	Grantlee::Context c(mapping);
 
@@ -73,6 +189,11 @@ QString TemplateLayout::generate()
 	return htmlContent;
 }
 
+QString TemplateLayout::generate()
+{
+	return generate(renderDives());
+}
+
 Dive::Dive()
 {
 }
@@ -10,10 +10,17 @@ public:
 	TemplateLayout();
 	~TemplateLayout();
 	QString generate();
+	QStringList renderDives();
+	QString generate(const QStringList &diveBlocks);
 
 private:
 	Grantlee::Engine *m_engine;
-	int getTotalWork();
+	int m_chunks;
+	QString templateDir();
+
+private
+slots:
+	void chunksRendered(int chunks);
 
 signals:
 	void progressUpdated(int value);
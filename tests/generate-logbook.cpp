@@ -0,0 +1,35 @@
+/*
+ * Write a synthetic logbook for benchmarking, as XML or, given
+ * "directory[branch]", into a git repository.
+ *
+ * generate-logbook <file> [number of dives] [every how many-th dive is CCR] [seed]
+ */
+#include <QCoreApplication>
+#include <QStringList>
+
+#include "generatelogbook.h"
+#include "dive.h"
+#include <git2.h>
+
+int main(int argc, char **argv)
+{
+	QCoreApplication application(argc, argv);
+	QStringList arguments = application.arguments();
+
+	if (arguments.count() < 2) {
+		fprintf(stderr, "usage: %s <file> [dives] [ccr-every] [seed]\n", argv[0]);
+		return 1;
+	}
+#if !LIBGIT2_VER_MAJOR && LIBGIT2_VER_MINOR < 22
+	git_threads_init();
+#else
+	git_libgit2_init();
+#endif
+	prefs = default_prefs;
+	generateLogbook(arguments.value(2, "10000").toInt(), arguments.value(3, "50").toInt(), arguments.value(4, "1").toUInt());
+	if (save_dives(qPrintable(arguments.at(1)))) {
+		fprintf(stderr, "%s\n", get_error_string());
+		return 1;
+	}
+	return 0;
+}
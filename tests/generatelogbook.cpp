@@ -0,0 +1,179 @@
+#include "generatelogbook.h"
+#include "dive.h"
+#include "divesite.h"
+
+#include <QString>
+
+// a small xorshift generator, so that the logbook doesn't depend on the C library
+class Random {
+public:
+	Random(quint32 seed) : state(seed ? seed : 1) {}
+	quint32 next()
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+	int range(int min, int max)
+	{
+		return min + (int)(next() % (quint32)(max - min + 1));
+	}
+
+private:
+	quint32 state;
+};
+
+static const char *buddies[] = {
+	"Anna", "Bob", "Chris", "Dana", "Eli", "Fran", "Gus", "Hanna", "Ivo", "Jo", "Kim", "Lee"
+};
+static const char *tags[] = {
+	"boat", "shore", "drift", "wreck", "cave", "night", "deep", "training", "photo", "reef"
+};
+static const char *suits[] = {
+	"3mm wetsuit", "5mm wetsuit", "7mm semidry", "Trilaminate drysuit", "Neoprene drysuit"
+};
+
+#define NR_ELEMENTS(array) (int)(sizeof(array) / sizeof(array[0]))
+
+static void setCylinder(cylinder_t *cyl, int size, int workingpressure, int o2, int he, enum cylinderuse use)
+{
+	cyl->type.size.mliter = size;
+	cyl->type.workingpressure.mbar = workingpressure;
+	cyl->gasmix.o2.permille = o2;
+	cyl->gasmix.he.permille = he;
+	cyl->cylinder_use = use;
+}
+
+// a square-ish profile with a gentle multilevel bottom part and a safety stop
+static void addOcSamples(struct dive *dive, Random &random)
+{
+	struct divecomputer *dc = &dive->dc;
+	int duration = random.range(35, 70) * 60;
+	int maxdepth = random.range(8, 40) * 1000;
+	int start = random.range(200, 232) * 1000;
+	int end = random.range(40, 80) * 1000;
+	int temperature = random.range(275, 302) * 1000;
+
+	setCylinder(&dive->cylinder[0], 11100, 207000, random.range(0, 3) ? 0 : 320, 0, OC_GAS);
+	dive->cylinder[0].start.mbar = start;
+	dive->cylinder[0].end.mbar = end;
+	for (int t = 0; t <= duration; t += 10) {
+		struct sample *sample = prepare_sample(dc);
+		int depth;
+
+		if (t < 120)
+			depth = maxdepth * t / 120;
+		else if (t > duration - 60)
+			depth = 3000 * (duration - t) / 60;
+		else if (t > duration - 240)
+			depth = 5000;
+		else
+			depth = maxdepth - (maxdepth - 5000) * (t - 120) / (duration - 360) / 2 + random.range(-500, 500);
+		sample->time.seconds = t;
+		sample->depth.mm = qMax(depth, 0);
+		sample->cylinderpressure.mbar = start - (start - end) * t / duration;
+		if (t % 60 == 0)
+			sample->temperature.mkelvin = temperature;
+		finish_sample(dc);
+	}
+}
+
+// a deep trimix CCR dive: long bottom, long decompression, 1Hz samples with three O2 sensors
+static void addCcrSamples(struct dive *dive, Random &random)
+{
+	struct divecomputer *dc = &dive->dc;
+	int bottom = random.range(20, 40) * 60;
+	int maxdepth = random.range(50, 100) * 1000;
+	int descent = maxdepth / 300;
+	int stops = random.range(90, 180) * 60;
+	int duration = descent + bottom + stops;
+
+	dc->divemode = CCR;
+	dc->no_o2sensors = 3;
+	setCylinder(&dive->cylinder[0], 3000, 200000, 100, 700, DILUENT);
+	setCylinder(&dive->cylinder[1], 3000, 200000, 1000, 0, OXYGEN);
+	setCylinder(&dive->cylinder[2], 11100, 207000, 500, 0, OC_GAS);
+	dive->diluent_cylinder_index = 0;
+	dive->oxygen_cylinder_index = 1;
+	dive->cylinder[0].start.mbar = 200000;
+	dive->cylinder[0].end.mbar = 120000;
+	dive->cylinder[1].start.mbar = 200000;
+	dive->cylinder[1].end.mbar = 90000;
+	for (int t = 0; t <= duration; t++) {
+		struct sample *sample = prepare_sample(dc);
+		int depth, setpoint;
+
+		if (t < descent) {
+			depth = maxdepth * t / descent;
+		} else if (t < descent + bottom) {
+			depth = maxdepth + random.range(-200, 200);
+		} else {
+			// stops every 3m, getting longer the shallower they are
+			double done = (double)(t - descent - bottom) / stops;
+			depth = maxdepth * (1.0 - done) * (1.0 - done);
+			depth -= depth % 3000;
+		}
+		setpoint = depth > 20000 ? 1300 : 700;
+		sample->time.seconds = t;
+		sample->depth.mm = qMax(depth, 0);
+		sample->setpoint.mbar = setpoint;
+		for (int i = 0; i < 3; i++)
+			sample->o2sensor[i].mbar = setpoint + random.range(-50, 50);
+		sample->cylinderpressure.mbar = 200000 - 80000 * t / duration;
+		sample->o2cylinderpressure.mbar = 200000 - 110000 * t / duration;
+		if (t % 10 == 0)
+			sample->temperature.mkelvin = 280000 + qMax(0, 15000 - depth / 4);
+		finish_sample(dc);
+	}
+}
+
+void generateLogbook(int nrDives, int ccrEvery, quint32 seed)
+{
+	Random random(seed);
+	int nrSites = qMax(10, nrDives / 30);
+	uint32_t *sites = new uint32_t[nrSites];
+	timestamp_t when = 946684800; // 2000-01-01
+
+	for (int i = 0; i < nrSites; i++) {
+		degrees_t latitude, longitude;
+		latitude.udeg = random.range(-60000000, 60000000);
+		longitude.udeg = random.range(-179000000, 179000000);
+		sites[i] = create_dive_site_with_gps(qPrintable(QString("Dive site %1").arg(i)), latitude, longitude);
+		get_dive_site_by_uuid(sites[i])->description = copy_string(qPrintable(QString("Synthetic dive site number %1").arg(i)));
+	}
+
+	for (int nr = 1; nr <= nrDives; nr++) {
+		struct dive *dive = alloc_dive();
+
+		when += random.range(3, 30) * 3600;
+		dive->when = dive->dc.when = when;
+		dive->number = nr;
+		dive->dive_site_uuid = sites[random.next() % nrSites];
+		dive->buddy = copy_string(buddies[random.next() % NR_ELEMENTS(buddies)]);
+		dive->divemaster = copy_string(buddies[random.next() % NR_ELEMENTS(buddies)]);
+		dive->suit = copy_string(suits[random.next() % NR_ELEMENTS(suits)]);
+		dive->notes = copy_string(qPrintable(QString("Dive %1 of the synthetic logbook. Saw %2 fish.").arg(nr).arg(random.range(0, 500))));
+		dive->rating = random.range(0, 5);
+		dive->visibility = random.range(0, 5);
+		for (int i = random.range(0, 3); i > 0; i--)
+			taglist_add_tag(&dive->tag_list, tags[random.next() % NR_ELEMENTS(tags)]);
+		dive->dc.model = copy_string(ccrEvery > 0 && nr % ccrEvery == 0 ? "Synthetic CCR" : "Synthetic computer");
+		dive->dc.deviceid = 0x5eed0000 + seed;
+		dive->dc.diveid = nr;
+
+		if (ccrEvery > 0 && nr % ccrEvery == 0)
+			addCcrSamples(dive, random);
+		else
+			addOcSamples(dive, random);
+
+		for (int i = random.range(-6, 3); i > 0; i--) {
+			struct picture *picture = alloc_picture();
+			picture->filename = copy_string(qPrintable(QString("/pictures/%1/IMG_%2.jpg").arg(nr / 1000).arg(nr * 10 + i)));
+			picture->offset.seconds = random.range(60, 1800);
+			dive_add_picture(dive, picture);
+		}
+		record_dive(dive);
+	}
+	delete[] sites;
+}
@@ -0,0 +1,16 @@
+#ifndef GENERATELOGBOOK_H
+#define GENERATELOGBOOK_H
+
+#include <QtGlobal>
+
+/*
+ * Fill the dive table with a synthetic, but realistic looking logbook
+ * for benchmarking: mostly recreational open circuit dives sampled
+ * every ten seconds, every ccrEvery-th dive a multi hour CCR dive
+ * sampled every second, spread over a few hundred dive sites with
+ * buddies, tags, notes and pictures. The same seed always gives the
+ * same logbook.
+ */
+void generateLogbook(int nrDives, int ccrEvery = 50, quint32 seed = 1);
+
+#endif
@@ -0,0 +1,295 @@
+#include "testdeco.h"
+#include "dive.h"
+#include "divelist.h"
+#include "display.h"
+#include "profile.h"
+#include "planner.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+
+#define GOLDEN_DIR SUBSURFACE_SOURCE "/tests/golden/"
+
+/* how far a value may drift from the golden one, per column of a record */
+enum {
+	SECONDS_TOLERANCE = 60,
+	DEPTH_TOLERANCE = 150,
+	STOP_TOLERANCE = 3000,
+	CNS_TOLERANCE = 1
+};
+
+static void clearDives()
+{
+	while (dive_table.nr)
+		delete_single_dive(dive_table.nr - 1);
+}
+
+/*
+ * One line per minute of the dive: time, depth, ceiling, NDL, TTS,
+ * stop time, stop depth and whether we are in deco.
+ */
+static void recordDive(struct dive *dive, QStringList &records)
+{
+	struct plot_info pi;
+	int minute = 0;
+
+	update_cylinder_related_info(dive);
+	records << QString("dive %1 cns %2 otu %3").arg(dive->number).arg(dive->maxcns).arg(dive->otu);
+	pi = calculate_max_limits_new(dive, &dive->dc);
+	create_plot_info_new(dive, &dive->dc, &pi, false);
+	for (int i = 0; i < pi.nr; i++) {
+		struct plot_data *entry = pi.entry + i;
+		if (entry->sec < minute * 60)
+			continue;
+		minute = entry->sec / 60 + 1;
+		records << QString("%1 %2 %3 %4 %5 %6 %7 %8")
+				   .arg(entry->sec).arg(entry->depth).arg(entry->ceiling)
+				   .arg(entry->ndl_calc).arg(entry->tts_calc)
+				   .arg(entry->stoptime_calc).arg(entry->stopdepth_calc)
+				   .arg(entry->in_deco_calc);
+	}
+	// pi.entry belongs to the profile code, the next create_plot_info_new() frees it
+}
+
+static int tolerance(const QString &record, int column)
+{
+	if (record.startsWith("dive "))
+		return CNS_TOLERANCE;
+	if (record.startsWith("runtime "))
+		return SECONDS_TOLERANCE;
+	switch (column) {
+	case 0: // time
+		return 0;
+	case 1: // depth
+	case 2: // ceiling
+		return DEPTH_TOLERANCE;
+	case 3: // ndl
+	case 4: // tts
+	case 5: // stop time
+		return SECONDS_TOLERANCE;
+	case 6: // stop depth
+		return STOP_TOLERANCE;
+	default:
+		return 0;
+	}
+}
+
+static bool recordsMatch(const QString &golden, const QString &actual)
+{
+	QStringList goldenFields = golden.split(' ');
+	QStringList actualFields = actual.split(' ');
+
+	if (goldenFields.count() != actualFields.count())
+		return false;
+	for (int i = 0; i < goldenFields.count(); i++) {
+		bool isNumber;
+		int goldenValue = goldenFields[i].toInt(&isNumber);
+		if (!isNumber) {
+			if (goldenFields[i] != actualFields[i])
+				return false;
+			continue;
+		}
+		if (qAbs(goldenValue - actualFields[i].toInt()) > tolerance(golden, i))
+			return false;
+	}
+	return true;
+}
+
+static void compareWithGolden(const QString &name, const QStringList &records)
+{
+	QFile file(GOLDEN_DIR + name + ".txt");
+
+	if (!qgetenv("SUBSURFACE_UPDATE_GOLDEN").isEmpty()) {
+		QDir().mkpath(GOLDEN_DIR);
+		QVERIFY(file.open(QFile::WriteOnly | QFile::Truncate | QFile::Text));
+		QTextStream out(&file);
+		Q_FOREACH (const QString &record, records)
+			out << record << "\n";
+		QSKIP("golden data recorded");
+	}
+	if (!file.open(QFile::ReadOnly | QFile::Text))
+		QSKIP("no golden data, run with SUBSURFACE_UPDATE_GOLDEN=1 on a reference build to record it");
+
+	QStringList golden = QString(file.readAll()).split('\n', QString::SkipEmptyParts);
+	QCOMPARE(records.count(), golden.count());
+	for (int i = 0; i < golden.count(); i++) {
+		if (!recordsMatch(golden[i], records[i]))
+			QFAIL(qPrintable(QString("%1 line %2: expected \"%3\", got \"%4\"").arg(name).arg(i + 1).arg(golden[i], records[i])));
+	}
+}
+
+void TestDeco::initTestCase()
+{
+	prefs = default_prefs;
+	prefs.calcceiling = true;
+	prefs.calcndltts = true;
+}
+
+void TestDeco::testLoggedDives_data()
+{
+	QTest::addColumn<QString>("file");
+
+	QTest::newRow("SampleDivesV2") << "SampleDivesV2.ssrf";
+	QTest::newRow("test40-42") << "test40-42.xml";
+	QTest::newRow("test35-ccr") << "test35.xml";
+	QTest::newRow("sac-test") << "sac-test.xml";
+}
+
+void TestDeco::testLoggedDives()
+{
+	QFETCH(QString, file);
+	QStringList records;
+	struct dive *dive;
+	int i;
+
+	clearDives();
+	QCOMPARE(parse_file(qPrintable(SUBSURFACE_SOURCE "/dives/" + file)), 0);
+	for_each_dive (i, dive)
+		recordDive(dive, records);
+	compareWithGolden(QTest::currentDataTag(), records);
+}
+
+/*
+ * The plot info for printing has to match the one of the profile widget,
+ * apart from the NDL/TTS calculation, and must not take that one away.
+ */
+void TestDeco::testPrintPlotInfo()
+{
+	struct dive *dive;
+	int i;
+
+	clearDives();
+	QCOMPARE(parse_file(SUBSURFACE_SOURCE "/dives/test40-42.xml"), 0);
+	for_each_dive (i, dive) {
+		struct plot_info pi = calculate_max_limits_new(dive, &dive->dc);
+		struct plot_info printPi;
+
+		create_plot_info_new(dive, &dive->dc, &pi, false);
+		create_print_plot_info(dive, &dive->dc, &printPi);
+		QCOMPARE(printPi.nr, pi.nr);
+		QCOMPARE(printPi.maxdepth, pi.maxdepth);
+		for (int j = 0; j < pi.nr; j++) {
+			QCOMPARE(printPi.entry[j].sec, pi.entry[j].sec);
+			QCOMPARE(printPi.entry[j].depth, pi.entry[j].depth);
+			QCOMPARE(printPi.entry[j].ceiling, pi.entry[j].ceiling);
+		}
+		free(printPi.entry);
+	}
+	clearDives();
+}
+
+struct planCylinder {
+	int o2, he, switchDepth;
+};
+
+static void setupPlan(struct diveplan *diveplan, int gflow, int gfhigh, const struct planCylinder *cylinders, int nrCylinders)
+{
+	memset(&displayed_dive, 0, sizeof(displayed_dive));
+	for (int i = 0; i < nrCylinders; i++) {
+		cylinder_t *cyl = &displayed_dive.cylinder[i];
+		cyl->type.size.mliter = 12000;
+		cyl->type.workingpressure.mbar = 232000;
+		cyl->start.mbar = 232000;
+		cyl->gasmix.o2.permille = cylinders[i].o2;
+		cyl->gasmix.he.permille = cylinders[i].he;
+		cyl->depth.mm = cylinders[i].switchDepth;
+	}
+	memset(diveplan, 0, sizeof(*diveplan));
+	diveplan->when = 1420070400;
+	diveplan->surface_pressure = 1013;
+	diveplan->bottomsac = prefs.bottomsac;
+	diveplan->decosac = prefs.decosac;
+	diveplan->gflow = gflow;
+	diveplan->gfhigh = gfhigh;
+	for (int i = 1; i < nrCylinders; i++) {
+		struct divedatapoint *dp = create_dp(0, cylinders[i].switchDepth, displayed_dive.cylinder[i].gasmix, 0);
+		dp->next = diveplan->dp;
+		diveplan->dp = dp;
+	}
+}
+
+static const struct planCylinder airOnly[] = { { 209, 0, 0 } };
+static const struct planCylinder trimixDeco[] = { { 180, 450, 0 }, { 500, 0, 21000 }, { 1000, 0, 6000 } };
+static const struct planCylinder deepTrimix[] = { { 100, 700, 0 }, { 210, 350, 57000 }, { 500, 0, 21000 }, { 1000, 0, 6000 } };
+
+void TestDeco::testPlannedDives_data()
+{
+	QTest::addColumn<int>("depth");
+	QTest::addColumn<int>("bottomTime");
+	QTest::addColumn<int>("gflow");
+	QTest::addColumn<int>("gfhigh");
+	QTest::addColumn<int>("gases");
+
+	QTest::newRow("air-30m-40min") << 30000 << 40 << 100 << 100 << 0;
+	QTest::newRow("air-45m-20min-gf30-85") << 45000 << 20 << 30 << 85 << 0;
+	QTest::newRow("trimix-60m-25min") << 60000 << 25 << 35 << 75 << 1;
+	QTest::newRow("trimix-100m-15min") << 100000 << 15 << 30 << 70 << 2;
+}
+
+void TestDeco::testPlannedDives()
+{
+	QFETCH(int, depth);
+	QFETCH(int, bottomTime);
+	QFETCH(int, gflow);
+	QFETCH(int, gfhigh);
+	QFETCH(int, gases);
+	const struct planCylinder *cylinders[] = { airOnly, trimixDeco, deepTrimix };
+	const int nrCylinders[] = { 1, 3, 4 };
+	struct diveplan diveplan;
+	QStringList records;
+	char *cache = NULL;
+
+	clearDives();
+	setupPlan(&diveplan, gflow, gfhigh, cylinders[gases], nrCylinders[gases]);
+	plan_add_segment(&diveplan, depth / prefs.descrate, depth, displayed_dive.cylinder[0].gasmix, 0, true);
+	plan_add_segment(&diveplan, bottomTime * 60 - depth / prefs.descrate, depth, displayed_dive.cylinder[0].gasmix, 0, true);
+	plan(&diveplan, &cache, true, false);
+	free(cache);
+	free_dps(&diveplan);
+
+	records << QString("runtime %1").arg(displayed_dive.dc.sample[displayed_dive.dc.samples - 1].time.seconds);
+	recordDive(&displayed_dive, records);
+	compareWithGolden(QTest::currentDataTag(), records);
+}
+
+/* the inner loop of everything in deco.c: one second at a depth, over and over */
+void TestDeco::benchmarkAddSegment()
+{
+	const int segments = 1000000;
+	struct gasmix trimix = { { 180 }, { 450 } };
+	struct dive dive;
+	QElapsedTimer timer;
+
+	memset(&dive, 0, sizeof(dive));
+	clear_deco(1.013);
+	timer.start();
+	for (int i = 0; i < segments; i++)
+		add_segment(1.013 + (i % 6000) / 1000.0, &trimix, 1, 0, &dive, prefs.bottomsac);
+	qDebug("add_segment: %.1f ns per call", (double)timer.nsecsElapsed() / segments);
+
+	QBENCHMARK {
+		for (int i = 0; i < 10000; i++)
+			add_segment(1.013 + (i % 6000) / 1000.0, &trimix, 1, 0, &dive, prefs.bottomsac);
+	}
+}
+
+void TestDeco::benchmarkPlotInfo()
+{
+	struct plot_info pi;
+	struct dive *dive;
+	int i;
+
+	clearDives();
+	QCOMPARE(parse_file(SUBSURFACE_SOURCE "/dives/SampleDivesV2.ssrf"), 0);
+	QBENCHMARK {
+		for_each_dive (i, dive) {
+			pi = calculate_max_limits_new(dive, &dive->dc);
+			create_plot_info_new(dive, &dive->dc, &pi, false);
+		}
+	}
+	clearDives();
+}
+
+QTEST_MAIN(TestDeco)
@@ -0,0 +1,25 @@
+#ifndef TESTDECO_H
+#define TESTDECO_H
+
+#include <QtTest>
+
+/*
+ * Replay a corpus of logged and planned dives through the deco engine
+ * and compare ceilings, NDL/TTS, stops, CNS/OTU and plan runtimes with
+ * the golden files in tests/golden. Running with SUBSURFACE_UPDATE_GOLDEN
+ * set (re)records them instead.
+ */
+class TestDeco : public QObject {
+	Q_OBJECT
+private slots:
+	void initTestCase();
+	void testLoggedDives_data();
+	void testLoggedDives();
+	void testPlannedDives_data();
+	void testPlannedDives();
+	void testPrintPlotInfo();
+	void benchmarkAddSegment();
+	void benchmarkPlotInfo();
+};
+
+#endif
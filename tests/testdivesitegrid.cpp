@@ -0,0 +1,93 @@
+#include "testdivesitegrid.h"
+#include "divesitegrid.h"
+
+#include <QSet>
+
+static QSet<uint32_t> uuids(const QVector<DiveSiteGrid::Site> &sites)
+{
+	QSet<uint32_t> result;
+	Q_FOREACH (const DiveSiteGrid::Site &site, sites)
+		result.insert(site.uuid);
+	return result;
+}
+
+// qrand() may only give 15 bits
+static int randomValue(int range)
+{
+	return ((qint64)qrand() * (RAND_MAX + 1LL) + qrand()) % range;
+}
+
+/* what sitesNear() has to find: every site in the box, the slow way */
+static QSet<uint32_t> sitesNearByScan(const QVector<DiveSiteGrid::Site> &sites, int latitude, int longitude, int radius)
+{
+	QSet<uint32_t> result;
+	Q_FOREACH (const DiveSiteGrid::Site &site, sites) {
+		qint64 latDiff = qAbs((qint64)site.latitude - latitude);
+		qint64 lonDiff = qAbs((qint64)site.longitude - longitude);
+		if (lonDiff > 180000000)
+			lonDiff = 360000000 - lonDiff;
+		if (latDiff <= radius && lonDiff <= radius)
+			result.insert(site.uuid);
+	}
+	return result;
+}
+
+void TestDiveSiteGrid::testDateLine()
+{
+	DiveSiteGrid grid;
+
+	// Fiji and Taveuni on both sides of the date line, and one far away
+	grid.insert(1, -16800000, 179950000);
+	grid.insert(2, -16800000, -179950000);
+	grid.insert(3, -16800000, 178000000);
+	QCOMPARE(grid.count(), 3);
+
+	QCOMPARE(uuids(grid.sitesNear(-16800000, 179990000, 100000)), QSet<uint32_t>() << 1 << 2);
+	QCOMPARE(uuids(grid.sitesNear(-16800000, -179990000, 100000)), QSet<uint32_t>() << 1 << 2);
+	QCOMPARE(uuids(grid.sitesNear(-16800000, 180000000, 40000)), QSet<uint32_t>());
+	QCOMPARE(uuids(grid.sitesNear(-16800000, -180000000, 50000)), QSet<uint32_t>() << 1 << 2);
+	QCOMPARE(uuids(grid.sitesNear(-16800000, 179000000, 1100000)), QSet<uint32_t>() << 1 << 2 << 3);
+	QCOMPARE(DiveSiteGrid::cellKey(0, 180000000, 100000), DiveSiteGrid::cellKey(0, -180000000, 100000));
+}
+
+void TestDiveSiteGrid::testPoles()
+{
+	DiveSiteGrid grid;
+
+	// at the poles all the longitudes are close, but the box is still in degrees
+	grid.insert(1, 90000000, 0);
+	grid.insert(2, 89950000, 179990000);
+	grid.insert(3, -90000000, 45000000);
+	grid.insert(4, -89990000, 45050000);
+
+	QCOMPARE(uuids(grid.sitesNear(90000000, 0, 100000)), QSet<uint32_t>() << 1);
+	QCOMPARE(uuids(grid.sitesNear(89990000, -179990000, 100000)), QSet<uint32_t>() << 2);
+	QCOMPARE(uuids(grid.sitesNear(90000000, 0, 180000000)), QSet<uint32_t>() << 1 << 2 << 3 << 4);
+	QCOMPARE(uuids(grid.sitesNear(-90000000, 45000000, 100000)), QSet<uint32_t>() << 3 << 4);
+	// a box that reaches past the pole
+	QCOMPARE(uuids(grid.sitesNear(-90000000, 45000000, 20000)), QSet<uint32_t>() << 3);
+}
+
+void TestDiveSiteGrid::testWideRadius()
+{
+	QVector<DiveSiteGrid::Site> sites;
+	DiveSiteGrid grid(7000000);
+
+	// a cell size that doesn't divide the globe, and boxes that wrap around it
+	qsrand(7);
+	for (uint32_t uuid = 1; uuid <= 2000; uuid++) {
+		DiveSiteGrid::Site site = { uuid, randomValue(180000001) - 90000000, randomValue(360000000) - 180000000 };
+		sites.append(site);
+		grid.insert(site.uuid, site.latitude, site.longitude);
+	}
+	const int radii[] = { 1000000, 6999999, 7000000, 90000000, 176500000, 179999999, 180000000 };
+	for (unsigned int i = 0; i < sizeof(radii) / sizeof(radii[0]); i++) {
+		for (int j = 0; j < 50; j++) {
+			int latitude = randomValue(180000001) - 90000000;
+			int longitude = randomValue(360000000) - 180000000;
+			QCOMPARE(uuids(grid.sitesNear(latitude, longitude, radii[i])), sitesNearByScan(sites, latitude, longitude, radii[i]));
+		}
+	}
+}
+
+QTEST_MAIN(TestDiveSiteGrid)
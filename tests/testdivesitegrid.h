@@ -0,0 +1,14 @@
+#ifndef TESTDIVESITEGRID_H
+#define TESTDIVESITEGRID_H
+
+#include <QtTest>
+
+class TestDiveSiteGrid : public QObject {
+	Q_OBJECT
+private slots:
+	void testDateLine();
+	void testPoles();
+	void testWideRadius();
+};
+
+#endif
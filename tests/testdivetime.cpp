@@ -0,0 +1,120 @@
+#include "testdivetime.h"
+#include "dive.h"
+#include "divelist.h"
+
+#define D30MIN (30 * 60)
+#define T0 1420070400
+
+static struct dive *add_dive(int start, int duration)
+{
+	struct dive *dive = alloc_dive();
+
+	dive->when = T0 + start;
+	record_dive(dive);
+	// without samples fixup_dive() leaves a zero duration
+	dive->duration.seconds = duration;
+	return dive;
+}
+
+static void collect_cb(struct dive *dive, int n, void *data)
+{
+	QList<QPair<int, struct dive *> > *matches = (QList<QPair<int, struct dive *> > *)data;
+
+	matches->append(qMakePair(n, dive));
+}
+
+void TestDiveTime::cleanup()
+{
+	while (dive_table.nr)
+		delete_single_dive(dive_table.nr - 1);
+}
+
+void TestDiveTime::testFindDiveIncluding()
+{
+	// a long dive A with a short one B inside it, and a separate dive C
+	struct dive *a = add_dive(0, 3600);
+	struct dive *b = add_dive(100, 100);
+	struct dive *c = add_dive(5000, 1000);
+
+	QCOMPARE(find_dive_including(T0 - 1), (struct dive *)NULL);
+	QCOMPARE(find_dive_including(T0), a);
+	QCOMPARE(find_dive_including(T0 + 150), a);
+	QCOMPARE(find_dive_including(T0 + 300), a);
+	QCOMPARE(find_dive_including(T0 + 3600), a);
+	QCOMPARE(find_dive_including(T0 + 3601), (struct dive *)NULL);
+	QCOMPARE(find_dive_including(T0 + 5500), c);
+	QCOMPARE(find_dive_including(T0 + 6001), (struct dive *)NULL);
+	// B is only found when A doesn't include the time
+	a->duration.seconds = 50;
+	QCOMPARE(find_dive_including(T0 + 150), b);
+}
+
+void TestDiveTime::testMatchDiveTimeIndex()
+{
+	struct dive *a = add_dive(0, 3600);
+	struct dive *b = add_dive(100, 100);
+	struct dive *c = add_dive(5000, 1000);
+	struct dive_time_index index;
+	QList<QPair<int, struct dive *> > matches;
+	const timestamp_t when[] = { T0 - 1, T0 + 150, T0 + 300, T0 + 3600, T0 + 4000, T0 + 6000 };
+
+	build_dive_time_index(&index, false, 0);
+	QCOMPARE(index.nr, 3);
+	match_dive_time_index(&index, when, sizeof(when) / sizeof(when[0]), collect_cb, &matches);
+	free_dive_time_index(&index);
+
+	QList<QPair<int, struct dive *> > expected;
+	expected << qMakePair(1, a) << qMakePair(1, b) << qMakePair(2, a) << qMakePair(3, a) << qMakePair(5, c);
+	QCOMPARE(matches, expected);
+
+	// a margin widens every interval on both ends
+	matches.clear();
+	build_dive_time_index(&index, false, 500);
+	match_dive_time_index(&index, when, sizeof(when) / sizeof(when[0]), collect_cb, &matches);
+	free_dive_time_index(&index);
+	expected.clear();
+	expected << qMakePair(0, a) << qMakePair(0, b) << qMakePair(1, a) << qMakePair(1, b)
+		 << qMakePair(2, a) << qMakePair(2, b) << qMakePair(3, a) << qMakePair(4, a) << qMakePair(5, c);
+	QCOMPARE(matches, expected);
+}
+
+/*
+ * Pictures belong to a dive if they were taken less than half an hour
+ * before it started or after it ended, see dive_check_picture_time().
+ * The dive starts at the picture's own timestamp and the shift moves the
+ * picture to either side of the edges.
+ */
+void TestDiveTime::testPictureTimeEdges()
+{
+	char picture[] = SUBSURFACE_SOURCE "/dives/images/PA102003.jpg";
+	char *filenames[] = { picture };
+	timestamp_t timestamp = picture_get_timestamp(picture);
+	const int shifts[] = { -D30MIN, -D30MIN + 1, 3600 + D30MIN - 1, 3600 + D30MIN };
+	const bool inside[] = { false, true, true, false };
+
+	QVERIFY(timestamp != 0);
+	for (unsigned int i = 0; i < sizeof(shifts) / sizeof(shifts[0]); i++) {
+		struct dive *dive = alloc_dive();
+		timestamp_t timestamps[1];
+		bool valid[1];
+
+		dive->when = timestamp;
+		dive->selected = true;
+		record_dive(dive);
+		dive->duration.seconds = 3600;
+
+		QCOMPARE(dive_check_picture_time(dive, shifts[i], timestamp), inside[i]);
+		pictures_check_valid(filenames, 1, shifts[i], timestamps, valid);
+		QCOMPARE(timestamps[0], timestamp);
+		QCOMPARE(valid[0], inside[i]);
+		QCOMPARE(create_pictures_for_selected_dives(filenames, 1, shifts[i]), inside[i] ? 1 : 0);
+		QCOMPARE(dive_get_picture_count(dive), inside[i] ? 1u : 0u);
+		if (inside[i])
+			QCOMPARE(dive->picture_list->offset.seconds, shifts[i]);
+		// adding the same picture again doesn't duplicate it
+		QCOMPARE(create_pictures_for_selected_dives(filenames, 1, shifts[i]), 0);
+		cleanup();
+	}
+}
+
+QTEST_MAIN(TestDiveTime)
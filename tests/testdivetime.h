@@ -0,0 +1,15 @@
+#ifndef TESTDIVETIME_H
+#define TESTDIVETIME_H
+
+#include <QtTest>
+
+class TestDiveTime : public QObject {
+	Q_OBJECT
+private slots:
+	void cleanup();
+	void testFindDiveIncluding();
+	void testMatchDiveTimeIndex();
+	void testPictureTimeEdges();
+};
+
+#endif
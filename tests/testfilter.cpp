@@ -0,0 +1,97 @@
+#include "testfilter.h"
+#include "dive.h"
+#include "divelist.h"
+#include "filtermodels.h"
+
+static void clearDives()
+{
+	while (dive_table.nr)
+		delete_single_dive(dive_table.nr - 1);
+}
+
+static int hiddenDives()
+{
+	struct dive *dive;
+	int i, hidden = 0;
+
+	for_each_dive (i, dive) {
+		if (dive->hidden_by_filter)
+			hidden++;
+	}
+	return hidden;
+}
+
+// recompute which dives the filters let through, as a change of the filters does
+static void updateVisibleDives(TagFilterModel *tags)
+{
+	MultiFilterSortModel *filter = MultiFilterSortModel::instance();
+
+	filter->addFilterModel(tags);
+	QMetaObject::invokeMethod(filter, "updateVisibleDives");
+	filter->removeFilterModel(tags);
+}
+
+void TestFilter::testUntaggedLog()
+{
+	TagFilterModel *tags = TagFilterModel::instance();
+
+	clearDives();
+	QCOMPARE(parse_file(SUBSURFACE_SOURCE "/dives/test40-42.xml"), 0);
+	QVERIFY(dive_table.nr > 0);
+	tags->repopulate();
+	QCOMPARE(tags->rowCount(), 1);
+	QCOMPARE(tags->diveCount(0), dive_table.nr);
+
+	// checking "Empty tags" shows all of the dives
+	QVERIFY(tags->setData(tags->index(0), true, Qt::CheckStateRole));
+	QBitArray dives = tags->filteredDives();
+	QCOMPARE(dives.size(), dive_table.nr);
+	QCOMPARE(dives.count(true), dive_table.nr);
+	updateVisibleDives(tags);
+	QCOMPARE(hiddenDives(), 0);
+	tags->clearFilter();
+}
+
+void TestFilter::testDiveAddedAfterIndexing()
+{
+	TagFilterModel *tags = TagFilterModel::instance();
+	int emptyRow;
+
+	clearDives();
+	QCOMPARE(parse_file(SUBSURFACE_SOURCE "/dives/test29.xml"), 0);
+	sort_table(&dive_table);
+	tags->repopulate();
+	emptyRow = tags->rowCount() - 1;
+	QVERIFY(tags->setData(tags->index(emptyRow), true, Qt::CheckStateRole));
+	QCOMPARE(tags->filteredDives().count(true), tags->diveCount(emptyRow));
+
+	// an untagged dive before all the others shifts the indices of the index
+	struct dive *dive = alloc_dive();
+	dive->when = get_dive(0)->when - 24 * 3600;
+	record_dive(dive);
+	sort_table(&dive_table);
+	QCOMPARE(get_dive(0), dive);
+
+	// the stale index must not hide any dive
+	QBitArray dives = tags->filteredDives();
+	QCOMPARE(dives.size(), dive_table.nr);
+	QCOMPARE(dives.count(true), dive_table.nr);
+	updateVisibleDives(tags);
+	QCOMPARE(hiddenDives(), 0);
+
+	// once repopulated the new dive is one of the untagged ones
+	tags->repopulate();
+	emptyRow = tags->rowCount() - 1;
+	QVERIFY(tags->setData(tags->index(emptyRow), true, Qt::CheckStateRole));
+	dives = tags->filteredDives();
+	QCOMPARE(dives.size(), dive_table.nr);
+	QVERIFY(dives.testBit(0));
+	QCOMPARE(dives.count(true), tags->diveCount(emptyRow));
+	updateVisibleDives(tags);
+	QVERIFY(!dive->hidden_by_filter);
+	QCOMPARE(hiddenDives(), dive_table.nr - tags->diveCount(emptyRow));
+	tags->clearFilter();
+	clearDives();
+}
+
+QTEST_MAIN(TestFilter)
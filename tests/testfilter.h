@@ -0,0 +1,13 @@
+#ifndef TESTFILTER_H
+#define TESTFILTER_H
+
+#include <QtTest>
+
+class TestFilter : public QObject {
+	Q_OBJECT
+private slots:
+	void testUntaggedLog();
+	void testDiveAddedAfterIndexing();
+};
+
+#endif
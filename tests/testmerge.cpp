@@ -0,0 +1,54 @@
+#include "testmerge.h"
+#include "dive.h"
+#include "divelist.h"
+#include "windowtitleupdate.h"
+
+#define NR_DIVES 5000
+
+// a simple square profile; the same diveid on the same dive computer
+// makes process_dives() treat two copies as definitely the same dive
+static struct dive *create_dive(int nr, bool downloaded)
+{
+	struct dive *dive = alloc_dive();
+	struct divecomputer *dc = &dive->dc;
+	struct sample *sample;
+	int t;
+
+	dive->when = 1420070400 + nr * 24 * 3600;
+	dive->downloaded = downloaded;
+	dc->model = copy_string("Test computer");
+	dc->deviceid = 0x12345678;
+	dc->diveid = nr + 1;
+	for (t = 0; t <= 2400; t += 10) {
+		sample = prepare_sample(dc);
+		sample->time.seconds = t;
+		sample->depth.mm = (t == 0 || t == 2400) ? 0 : 20000 + nr % 10 * 1000;
+		finish_sample(dc);
+	}
+	return dive;
+}
+
+void TestMerge::testMergeOverlappingDownload()
+{
+	// importing marks the dive list as changed, which updates the title
+	WindowTitleUpdate titleUpdate;
+	int i;
+
+	for (i = 0; i < NR_DIVES; i++)
+		record_dive(create_dive(i, false));
+	process_dives(false, false);
+	dive_table.preexisting = dive_table.nr;
+	QCOMPARE(dive_table.nr, NR_DIVES);
+
+	// download all of them again, plus one new dive at the end
+	for (i = NR_DIVES; i >= 0; i--)
+		record_dive(create_dive(i, true));
+	QBENCHMARK_ONCE {
+		process_dives(true, false);
+	}
+	QCOMPARE(dive_table.nr, NR_DIVES + 1);
+	for (i = 1; i < dive_table.nr; i++)
+		QVERIFY(get_dive(i - 1)->when < get_dive(i)->when);
+}
+
+QTEST_MAIN(TestMerge)
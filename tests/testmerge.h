@@ -0,0 +1,12 @@
+#ifndef TESTMERGE_H
+#define TESTMERGE_H
+
+#include <QtTest>
+
+class TestMerge : public QObject {
+	Q_OBJECT
+private slots:
+	void testMergeOverlappingDownload();
+};
+
+#endif
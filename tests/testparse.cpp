@@ -44,4 +44,21 @@ void TestParse::testParseCompareOutput()
 	QCOMPARE(readin, written);
 }
 
+void TestParse::testParseDM4()
+{
+	// the Suunto DM4 database holds a single dive with 179 samples
+	QCOMPARE(parse_file(SUBSURFACE_SOURCE "/dives/TestDiveDM4.db"), 0);
+	struct dive *dive = get_dive(dive_table.nr - 1);
+	QVERIFY(dive != NULL);
+	QCOMPARE(dive->when, (timestamp_t)1359821648);
+	QCOMPARE(QString(dive->notes), QString("Notes are here"));
+	QCOMPARE(dive->dc.samples, 179);
+	QCOMPARE(dive->dc.sample[1].time.seconds, 20u);
+	QCOMPARE(dive->dc.sample[2].cylinderpressure.mbar, 203600);
+	QCOMPARE(dive->dc.sample[0].temperature.mkelvin, (int)C_to_mkelvin(28));
+	QCOMPARE(dive->cylinder[0].gasmix.o2.permille, 330);
+	QCOMPARE(dive->cylinder[0].start.mbar, 205110);
+	QCOMPARE(dive->cylinder[0].end.mbar, 53870);
+}
+
 QTEST_MAIN(TestParse)
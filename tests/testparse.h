@@ -10,6 +10,7 @@ private slots:
 	void testParseV2NoQuestion();
 	void testParseV3();
 	void testParseCompareOutput();
+	void testParseDM4();
 };
 
 #endif
@@ -0,0 +1,148 @@
+#include "testperformance.h"
+#include "generatelogbook.h"
+#include "dive.h"
+#include "divesite.h"
+#include "divelist.h"
+#include "display.h"
+#include "profile.h"
+#include "planner.h"
+#include "git-access.h"
+#include <git2.h>
+
+// SUBSURFACE_BENCHMARK_DIVES sets the size of the logbook
+#define DEFAULT_NR_DIVES 10000
+
+static void clearLogbook()
+{
+	while (dive_table.nr)
+		delete_single_dive(dive_table.nr - 1);
+	while (dive_site_table.nr)
+		delete_dive_site(get_dive_site(dive_site_table.nr - 1)->uuid);
+}
+
+void TestPerformance::initTestCase()
+{
+#if !LIBGIT2_VER_MAJOR && LIBGIT2_VER_MINOR < 22
+	git_threads_init();
+#else
+	git_libgit2_init();
+#endif
+	prefs = default_prefs;
+	QVERIFY(dir.isValid());
+	nrDives = qgetenv("SUBSURFACE_BENCHMARK_DIVES").toInt();
+	if (nrDives <= 0)
+		nrDives = DEFAULT_NR_DIVES;
+	generateLogbook(nrDives);
+	QCOMPARE(dive_table.nr, nrDives);
+}
+
+void TestPerformance::testSaveXml()
+{
+	QByteArray fileName = QFile::encodeName(dir.path() + "/logbook.ssrf");
+	QBENCHMARK_ONCE {
+		QCOMPARE(save_dives(fileName.data()), 0);
+	}
+}
+
+void TestPerformance::testSaveGit()
+{
+	QByteArray repoName = QFile::encodeName(dir.path() + "/logbook.git");
+	git_repository *repo;
+
+	QCOMPARE(git_repository_init(&repo, repoName.data(), false), 0);
+	QBENCHMARK_ONCE {
+		QCOMPARE(do_git_save(repo, "master", NULL, false, true), 0);
+	}
+	git_repository_free(repo);
+}
+
+void TestPerformance::testParseXml()
+{
+	QByteArray fileName = QFile::encodeName(dir.path() + "/logbook.ssrf");
+
+	clearLogbook();
+	QBENCHMARK_ONCE {
+		QCOMPARE(parse_file(fileName.data()), 0);
+	}
+	QCOMPARE(dive_table.nr, nrDives);
+}
+
+void TestPerformance::testLoadGit()
+{
+	QByteArray repoName = QFile::encodeName(dir.path() + "/logbook.git");
+	git_repository *repo;
+
+	clearLogbook();
+	QCOMPARE(git_repository_open(&repo, repoName.data()), 0);
+	QBENCHMARK_ONCE {
+		// git_load_dives() frees both the repository and the branch name
+		QCOMPARE(git_load_dives(repo, strdup("master")), 0);
+	}
+	QCOMPARE(dive_table.nr, nrDives);
+}
+
+void TestPerformance::testCreatePlotInfo()
+{
+	struct plot_info pi;
+	struct dive *d;
+	int i;
+
+	QBENCHMARK_ONCE {
+		for_each_dive (i, d) {
+			pi = calculate_max_limits_new(d, &d->dc);
+			create_plot_info_new(d, &d->dc, &pi, false);
+		}
+	}
+}
+
+// a 60m trimix dive with two deco gases, as the planner would be given it
+void TestPerformance::testPlan()
+{
+	struct gasmix bottom = { { 180 }, { 450 } };
+	struct gasmix ean50 = { { 500 }, { 0 } };
+	struct gasmix oxygen = { { 1000 }, { 0 } };
+	char *cache = NULL;
+
+	memset(&displayed_dive, 0, sizeof(displayed_dive));
+	displayed_dive.cylinder[0].type.size.mliter = 24000;
+	displayed_dive.cylinder[0].type.workingpressure.mbar = 232000;
+	displayed_dive.cylinder[0].gasmix = bottom;
+	displayed_dive.cylinder[0].start.mbar = 232000;
+	displayed_dive.cylinder[1].type.size.mliter = 11100;
+	displayed_dive.cylinder[1].type.workingpressure.mbar = 207000;
+	displayed_dive.cylinder[1].gasmix = ean50;
+	displayed_dive.cylinder[1].depth.mm = 21000;
+	displayed_dive.cylinder[1].start.mbar = 207000;
+	displayed_dive.cylinder[2].type.size.mliter = 5700;
+	displayed_dive.cylinder[2].type.workingpressure.mbar = 207000;
+	displayed_dive.cylinder[2].gasmix = oxygen;
+	displayed_dive.cylinder[2].depth.mm = 6000;
+	displayed_dive.cylinder[2].start.mbar = 207000;
+
+	QBENCHMARK {
+		struct diveplan diveplan = {};
+		diveplan.when = 1420070400;
+		diveplan.bottomsac = prefs.bottomsac;
+		diveplan.decosac = prefs.decosac;
+		diveplan.gflow = prefs.gflow;
+		diveplan.gfhigh = prefs.gfhigh;
+		plan_add_segment(&diveplan, 3 * 60, 60000, bottom, 0, true);
+		plan_add_segment(&diveplan, 25 * 60, 60000, bottom, 0, true);
+		for (int i = 1; i <= 2; i++) {
+			struct divedatapoint *dp = create_dp(0, displayed_dive.cylinder[i].depth.mm, displayed_dive.cylinder[i].gasmix, 0);
+			dp->next = diveplan.dp;
+			diveplan.dp = dp;
+		}
+		plan(&diveplan, &cache, true, false);
+		free(cache);
+		cache = NULL;
+		free_dps(&diveplan);
+	}
+}
+
+void TestPerformance::cleanupTestCase()
+{
+	clearLogbook();
+}
+
+QTEST_MAIN(TestPerformance)
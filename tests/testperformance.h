@@ -0,0 +1,29 @@
+#ifndef TESTPERFORMANCE_H
+#define TESTPERFORMANCE_H
+
+#include <QtTest>
+#include <QTemporaryDir>
+
+/*
+ * Timings of the expensive core operations on a large synthetic
+ * logbook. These are QtTest benchmarks, so "-csv" or "-xml" on the
+ * command line gives machine readable results.
+ */
+class TestPerformance : public QObject {
+	Q_OBJECT
+private slots:
+	void initTestCase();
+	void testSaveXml();
+	void testSaveGit();
+	void testParseXml();
+	void testLoadGit();
+	void testCreatePlotInfo();
+	void testPlan();
+	void cleanupTestCase();
+
+private:
+	QTemporaryDir dir;
+	int nrDives;
+};
+
+#endif
@@ -1,9 +1,83 @@
 #include "testprofile.h"
 #include "dive.h"
+#include "display.h"
+#include "profile.h"
 
 void TestProfile::testRedCeiling()
 {
 	parse_file("../dives/deep.xml");
 }
 
-QTEST_MAIN(TestProfile)
\ No newline at end of file
+/* the window scan analyze_plot_info() used to do for every entry */
+static void referenceMinMax(struct plot_data *entry, struct plot_minmax_data *minmax, struct plot_data *first, struct plot_data *last, int index)
+{
+	struct plot_data *p = entry;
+	int time = entry->sec;
+	int seconds = 90 * (index + 1);
+	struct plot_data *min, *max;
+	int avg, nr;
+
+	while (p > first) {
+		if (p[-1].sec < time - seconds)
+			break;
+		p--;
+	}
+
+	min = max = p;
+	avg = p->depth;
+	nr = 1;
+	while (++p < last) {
+		int depth = p->depth;
+		if (p->sec > time + seconds)
+			break;
+		avg += depth;
+		nr++;
+		if (depth < min->depth)
+			min = p;
+		if (depth > max->depth)
+			max = p;
+	}
+	minmax->min[index] = min;
+	minmax->max[index] = max;
+	minmax->avg[index] = (avg + nr / 2) / nr;
+}
+
+void TestProfile::testMinMax()
+{
+	struct plot_info pi = {}, ref = {};
+	int sec = 0, depth = 0;
+
+	/* irregular sample intervals, repeated times and flat stretches */
+	qsrand(42);
+	pi.nr = ref.nr = 20000;
+	pi.entry = (struct plot_data *)calloc(pi.nr, sizeof(struct plot_data));
+	ref.entry = (struct plot_data *)calloc(ref.nr, sizeof(struct plot_data));
+	pi.minmax = (struct plot_minmax_data *)calloc(pi.nr, sizeof(struct plot_minmax_data));
+	ref.minmax = (struct plot_minmax_data *)calloc(ref.nr, sizeof(struct plot_minmax_data));
+	for (int i = 0; i < pi.nr; i++) {
+		sec += qrand() % 12;
+		if (qrand() % 4)
+			depth = qMax(0, depth + qrand() % 2001 - 1000);
+		pi.entry[i].sec = ref.entry[i].sec = sec;
+		pi.entry[i].depth = ref.entry[i].depth = depth;
+	}
+
+	analyze_plot_info(&pi);
+	for (int i = 0; i < ref.nr; i++)
+		for (int j = 0; j < 3; j++)
+			referenceMinMax(ref.entry + i, ref.minmax + i, ref.entry, ref.entry + ref.nr, j);
+
+	for (int i = 0; i < pi.nr; i++) {
+		for (int j = 0; j < 3; j++) {
+			QCOMPARE(pi.minmax[i].min[j] - pi.entry, ref.minmax[i].min[j] - ref.entry);
+			QCOMPARE(pi.minmax[i].max[j] - pi.entry, ref.minmax[i].max[j] - ref.entry);
+			QCOMPARE(pi.minmax[i].avg[j], ref.minmax[i].avg[j]);
+		}
+	}
+	free(pi.entry);
+	free(ref.entry);
+	free(pi.minmax);
+	free(ref.minmax);
+}
+
+QTEST_MAIN(TestProfile)
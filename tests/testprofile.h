@@ -7,6 +7,7 @@ class TestProfile : public QObject{
 	Q_OBJECT
 private slots:
 	void testRedCeiling();
+	void testMinMax();
 };
 
 #endif
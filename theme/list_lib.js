@@ -1335,6 +1335,60 @@ function canvas_draw()
 *this is called to view the dive details.
 */
 function showDiveDetails(dive)
+{
+	load_dive_details(dive, function() {
+		showLoadedDiveDetails(dive);
+	});
+}
+
+/**
+*A sharded export only has the list fields in file.js,
+*the rest of every settings.diveShardSize dives is in
+*_files/dives/shard_N.js and gets loaded the first time
+*one of these dives is shown.
+*/
+var shard_callbacks = new Array();
+
+function load_dive_details(dive, callback)
+{
+	var shard_size = parseInt(settings.diveShardSize);
+	if (!shard_size || items[dive].details_loaded) {
+		callback();
+		return;
+	}
+	var shard = Math.floor(dive / shard_size);
+	if (shard_callbacks[shard]) {
+		shard_callbacks[shard].push(callback);
+		return;
+	}
+	shard_callbacks[shard] = [callback];
+	var fileref = document.createElement('script');
+	fileref.setAttribute("type", "text/javascript");
+	fileref.setAttribute("src", location.pathname + "_files/dives/shard_" + shard + ".js");
+	document.getElementsByTagName("head")[0].appendChild(fileref);
+}
+
+/**
+*Called by a shard file once it is loaded,
+*adds the details to the dives of the shard.
+*/
+function dive_details_loaded(shard, details)
+{
+	for (var i = 0; i < details.length; i++) {
+		var dive = items[details[i].number];
+		for (var key in details[i]) {
+			dive[key] = details[i][key];
+		}
+		dive.details_loaded = true;
+	}
+	var callbacks = shard_callbacks[shard];
+	shard_callbacks[shard] = null;
+	for (var i = 0; i < callbacks.length; i++) {
+		callbacks[i]();
+	}
+}
+
+function showLoadedDiveDetails(dive)
 {
 	//set global variables
 	dive_id = dive;